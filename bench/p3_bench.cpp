@@ -0,0 +1,785 @@
+// Headless benchmark of the codec paths behind P3Decoder.decode_p3 (with and
+// without the lip-sync envelope), OpusSessionDecoder.decode_packets and its
+// PCM ring, OpusEncoder.encode_p3, the capture resampler and AudioStreamP3
+// playback at the codec rate versus the device rate. Links only the core
+// library, so it runs without Godot.
+//
+//   p3opus_bench [file.p3] [--iterations N]
+//   p3opus_bench [file.p3] --verify golden.txt | --record golden.txt
+//
+// For every case it prints the realtime multiple (seconds of audio processed
+// per second of CPU), CPU microseconds per second of audio, ns per packet,
+// operator new calls per second and an FNV-1a checksum of the output so
+// regressions in the decoded PCM show up as a changed checksum between builds.
+//
+// --verify runs every case once and compares its checksum with the one stored
+// in the golden file (one "name checksum" line per case, # starts a comment)
+// under the section for the running libopus version and CPU architecture; any
+// difference fails the run. Without such a section it exits with
+// VERIFY_SKIPPED_EXIT_CODE, which CTest reports as skipped. --record writes
+// the section instead, for when a change to the codec paths or an Opus update
+// changes the output on purpose, or to add a platform. --verify also fails
+// when ring_decode or ring_decode_envelope, the OpusSessionDecoder PCM ring
+// path, allocates at all, with or without a section.
+//
+// --stress runs only the DecodePipeline thread test instead: a network thread
+// pushes every packet of the file while an audio thread pulls 10ms blocks,
+// with decoding on the producer or on worker tasks started through the same
+// hand-off OpusSessionDecoder uses. The PCM that
+// reaches the audio thread must match a serial decode bit for bit. Build with
+// -DP3OPUS_TSAN=ON to run it under ThreadSanitizer.
+
+#include "audio_kernels.h"
+#include "decode_pipeline.h"
+#include "envelope_analyzer.h"
+#include "opus_config.h"
+#include "p3_codec.h"
+#include "pcm_ring.h"
+#include "polyphase_resampler.h"
+#include <opus.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef P3_BENCH_DEFAULT_FILE
+#define P3_BENCH_DEFAULT_FILE "demo/voice.p3"
+#endif
+
+// Count every operator new in the process; the codec paths should not allocate
+// per packet, so this stays close to the per-call result buffers
+static std::atomic<int64_t> allocation_count(0);
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+constexpr int SAMPLE_RATE = opus_config::DEFAULT_SAMPLE_RATE;
+constexpr int CHANNELS = opus_config::DEFAULT_CHANNELS;
+constexpr int FRAME_MS = opus_config::DEFAULT_FRAME_MS;
+constexpr int CAPTURE_RATE = 48000;
+constexpr int DEVICE_RATE = 48000;          // Typical AudioServer mix rate
+constexpr int SYNTHETIC_SECONDS = 30;
+constexpr int MAX_PACKET_SIZE = 4000;
+constexpr int VERIFY_SKIPPED_EXIT_CODE = 77;  // SKIP_RETURN_CODE of the golden_checksums test
+constexpr double PI = 3.14159265358979323846;
+
+struct Measurement {
+    int64_t packets = 0;
+    int64_t samples = 0;        // Per channel, at the rate given to report()
+    int64_t allocations = 0;
+    double seconds = 0.0;
+    uint64_t checksum = 0;
+};
+
+class Timer {
+public:
+    Timer() : allocations(allocation_count.load()), start(std::chrono::steady_clock::now()) {}
+
+    void stop(Measurement& result) {
+        result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.allocations += allocation_count.load() - allocations;
+    }
+
+private:
+    int64_t allocations;
+    std::chrono::steady_clock::time_point start;
+};
+
+void report(const char* name, const Measurement& result, int rate) {
+    double audio_seconds = (double)result.samples / rate;
+    double realtime = result.seconds > 0.0 ? audio_seconds / result.seconds : 0.0;
+    double usec_per_second = audio_seconds > 0.0 ? result.seconds * 1e6 / audio_seconds : 0.0;
+    double ns_per_packet = result.packets > 0 ? result.seconds * 1e9 / result.packets : 0.0;
+    double allocations_per_second = result.seconds > 0.0 ? result.allocations / result.seconds : 0.0;
+    printf("%-18s %10.1fx realtime %8.0f us/s %10.0f ns/packet %12.1f allocs/s   checksum %016llx\n",
+           name, realtime, usec_per_second, ns_per_packet, allocations_per_second, (unsigned long long)result.checksum);
+}
+
+bool read_file(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? size : 0);
+    size_t read_bytes = data.empty() ? 0 : fread(data.data(), 1, data.size(), file);
+    fclose(file);
+    return read_bytes == data.size();
+}
+
+// Voice-like test signal: a gliding tone with harmonics, syllable envelope and noise
+std::vector<int16_t> synthetic_pcm(int rate, int channels, int seconds) {
+    std::vector<int16_t> pcm((size_t)rate * seconds * channels);
+    uint32_t noise = 0x12345678u;
+    double phase = 0.0;
+    for (size_t i = 0; i < pcm.size() / channels; i++) {
+        double t = (double)i / rate;
+        double pitch = 140.0 + 60.0 * sin(2.0 * PI * 0.7 * t);
+        phase += 2.0 * PI * pitch / rate;
+        double envelope = 0.5 + 0.5 * sin(2.0 * PI * 3.0 * t);
+        noise = noise * 1664525u + 1013904223u;
+        double value = envelope * (0.5 * sin(phase) + 0.25 * sin(2.0 * phase) + 0.12 * sin(3.0 * phase))
+                     + 0.02 * ((double)(noise >> 8) / (1 << 24) - 0.5);
+        for (int c = 0; c < channels; c++) {
+            pcm[i * channels + c] = (int16_t)lrint(value * 16000.0);
+        }
+    }
+    return pcm;
+}
+
+// P3Decoder.decode_p3: header pre-scan, one output allocation, decode in place.
+// envelope_window_ms > 0 adds the lip-sync envelope computed inside the loop.
+Measurement bench_decode_p3(OpusDecoder* decoder, const std::vector<uint8_t>& p3_data, int iterations, int envelope_window_ms = 0) {
+    Measurement result;
+    int max_frame_size = opus_config::frame_samples(SAMPLE_RATE, opus_config::MAX_FRAME_MS);
+    EnvelopeAnalyzer envelope;
+    envelope.configure(SAMPLE_RATE, CHANNELS, envelope_window_ms);
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        Timer timer;
+
+        p3::ScanInfo scan;
+        if (!p3::scan_packets(p3_data.data(), p3_data.size(), SAMPLE_RATE, scan)) {
+            fprintf(stderr, "decode_p3: malformed P3 packet at byte %lld\n", (long long)scan.error_pos);
+            exit(1);
+        }
+        std::vector<int16_t> pcm(scan.total_samples * CHANNELS);
+
+        p3::DecodeState state;
+        state.begin(decoder, pcm.data(), scan.total_samples, max_frame_size);
+        if (envelope.is_enabled()) {
+            envelope.reset();
+            envelope.reserve(scan.total_samples);
+            state.envelope = &envelope;
+        }
+        int64_t pos = 0;
+        p3::decode_packets<CHANNELS>(state, p3_data.data(), p3_data.size(), pos);
+        envelope.finish();
+        timer.stop(result);
+
+        if (state.failed()) {
+            fprintf(stderr, "decode_p3: %s\n", opus_strerror(state.error));
+            exit(1);
+        }
+        result.packets += state.packet_count;
+        result.samples += state.total_pcm_samples;
+        result.checksum = p3::pcm_checksum(pcm.data(), state.total_pcm_samples * CHANNELS);
+    }
+    return result;
+}
+
+// OpusSessionDecoder.decode_packets: one opus_decode per packet into a reused buffer
+Measurement bench_decode_packets(OpusDecoder* decoder, const std::vector<uint8_t>& p3_data, int iterations) {
+    Measurement result;
+    int max_frame_size = opus_config::frame_samples(SAMPLE_RATE, opus_config::MAX_FRAME_MS);
+    std::vector<int16_t> frame(max_frame_size * CHANNELS);
+
+    // Split the container up front like a network receiver would
+    std::vector<const uint8_t*> packets;
+    std::vector<int> packet_sizes;
+    int64_t pos = 0;
+    const uint8_t* packet = nullptr;
+    int packet_len = 0;
+    while (p3::read_packet(p3_data.data(), p3_data.size(), pos, packet, packet_len) == p3::READ_OK) {
+        packets.push_back(packet);
+        packet_sizes.push_back(packet_len);
+    }
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        uint64_t checksum = 14695981039346656037ULL;
+        Timer timer;
+        for (size_t i = 0; i < packets.size(); i++) {
+            int decoded_samples = opus_decode(decoder, packets[i], packet_sizes[i], frame.data(), max_frame_size, 0);
+            if (decoded_samples < 0) {
+                fprintf(stderr, "decode_packets: %s\n", opus_strerror(decoded_samples));
+                exit(1);
+            }
+            result.samples += decoded_samples;
+            checksum ^= p3::pcm_checksum(frame.data(), decoded_samples * CHANNELS) + i;
+        }
+        timer.stop(result);
+        result.packets += packets.size();
+        result.checksum = checksum;
+    }
+    return result;
+}
+
+// OpusSessionDecoder.decode_packet_to_ring + read_pcm: every packet decoded
+// into a reused frame and written to the PcmRing, drained in 10ms blocks as an
+// audio callback would. Everything is sized before the timer starts, so any
+// allocation counted here happens per packet. envelope_window_ms > 0 adds the
+// session's bounded lip-sync envelope, never taken, so it also runs full.
+Measurement bench_ring_decode(OpusDecoder* decoder, const std::vector<uint8_t>& p3_data, int iterations, int envelope_window_ms = 0) {
+    Measurement result;
+    constexpr int BLOCK_FRAMES = SAMPLE_RATE / 100;
+    int max_frame_size = opus_config::frame_samples(SAMPLE_RATE, opus_config::MAX_FRAME_MS);
+    std::vector<int16_t> frame(max_frame_size * CHANNELS);
+    std::vector<int16_t> block(BLOCK_FRAMES * CHANNELS);
+    PcmRing ring;
+    ring.configure(opus_config::frame_samples(SAMPLE_RATE, 500), CHANNELS);
+    EnvelopeAnalyzer envelope;
+    envelope.configure(SAMPLE_RATE, CHANNELS, envelope_window_ms);
+    if (envelope.is_enabled()) {
+        envelope.set_max_windows(1000 / envelope_window_ms);
+    }
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        ring.clear();
+        envelope.reset();
+        uint64_t checksum = 14695981039346656037ULL;
+        int64_t blocks = 0;
+        Timer timer;
+
+        int64_t pos = 0;
+        const uint8_t* packet = nullptr;
+        int packet_len = 0;
+        while (p3::read_packet(p3_data.data(), p3_data.size(), pos, packet, packet_len) == p3::READ_OK) {
+            int decoded_samples = opus_decode(decoder, packet, packet_len, frame.data(), max_frame_size, 0);
+            if (decoded_samples < 0) {
+                fprintf(stderr, "ring_decode: %s\n", opus_strerror(decoded_samples));
+                exit(1);
+            }
+            if (envelope.is_enabled()) {
+                envelope.process(frame.data(), decoded_samples);
+            }
+            ring.write(frame.data(), decoded_samples);
+            while (ring.get_available() >= BLOCK_FRAMES) {
+                ring.read(block.data(), BLOCK_FRAMES);
+                checksum ^= p3::pcm_checksum(block.data(), BLOCK_FRAMES * CHANNELS) + blocks++;
+            }
+            result.packets++;
+            result.samples += decoded_samples;
+        }
+        timer.stop(result);
+        result.checksum = checksum;
+    }
+    return result;
+}
+
+// OpusEncoder.encode_p3: one worst-case output buffer, every frame encoded in place
+Measurement bench_encode_p3(const std::vector<int16_t>& pcm, int iterations, std::vector<uint8_t>& encoded) {
+    Measurement result;
+    int error = OPUS_OK;
+    OpusEncoder* encoder = opus_encoder_create(SAMPLE_RATE, CHANNELS, OPUS_APPLICATION_VOIP, &error);
+    if (error != OPUS_OK) {
+        fprintf(stderr, "encode_p3: %s\n", opus_strerror(error));
+        exit(1);
+    }
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(24000));
+
+    int frame_size = opus_config::frame_samples(SAMPLE_RATE, FRAME_MS);
+    std::vector<int16_t> padded_frame(frame_size * CHANNELS);
+    int64_t frames = p3::encoded_frame_count(pcm.size(), frame_size, CHANNELS);
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        opus_encoder_ctl(encoder, OPUS_RESET_STATE);
+        Timer timer;
+        encoded.resize(frames * (p3::HEADER_SIZE + MAX_PACKET_SIZE));
+        int64_t written = p3::encode_frames<CHANNELS>(encoder, pcm.data(), pcm.size(), frame_size, MAX_PACKET_SIZE,
+                                                      p3::HEADER_SIZE, encoded.data(), nullptr, padded_frame.data());
+        timer.stop(result);
+
+        if (written < 0) {
+            fprintf(stderr, "encode_p3: %s\n", opus_strerror((int)written));
+            exit(1);
+        }
+        encoded.resize(written);
+        result.packets += frames;
+        result.samples += frames * frame_size;
+        result.checksum = p3::pcm_checksum(reinterpret_cast<const int16_t*>(encoded.data()), written / (int64_t)sizeof(int16_t));
+    }
+
+    opus_encoder_destroy(encoder);
+    return result;
+}
+
+// AudioStreamP3 playback: one packet at a time to float, then brought to
+// DEVICE_RATE. With decode_rate below DEVICE_RATE the PolyphaseResampler stands
+// in for the engine's resampler; at DEVICE_RATE Opus produces the output rate
+// itself. Samples are counted at DEVICE_RATE so both cases compare directly.
+Measurement bench_playback(const std::vector<uint8_t>& p3_data, int decode_rate, int iterations) {
+    Measurement result;
+    int error = OPUS_OK;
+    OpusDecoder* decoder = opus_decoder_create(decode_rate, CHANNELS, &error);
+    if (error != OPUS_OK) {
+        fprintf(stderr, "playback: %s\n", opus_strerror(error));
+        exit(1);
+    }
+
+    int max_frame_size = opus_config::frame_samples(decode_rate, opus_config::MAX_FRAME_MS);
+    std::vector<int16_t> frame(max_frame_size * CHANNELS);
+    std::vector<float> mono(max_frame_size);
+    PolyphaseResampler resampler;
+    bool resample = decode_rate != DEVICE_RATE;
+    if (resample) {
+        resampler.configure(decode_rate, DEVICE_RATE);
+    }
+    std::vector<float> output(resample ? resampler.get_max_output(max_frame_size) : 0);
+    std::vector<int16_t> quantized(resample ? output.size() : mono.size());
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        resampler.reset();
+        uint64_t checksum = 14695981039346656037ULL;
+        Timer timer;
+
+        int64_t pos = 0;
+        const uint8_t* packet = nullptr;
+        int packet_len = 0;
+        while (p3::read_packet(p3_data.data(), p3_data.size(), pos, packet, packet_len) == p3::READ_OK) {
+            int decoded_samples = opus_decode(decoder, packet, packet_len, frame.data(), max_frame_size, 0);
+            if (decoded_samples < 0) {
+                fprintf(stderr, "playback: %s\n", opus_strerror(decoded_samples));
+                exit(1);
+            }
+            for (int i = 0; i < decoded_samples; i++) {
+                mono[i] = frame[i] * (1.0f / 32768.0f);
+            }
+
+            const float* device = mono.data();
+            int device_samples = decoded_samples;
+            if (resample) {
+                device_samples = resampler.process(mono.data(), decoded_samples, output.data());
+                device = output.data();
+            }
+
+            // Checksum over int16 so it is stable across float rounding
+            for (int i = 0; i < device_samples; i++) {
+                quantized[i] = (int16_t)lrintf(device[i] * 32767.0f);
+            }
+            checksum ^= p3::pcm_checksum(quantized.data(), device_samples) + pos;
+            result.packets++;
+            result.samples += device_samples;
+        }
+        timer.stop(result);
+        result.checksum = checksum;
+    }
+
+    opus_decoder_destroy(decoder);
+    return result;
+}
+
+// OpusCaptureEncoder front end: 48kHz stereo capture to 16kHz mono int16, in 10ms blocks
+Measurement bench_capture_resample(int iterations) {
+    Measurement result;
+    constexpr int BLOCK_FRAMES = CAPTURE_RATE / 100;
+    std::vector<int16_t> source = synthetic_pcm(CAPTURE_RATE, 2, SYNTHETIC_SECONDS);
+    std::vector<float> stereo(source.size());
+    for (size_t i = 0; i < source.size(); i++) {
+        stereo[i] = source[i] / 32768.0f;
+    }
+
+    PolyphaseResampler resampler;
+    resampler.configure(CAPTURE_RATE, SAMPLE_RATE, 32767.0f);
+    std::vector<float> mono(BLOCK_FRAMES);
+    std::vector<float> resampled(resampler.get_max_output(BLOCK_FRAMES));
+    std::vector<int16_t> quantized(resampled.size());
+    int64_t total_frames = (int64_t)stereo.size() / 2;
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        resampler.reset();
+        uint64_t checksum = 14695981039346656037ULL;
+        Timer timer;
+        for (int64_t frame = 0; frame + BLOCK_FRAMES <= total_frames; frame += BLOCK_FRAMES) {
+            audio_kernels::downmix_stereo_to_mono(stereo.data() + frame * 2, mono.data(), BLOCK_FRAMES);
+            int produced = resampler.process(mono.data(), BLOCK_FRAMES, resampled.data());
+            audio_kernels::saturate_to_int16(resampled.data(), quantized.data(), produced);
+            checksum ^= p3::pcm_checksum(quantized.data(), produced) + frame;
+            result.packets++;
+            result.samples += BLOCK_FRAMES;
+        }
+        timer.stop(result);
+        result.checksum = checksum;
+    }
+    return result;
+}
+
+// Push every packet of p3_data through a DecodePipeline from a producer
+// thread and read the PCM back on a consumer thread in 10ms blocks. The
+// producer retries instead of dropping when the packet ring is full, so the
+// output must equal a serial decode; the ring sizes are kept small to force
+// both overruns and underruns.
+//
+// With decode_on_worker the producer drives the same hand-off as
+// OpusSessionDecoder on WorkerThreadPool: request_worker_decode() after every
+// push, and a new thread running run_worker_decode() whenever it asks for one
+// (the previous one is joined first, as wait_pipeline_task does). The
+// consumer stops once the producer is done and the PCM ring is empty, or at
+// STRESS_TIMEOUT, so a decode error or a lost hand-off fails the round instead
+// of hanging it.
+bool stress_pipeline(const std::vector<uint8_t>& p3_data, bool decode_on_worker, int rounds, uint64_t expected_checksum) {
+    constexpr int BLOCK_FRAMES = SAMPLE_RATE / 100;
+    constexpr std::chrono::seconds STRESS_TIMEOUT(30);
+    int max_frame_size = opus_config::frame_samples(SAMPLE_RATE, opus_config::MAX_FRAME_MS);
+    p3::ScanInfo scan;
+    if (!p3::scan_packets(p3_data.data(), p3_data.size(), SAMPLE_RATE, scan)) {
+        fprintf(stderr, "stress: malformed P3 packet at byte %lld\n", (long long)scan.error_pos);
+        return false;
+    }
+
+    int error = OPUS_OK;
+    OpusDecoder* decoder = opus_decoder_create(SAMPLE_RATE, CHANNELS, &error);
+    if (error != OPUS_OK) {
+        fprintf(stderr, "stress: %s\n", opus_strerror(error));
+        return false;
+    }
+
+    DecodePipeline pipeline;
+    std::vector<int16_t> output((size_t)scan.total_samples * CHANNELS);
+    int64_t overruns = 0;
+    int64_t underruns = 0;
+    int64_t tasks = 0;
+    bool passed = true;
+
+    for (int round = 0; round < rounds && passed; round++) {
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        pipeline.configure(decoder, SAMPLE_RATE, CHANNELS, max_frame_size, 0, max_frame_size * 2);
+        std::atomic<bool> producer_done(false);
+
+        std::thread producer([&]() {
+            std::thread task;
+            auto decode = [&]() {
+                if (!decode_on_worker) {
+                    pipeline.decode_pending();
+                } else if (pipeline.request_worker_decode()) {
+                    if (task.joinable()) {
+                        task.join();
+                    }
+                    task = std::thread([&]() { pipeline.run_worker_decode(); });
+                    tasks++;
+                }
+            };
+
+            int64_t pos = 0;
+            const uint8_t* packet = nullptr;
+            int packet_len = 0;
+            while (p3::read_packet(p3_data.data(), p3_data.size(), pos, packet, packet_len) == p3::READ_OK) {
+                while (!pipeline.push_packet(packet, packet_len)) {
+                    decode();
+                    std::this_thread::yield();
+                }
+                decode();
+            }
+            // Packets left behind by a full PCM ring still have to be decoded
+            while (pipeline.has_pending_packets()) {
+                decode();
+                std::this_thread::yield();
+            }
+            if (task.joinable()) {
+                task.join();
+            }
+            producer_done.store(true, std::memory_order_release);
+        });
+
+        // Audio thread: fixed-size pulls, keeping only the frames that came from the ring
+        int64_t received = 0;
+        bool timed_out = false;
+        std::thread consumer([&]() {
+            int16_t block[BLOCK_FRAMES * CHANNELS];
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + STRESS_TIMEOUT;
+            while (true) {
+                bool finished = producer_done.load(std::memory_order_acquire);
+                int copied = pipeline.read_pcm(block, BLOCK_FRAMES);
+                if (received + copied > scan.total_samples) {
+                    copied = (int)(scan.total_samples - received);
+                }
+                memcpy(output.data() + received * CHANNELS, block, (size_t)copied * CHANNELS * sizeof(int16_t));
+                received += copied;
+                if (finished && pipeline.get_buffered_frames() == 0) {
+                    break;
+                }
+                if (std::chrono::steady_clock::now() > deadline) {
+                    timed_out = true;
+                    break;
+                }
+                if (copied < BLOCK_FRAMES) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        producer.join();
+        consumer.join();
+
+        overruns += pipeline.get_overruns();
+        underruns += pipeline.get_underruns();
+        uint64_t checksum = p3::pcm_checksum(output.data(), received * CHANNELS);
+        if (timed_out || received != scan.total_samples || checksum != expected_checksum || pipeline.get_decode_errors() != 0) {
+            fprintf(stderr, "stress: round %d %s %lld of %lld frames, output %016llx, expected %016llx (%lld decode errors)\n",
+                    round, timed_out ? "timed out after" : "received", (long long)received, (long long)scan.total_samples,
+                    (unsigned long long)checksum, (unsigned long long)expected_checksum, (long long)pipeline.get_decode_errors());
+            passed = false;
+        }
+    }
+
+    printf("%-18s %6d rounds %10lld overruns %10lld underruns %8lld tasks   %s\n", decode_on_worker ? "pipeline_worker" : "pipeline_producer",
+           rounds, (long long)overruns, (long long)underruns, (long long)tasks, passed ? "ok" : "MISMATCH");
+    opus_decoder_destroy(decoder);
+    return passed;
+}
+
+struct CaseChecksum {
+    std::string name;
+    uint64_t checksum;
+};
+
+// Opus output is bit-exact only for one libopus build on one architecture
+// (the float decoder takes different SIMD paths on x86 and NEON), so the
+// golden file holds one "[libopus version, architecture]" section per platform
+std::string golden_section() {
+#if defined(__x86_64__) || defined(_M_X64)
+    const char* arch = "x86_64";
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    const char* arch = "arm64";
+#elif defined(__i386__) || defined(_M_IX86)
+    const char* arch = "x86";
+#elif defined(__arm__) || defined(_M_ARM)
+    const char* arch = "arm";
+#else
+    const char* arch = "unknown";
+#endif
+    return std::string("[") + opus_get_version_string() + ", " + arch + "]";
+}
+
+// Read the lines of path, without the trailing newline
+bool read_lines(const char* path, std::vector<std::string>& lines) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        std::string text(line);
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+            text.pop_back();
+        }
+        lines.push_back(text);
+    }
+    fclose(file);
+    return true;
+}
+
+// Checksums of the given section; found tells whether the file has it at all
+bool read_golden(const char* path, const std::string& section, std::vector<CaseChecksum>& golden, bool& found) {
+    std::vector<std::string> lines;
+    if (!read_lines(path, lines)) {
+        return false;
+    }
+    found = false;
+    bool in_section = false;
+    for (const std::string& line : lines) {
+        if (!line.empty() && line[0] == '[') {
+            in_section = line == section;
+            found = found || in_section;
+            continue;
+        }
+        char name[128];
+        unsigned long long checksum = 0;
+        if (in_section && sscanf(line.c_str(), "%127s %llx", name, &checksum) == 2 && name[0] != '#') {
+            golden.push_back(CaseChecksum{name, (uint64_t)checksum});
+        }
+    }
+    return true;
+}
+
+// Replace the section of this platform in path, keeping the other sections
+bool write_golden(const char* path, const std::string& section, const std::vector<CaseChecksum>& results) {
+    std::vector<std::string> lines;
+    read_lines(path, lines);
+
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fprintf(file, "# FNV-1a checksums of the p3opus_bench cases, checked by p3opus_bench --verify\n");
+    fprintf(file, "# One [libopus version, architecture] section per platform; --record replaces\n");
+    fprintf(file, "# the section of the current one when the output changes on purpose\n");
+
+    bool keep = false;
+    for (const std::string& line : lines) {
+        if (!line.empty() && line[0] == '[') {
+            keep = line != section;
+        }
+        if (keep && !line.empty()) {
+            fprintf(file, "%s%s\n", line[0] == '[' ? "\n" : "", line.c_str());
+        }
+    }
+
+    fprintf(file, "\n%s\n", section.c_str());
+    for (const CaseChecksum& result : results) {
+        fprintf(file, "%s %016llx\n", result.name.c_str(), (unsigned long long)result.checksum);
+    }
+    fclose(file);
+    return true;
+}
+
+enum VerifyResult {
+    VERIFY_OK,
+    VERIFY_FAILED,
+    VERIFY_NO_SECTION,      // Nothing recorded for this libopus build and architecture
+};
+
+// Every case must be in this platform's section with the same checksum
+VerifyResult verify_golden(const char* path, const std::vector<CaseChecksum>& results) {
+    std::string section = golden_section();
+    std::vector<CaseChecksum> golden;
+    bool found = false;
+    if (!read_golden(path, section, golden, found)) {
+        fprintf(stderr, "verify: cannot read %s\n", path);
+        return VERIFY_FAILED;
+    }
+    if (!found) {
+        printf("%-18s %s has no %s section, skipped (add one with --record)\n", "verify", path, section.c_str());
+        return VERIFY_NO_SECTION;
+    }
+
+    bool passed = true;
+    for (const CaseChecksum& result : results) {
+        const CaseChecksum* expected = nullptr;
+        for (const CaseChecksum& entry : golden) {
+            if (entry.name == result.name) {
+                expected = &entry;
+            }
+        }
+        if (expected == nullptr) {
+            fprintf(stderr, "verify: %s has no golden checksum\n", result.name.c_str());
+            passed = false;
+        } else if (expected->checksum != result.checksum) {
+            fprintf(stderr, "verify: %s checksum %016llx, expected %016llx\n", result.name.c_str(),
+                    (unsigned long long)result.checksum, (unsigned long long)expected->checksum);
+            passed = false;
+        }
+    }
+    printf("%-18s %zu cases against %s %s   %s\n", "verify", results.size(), path, section.c_str(), passed ? "ok" : "MISMATCH");
+    return passed ? VERIFY_OK : VERIFY_FAILED;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* path = P3_BENCH_DEFAULT_FILE;
+    const char* verify_path = nullptr;
+    const char* record_path = nullptr;
+    int iterations = 20;
+    int stress_rounds = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stress") == 0 && i + 1 < argc) {
+            stress_rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc) {
+            verify_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else {
+            path = argv[i];
+        }
+    }
+    if (iterations <= 0 || verify_path != nullptr || record_path != nullptr) {
+        iterations = 1;
+    }
+
+    std::vector<uint8_t> p3_data;
+    if (!read_file(path, p3_data) || p3_data.empty()) {
+        fprintf(stderr, "Failed to read %s\n", path);
+        return 1;
+    }
+
+    int error = OPUS_OK;
+    OpusDecoder* decoder = opus_decoder_create(SAMPLE_RATE, CHANNELS, &error);
+    if (error != OPUS_OK) {
+        fprintf(stderr, "Failed to create Opus decoder: %s\n", opus_strerror(error));
+        return 1;
+    }
+
+    if (stress_rounds > 0) {
+        uint64_t expected_checksum = bench_decode_p3(decoder, p3_data, 1).checksum;
+        opus_decoder_destroy(decoder);
+        printf("%s: %zu bytes, %d stress rounds, %s\n", path, p3_data.size(), stress_rounds, opus_get_version_string());
+        bool passed = stress_pipeline(p3_data, false, stress_rounds, expected_checksum);
+        passed = stress_pipeline(p3_data, true, stress_rounds, expected_checksum) && passed;
+        return passed ? 0 : 1;
+    }
+
+    std::vector<CaseChecksum> results;
+    auto run = [&results](const char* name, const Measurement& result, int rate) {
+        report(name, result, rate);
+        results.push_back(CaseChecksum{name, result.checksum});
+    };
+
+    printf("%s: %zu bytes, %d iterations, %s\n", path, p3_data.size(), iterations, opus_get_version_string());
+    run("decode_p3", bench_decode_p3(decoder, p3_data, iterations), SAMPLE_RATE);
+    run("decode_p3_envelope", bench_decode_p3(decoder, p3_data, iterations, 20), SAMPLE_RATE);
+    run("decode_packets", bench_decode_packets(decoder, p3_data, iterations), SAMPLE_RATE);
+
+    // The PCM ring path promises no allocation per packet, with or without
+    // the envelope; verify holds it to that
+    bool allocations_ok = true;
+    for (int envelope_window_ms : {0, 20}) {
+        const char* name = envelope_window_ms > 0 ? "ring_decode_envelope" : "ring_decode";
+        Measurement ring = bench_ring_decode(decoder, p3_data, iterations, envelope_window_ms);
+        run(name, ring, SAMPLE_RATE);
+        if (ring.allocations != 0) {
+            fprintf(stderr, "%s: %lld allocations over %lld packets, expected none\n", name,
+                    (long long)ring.allocations, (long long)ring.packets);
+            allocations_ok = false;
+        }
+    }
+
+    // Decode at the codec rate plus resampling versus decoding at the device rate
+    run("playback_16k_rs48k", bench_playback(p3_data, SAMPLE_RATE, iterations), DEVICE_RATE);
+    run("playback_48k", bench_playback(p3_data, DEVICE_RATE, iterations), DEVICE_RATE);
+
+    // Round trip of synthetic PCM, so encode and decode are covered without a file
+    std::vector<int16_t> pcm = synthetic_pcm(SAMPLE_RATE, CHANNELS, SYNTHETIC_SECONDS);
+    std::vector<uint8_t> encoded;
+    run("encode_p3", bench_encode_p3(pcm, iterations, encoded), SAMPLE_RATE);
+    run("decode_synthetic", bench_decode_p3(decoder, encoded, iterations), SAMPLE_RATE);
+    run("capture_resample", bench_capture_resample(iterations), CAPTURE_RATE);
+
+    opus_decoder_destroy(decoder);
+
+    if (record_path != nullptr) {
+        if (!write_golden(record_path, golden_section(), results)) {
+            fprintf(stderr, "record: cannot write %s\n", record_path);
+            return 1;
+        }
+        printf("%-18s %zu cases to %s\n", "record", results.size(), record_path);
+    }
+    if (verify_path != nullptr) {
+        VerifyResult verified = verify_golden(verify_path, results);
+        if (verified == VERIFY_FAILED || !allocations_ok) {
+            return 1;
+        }
+        if (verified == VERIFY_NO_SECTION) {
+            return VERIFY_SKIPPED_EXIT_CODE;
+        }
+    }
+    return 0;
+}
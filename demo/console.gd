@@ -16,7 +16,7 @@ func _ready():
 	# 创建音频流
 	var stream = AudioStreamWAV.new()
 	stream.format = AudioStreamWAV.FORMAT_16_BITS
-	stream.mix_rate = decoder.get_sample_rate()  # 16000
+	stream.mix_rate = decoder.get_sample_rate()  # 默认与混音采样率一致
 	stream.stereo = false  # 单声道
 	stream.data = pcm_data
 
@@ -0,0 +1,341 @@
+#include "audio_stream_p3.h"
+#include "codec_log.h"
+#include "codec_metrics.h"
+#include "opus_codec_pool.h"
+#include "output_rate.h"
+#include "p3_format.h"
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <opus.h>
+
+using namespace godot;
+
+// ========== AudioStreamPlaybackP3 ==========
+
+void AudioStreamPlaybackP3::_bind_methods() {
+}
+
+AudioStreamPlaybackP3::AudioStreamPlaybackP3() {
+    decoder = nullptr;
+    sample_rate = opus_config::DEFAULT_SAMPLE_RATE;
+    pcm_pos = 0;
+    pcm_len = 0;
+    data_pos = 0;
+    played_samples = 0;
+    loops = 0;
+    active = false;
+}
+
+AudioStreamPlaybackP3::~AudioStreamPlaybackP3() {
+    if (decoder != nullptr) {
+        OpusCodecPool::release_decoder(decoder, CHANNELS);
+        decoder = nullptr;
+    }
+}
+
+void AudioStreamPlaybackP3::rewind() {
+    if (decoder != nullptr) {
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+    }
+    data_pos = 0;
+    pcm_pos = 0;
+    pcm_len = 0;
+    played_samples = 0;
+}
+
+bool AudioStreamPlaybackP3::decode_next_packet() {
+    const uint8_t* packet = nullptr;
+    int data_len = 0;
+    p3::ReadResult read_result = p3::read_packet(data.ptr(), data.size(), data_pos, packet, data_len);
+
+    if (read_result != p3::READ_OK) {
+        if (read_result != p3::READ_END) {
+            CODEC_LOG_ERROR("AudioStreamPlaybackP3: Malformed packet at byte ", data_pos, " (length ", data_len, ")");
+            CodecMetrics::record_error();
+        }
+        return false;
+    }
+
+    uint64_t started_usec = CodecMetrics::now_usec();
+    int decoded_samples = opus_decode(decoder, packet, data_len, pcm_buffer, MAX_FRAME_SIZE, 0);
+    if (decoded_samples < 0) {
+        CODEC_LOG_ERROR("AudioStreamPlaybackP3: Decode failed: ", opus_strerror(decoded_samples));
+        CodecMetrics::record_error();
+        return false;
+    }
+    CodecMetrics::record_decode(1, data_len, decoded_samples * CHANNELS * (int64_t)sizeof(int16_t),
+                                CodecMetrics::now_usec() - started_usec, (int64_t)decoded_samples * 1000000 / sample_rate);
+
+    pcm_pos = 0;
+    pcm_len = decoded_samples;
+    return true;
+}
+
+void AudioStreamPlaybackP3::_start(double p_from_pos) {
+    if (decoder == nullptr) {
+        decoder = OpusCodecPool::acquire_decoder(sample_rate, CHANNELS);
+        if (decoder == nullptr) {
+            CODEC_LOG_ERROR("AudioStreamPlaybackP3: Failed to create decoder");
+            active = false;
+            return;
+        }
+    }
+
+    if (index.is_null() || index->get_packet_count() == 0) {
+        active = false;
+        return;
+    }
+
+    loops = 0;
+    active = true;
+    _seek(p_from_pos);
+    begin_resample();
+}
+
+void AudioStreamPlaybackP3::_stop() {
+    active = false;
+}
+
+bool AudioStreamPlaybackP3::_is_playing() const {
+    return active;
+}
+
+int32_t AudioStreamPlaybackP3::_get_loop_count() const {
+    return loops;
+}
+
+double AudioStreamPlaybackP3::_get_playback_position() const {
+    return (double)played_samples / sample_rate;
+}
+
+void AudioStreamPlaybackP3::_seek(double p_position) {
+    if (decoder == nullptr) {
+        return;
+    }
+
+    int64_t target = p_position > 0.0 ? (int64_t)(p_position * sample_rate) : 0;
+
+    rewind();
+    if (index.is_null() || index->get_packet_count() == 0) {
+        return;
+    }
+
+    // Jump to the packet containing the target, a few packets early so the
+    // decoder can settle before the target
+    int packet = index->find_packet(target, sample_rate);
+    int preroll_packet = packet > SEEK_PREROLL_PACKETS ? packet - SEEK_PREROLL_PACKETS : 0;
+
+    // Decode from the pre-roll packet and drop everything before the target
+    data_pos = index->get_packet_offset(preroll_packet);
+    int64_t decoded_pos = index->get_packet_start(preroll_packet, sample_rate);
+    while (decode_next_packet()) {
+        if (decoded_pos + pcm_len > target) {
+            pcm_pos = (int)(target - decoded_pos);
+            decoded_pos = target;
+            break;
+        }
+        decoded_pos += pcm_len;
+        pcm_len = 0;
+    }
+    played_samples = decoded_pos;
+}
+
+int32_t AudioStreamPlaybackP3::_mix_resampled(AudioFrame* p_dst_buffer, int32_t p_frame_count) {
+    int32_t mixed = 0;
+    bool rewound = false;
+
+    while (active && mixed < p_frame_count) {
+        if (pcm_pos >= pcm_len) {
+            if (decode_next_packet()) {
+                rewound = false;
+                continue;
+            }
+
+            // End of data: loop back once, or stop if there is nothing to play
+            if (stream.is_valid() && stream->loop && !rewound) {
+                rewind();
+                loops++;
+                rewound = true;
+                continue;
+            }
+
+            active = false;
+            break;
+        }
+
+        int32_t count = pcm_len - pcm_pos;
+        if (count > p_frame_count - mixed) {
+            count = p_frame_count - mixed;
+        }
+
+        const int16_t* src = pcm_buffer + pcm_pos;
+        AudioFrame* dst = p_dst_buffer + mixed;
+        for (int32_t i = 0; i < count; i++) {
+            float sample = src[i] * (1.0f / 32768.0f);
+            dst[i].left = sample;
+            dst[i].right = sample;
+        }
+
+        pcm_pos += count;
+        mixed += count;
+        played_samples += count;
+    }
+
+    for (int32_t i = mixed; i < p_frame_count; i++) {
+        p_dst_buffer[i].left = 0.0f;
+        p_dst_buffer[i].right = 0.0f;
+    }
+
+    return mixed;
+}
+
+float AudioStreamPlaybackP3::_get_stream_sampling_rate() const {
+    return (float)sample_rate;
+}
+
+// ========== AudioStreamP3 ==========
+
+void AudioStreamP3::_bind_methods() {
+    ClassDB::bind_static_method("AudioStreamP3", D_METHOD("load_from_file", "file_path"), &AudioStreamP3::load_from_file);
+
+    ClassDB::bind_method(D_METHOD("set_data", "p3_data"), &AudioStreamP3::set_data);
+    ClassDB::bind_method(D_METHOD("get_data"), &AudioStreamP3::get_data);
+    ClassDB::bind_method(D_METHOD("set_index_data", "index_data"), &AudioStreamP3::set_index_data);
+    ClassDB::bind_method(D_METHOD("get_index_data"), &AudioStreamP3::get_index_data);
+    ClassDB::bind_method(D_METHOD("set_loop", "enable"), &AudioStreamP3::set_loop);
+    ClassDB::bind_method(D_METHOD("has_loop"), &AudioStreamP3::has_loop);
+
+    ClassDB::bind_method(D_METHOD("set_output_rate", "rate"), &AudioStreamP3::set_output_rate);
+    ClassDB::bind_method(D_METHOD("get_output_rate"), &AudioStreamP3::get_output_rate);
+
+    ClassDB::bind_method(D_METHOD("get_index"), &AudioStreamP3::get_index);
+    ClassDB::bind_method(D_METHOD("get_packet_count"), &AudioStreamP3::get_packet_count);
+    ClassDB::bind_method(D_METHOD("get_sample_rate"), &AudioStreamP3::get_sample_rate);
+    ClassDB::bind_method(D_METHOD("get_channels"), &AudioStreamP3::get_channels);
+
+    // index_data is listed first so a loaded resource restores it before set_data
+    ADD_PROPERTY(PropertyInfo(Variant::PACKED_BYTE_ARRAY, "index_data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_index_data", "get_index_data");
+    ADD_PROPERTY(PropertyInfo(Variant::PACKED_BYTE_ARRAY, "data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_data", "get_data");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "loop"), "set_loop", "has_loop");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "output_rate", PROPERTY_HINT_ENUM, "Auto:0,8000 Hz:8000,12000 Hz:12000,16000 Hz:16000,24000 Hz:24000,48000 Hz:48000"), "set_output_rate", "get_output_rate");
+}
+
+AudioStreamP3::AudioStreamP3() {
+    index.instantiate();
+    output_rate = opus_config::SAMPLE_RATE_AUTO;
+    loop = false;
+}
+
+AudioStreamP3::~AudioStreamP3() {
+}
+
+Ref<AudioStreamP3> AudioStreamP3::load_from_file(const String& file_path) {
+    Ref<AudioStreamP3> stream;
+
+    PackedByteArray p3_data = FileAccess::get_file_as_bytes(file_path);
+    if (p3_data.size() == 0) {
+        CODEC_LOG_ERROR("AudioStreamP3: Failed to read ", file_path);
+        return stream;
+    }
+
+    stream.instantiate();
+    stream->set_data(p3_data);
+    return stream;
+}
+
+void AudioStreamP3::set_data(const PackedByteArray& p3_data) {
+    data = p3_data;
+
+    // A stored index is only trusted for the exact data it was saved with
+    // (size and FNV-1a hash); anything else is rebuilt from the headers
+    Ref<P3Index> stored = stored_index;
+    stored_index.unref();
+    if (stored.is_valid()) {
+        if (stored->matches(data)) {
+            index = stored;
+            emit_changed();
+            return;
+        }
+        CODEC_LOG_ERROR("AudioStreamP3: Stored index does not match the stream data, rebuilding it");
+    }
+
+    // Header-only pass for the length and the seek table; no audio is decoded here
+    index.instantiate();
+    if (!index->build(data)) {
+        CODEC_LOG_ERROR("AudioStreamP3: Invalid P3 data, stream will be silent");
+    }
+
+    emit_changed();
+}
+
+PackedByteArray AudioStreamP3::get_data() const {
+    return data;
+}
+
+void AudioStreamP3::set_index_data(const PackedByteArray& index_data) {
+    Ref<P3Index> stored;
+    stored.instantiate();
+    if (index_data.size() == 0 || !stored->deserialize(index_data)) {
+        return;
+    }
+
+    // Loading restores index_data before data; the index waits for set_data
+    // to check it. Data that is already set is checked right away.
+    if (data.size() == 0) {
+        stored_index = stored;
+    } else if (stored->matches(data)) {
+        index = stored;
+    } else {
+        CODEC_LOG_ERROR("AudioStreamP3: Stored index does not match the stream data, ignoring it");
+    }
+}
+
+PackedByteArray AudioStreamP3::get_index_data() const {
+    return index->serialize();
+}
+
+void AudioStreamP3::set_loop(bool enable) {
+    loop = enable;
+}
+
+bool AudioStreamP3::has_loop() const {
+    return loop;
+}
+
+void AudioStreamP3::set_output_rate(int rate) {
+    if (rate != opus_config::SAMPLE_RATE_AUTO && !opus_config::is_valid_sample_rate(rate)) {
+        CODEC_LOG_ERROR("AudioStreamP3: Unsupported output rate ", rate);
+        return;
+    }
+    output_rate = rate;
+}
+
+Ref<P3Index> AudioStreamP3::get_index() const {
+    return index;
+}
+
+int AudioStreamP3::get_packet_count() const {
+    return index->get_packet_count();
+}
+
+Ref<AudioStreamPlayback> AudioStreamP3::_instantiate_playback() const {
+    Ref<AudioStreamPlaybackP3> playback;
+    playback.instantiate();
+    playback->stream = Ref<AudioStreamP3>(const_cast<AudioStreamP3*>(this));
+    playback->sample_rate = resolve_output_rate(output_rate);
+    playback->data = data;
+    playback->index = index;
+    return playback;
+}
+
+String AudioStreamP3::_get_stream_name() const {
+    return "";
+}
+
+double AudioStreamP3::_get_length() const {
+    return index->get_duration();
+}
+
+bool AudioStreamP3::_is_monophonic() const {
+    return false;
+}
@@ -0,0 +1,120 @@
+#ifndef AUDIO_STREAM_P3_H
+#define AUDIO_STREAM_P3_H
+
+#include <godot_cpp/classes/audio_frame.hpp>
+#include <godot_cpp/classes/audio_stream.hpp>
+#include <godot_cpp/classes/audio_stream_playback_resampled.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include "opus_config.h"
+#include "p3_index.h"
+
+// Forward declaration for Opus
+struct OpusDecoder;
+
+using namespace godot;
+
+class AudioStreamP3;
+
+// Playback instance: keeps its own Opus decoder and decodes one packet at a
+// time just ahead of the mixer's read position.
+class AudioStreamPlaybackP3 : public AudioStreamPlaybackResampled {
+    GDCLASS(AudioStreamPlaybackP3, AudioStreamPlaybackResampled)
+
+    friend class AudioStreamP3;
+
+private:
+    static constexpr int CHANNELS = 1;         // Mono channel
+    static constexpr int MAX_FRAME_SIZE = opus_config::MAX_SAMPLE_RATE * opus_config::MAX_FRAME_MS / 1000;  // 120ms at the highest rate
+    static constexpr int SEEK_PREROLL_PACKETS = 2;  // Packets decoded and dropped before a seek target
+
+    Ref<AudioStreamP3> stream;
+    PackedByteArray data;  // Shared (copy-on-write) view of the stream's P3 bytes
+    Ref<P3Index> index;
+
+    OpusDecoder* decoder;
+    int sample_rate;       // Decode rate, fixed when the playback is instantiated
+    int16_t pcm_buffer[MAX_FRAME_SIZE * CHANNELS];
+    int pcm_pos;           // Next sample to hand to the mixer
+    int pcm_len;           // Samples currently held in pcm_buffer
+
+    int64_t data_pos;      // Read position of the next P3 header
+    int64_t played_samples;
+    int loops;
+    bool active;
+
+    bool decode_next_packet();
+    void rewind();
+
+protected:
+    static void _bind_methods();
+
+public:
+    AudioStreamPlaybackP3();
+    ~AudioStreamPlaybackP3();
+
+    void _start(double p_from_pos) override;
+    void _stop() override;
+    bool _is_playing() const override;
+    int32_t _get_loop_count() const override;
+    double _get_playback_position() const override;
+    void _seek(double p_position) override;
+
+    int32_t _mix_resampled(AudioFrame* p_dst_buffer, int32_t p_frame_count) override;
+    float _get_stream_sampling_rate() const override;
+};
+
+// Resource holding compressed P3 bytes; decoding happens in the playback.
+class AudioStreamP3 : public AudioStream {
+    GDCLASS(AudioStreamP3, AudioStream)
+
+    friend class AudioStreamPlaybackP3;
+
+private:
+    static constexpr int SAMPLE_RATE = 16000;  // Fixed sample rate at 16000Hz
+    static constexpr int CHANNELS = 1;         // Mono channel
+
+    PackedByteArray data;
+    Ref<P3Index> index;
+    Ref<P3Index> stored_index;  // From set_index_data; used only once its hash matches the data
+    int output_rate;            // Playback decode rate, or SAMPLE_RATE_AUTO for the mix rate
+    bool loop;
+
+protected:
+    static void _bind_methods();
+
+public:
+    AudioStreamP3();
+    ~AudioStreamP3();
+
+    // Load a .p3 file into a new stream (only the compressed bytes are kept)
+    static Ref<AudioStreamP3> load_from_file(const String& file_path);
+
+    void set_data(const PackedByteArray& p3_data);
+    PackedByteArray get_data() const;
+
+    // Serialized packet index, stored next to the data in imported resources
+    // so loading skips the header scan
+    void set_index_data(const PackedByteArray& index_data);
+    PackedByteArray get_index_data() const;
+
+    void set_loop(bool enable);
+    bool has_loop() const;
+
+    // Rate the playback decodes at. SAMPLE_RATE_AUTO (the default) matches the
+    // mix rate, so the engine's resampler runs at 1:1 instead of upsampling.
+    void set_output_rate(int rate);
+    int get_output_rate() const { return output_rate; }
+
+    Ref<P3Index> get_index() const;
+    int get_packet_count() const;
+    int get_sample_rate() const { return SAMPLE_RATE; }
+    int get_channels() const { return CHANNELS; }
+
+    Ref<AudioStreamPlayback> _instantiate_playback() const override;
+    String _get_stream_name() const override;
+    double _get_length() const override;
+    bool _is_monophonic() const override;
+};
+
+#endif // AUDIO_STREAM_P3_H
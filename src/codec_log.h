@@ -0,0 +1,48 @@
+#ifndef CODEC_LOG_H
+#define CODEC_LOG_H
+
+#include <godot_cpp/variant/utility_functions.hpp>
+#include <atomic>
+
+// Runtime log verbosity shared by all codec classes. The macros test the level
+// before evaluating their arguments, so a disabled message costs one relaxed
+// load and a branch. Set from script with CodecMetrics.set_log_level().
+namespace codec_log {
+
+enum Level {
+    LEVEL_SILENT,
+    LEVEL_ERROR,    // Failures the caller should know about (default)
+    LEVEL_INFO,     // One line per session, file or batch
+    LEVEL_VERBOSE,  // Per-packet progress
+};
+
+extern std::atomic<int> level;
+
+inline bool enabled(int message_level) {
+    return level.load(std::memory_order_relaxed) >= message_level;
+}
+
+} // namespace codec_log
+
+#define CODEC_LOG_ERROR(...)                                                  \
+    do {                                                                      \
+        if (codec_log::enabled(codec_log::LEVEL_ERROR)) {                     \
+            godot::UtilityFunctions::print(__VA_ARGS__);                      \
+        }                                                                     \
+    } while (0)
+
+#define CODEC_LOG_INFO(...)                                                   \
+    do {                                                                      \
+        if (codec_log::enabled(codec_log::LEVEL_INFO)) {                      \
+            godot::UtilityFunctions::print(__VA_ARGS__);                      \
+        }                                                                     \
+    } while (0)
+
+#define CODEC_LOG_VERBOSE(...)                                                \
+    do {                                                                      \
+        if (codec_log::enabled(codec_log::LEVEL_VERBOSE)) {                   \
+            godot::UtilityFunctions::print(__VA_ARGS__);                      \
+        }                                                                     \
+    } while (0)
+
+#endif // CODEC_LOG_H
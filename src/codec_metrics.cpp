@@ -0,0 +1,236 @@
+#include "codec_metrics.h"
+#include "codec_log.h"
+#include <godot_cpp/classes/performance.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <atomic>
+#include <chrono>
+
+using namespace godot;
+
+namespace codec_log {
+
+std::atomic<int> level(LEVEL_ERROR);
+
+} // namespace codec_log
+
+namespace {
+
+struct Counters {
+    std::atomic<int64_t> decoded_packets{0};
+    std::atomic<int64_t> decoded_bytes_in{0};
+    std::atomic<int64_t> decoded_bytes_out{0};
+    std::atomic<int64_t> decode_usec{0};
+    std::atomic<int64_t> decoded_audio_usec{0};
+    std::atomic<int64_t> encoded_packets{0};
+    std::atomic<int64_t> encoded_bytes_in{0};
+    std::atomic<int64_t> encoded_bytes_out{0};
+    std::atomic<int64_t> encode_usec{0};
+    std::atomic<int64_t> encoded_audio_usec{0};
+    std::atomic<int64_t> allocations{0};
+    std::atomic<int64_t> errors{0};
+    std::atomic<int64_t> concealed_frames{0};
+    std::atomic<int64_t> fec_recovered_frames{0};
+};
+
+Counters counters;
+
+inline void add(std::atomic<int64_t>& counter, int64_t value) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+inline int64_t load(const std::atomic<int64_t>& counter) {
+    return counter.load(std::memory_order_relaxed);
+}
+
+double usec_per_second(const std::atomic<int64_t>& usec, const std::atomic<int64_t>& audio_usec) {
+    int64_t audio = load(audio_usec);
+    return audio > 0 ? (double)load(usec) * 1000000.0 / audio : 0.0;
+}
+
+const char* const MONITOR_PREFIX = "P3Opus/";
+
+struct Monitor {
+    const char* name;
+    Callable (*make_callable)();
+};
+
+template <typename R>
+Callable static_callable(R (*getter)()) {
+    return callable_mp_static(getter);
+}
+
+const Monitor MONITORS[] = {
+    { "decoded_packets", [] { return static_callable(&CodecMetrics::get_decoded_packets); } },
+    { "decoded_bytes_in", [] { return static_callable(&CodecMetrics::get_decoded_bytes_in); } },
+    { "decoded_bytes_out", [] { return static_callable(&CodecMetrics::get_decoded_bytes_out); } },
+    { "encoded_packets", [] { return static_callable(&CodecMetrics::get_encoded_packets); } },
+    { "encoded_bytes_in", [] { return static_callable(&CodecMetrics::get_encoded_bytes_in); } },
+    { "encoded_bytes_out", [] { return static_callable(&CodecMetrics::get_encoded_bytes_out); } },
+    { "decode_usec_per_second", [] { return static_callable(&CodecMetrics::get_decode_usec_per_second); } },
+    { "encode_usec_per_second", [] { return static_callable(&CodecMetrics::get_encode_usec_per_second); } },
+    { "allocations", [] { return static_callable(&CodecMetrics::get_allocations); } },
+    { "errors", [] { return static_callable(&CodecMetrics::get_errors); } },
+    { "concealed_frames", [] { return static_callable(&CodecMetrics::get_concealed_frames); } },
+    { "fec_recovered_frames", [] { return static_callable(&CodecMetrics::get_fec_recovered_frames); } },
+};
+
+} // namespace
+
+void CodecMetrics::_bind_methods() {
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_decoded_packets"), &CodecMetrics::get_decoded_packets);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_decoded_bytes_in"), &CodecMetrics::get_decoded_bytes_in);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_decoded_bytes_out"), &CodecMetrics::get_decoded_bytes_out);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_encoded_packets"), &CodecMetrics::get_encoded_packets);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_encoded_bytes_in"), &CodecMetrics::get_encoded_bytes_in);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_encoded_bytes_out"), &CodecMetrics::get_encoded_bytes_out);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_decode_usec_per_second"), &CodecMetrics::get_decode_usec_per_second);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_encode_usec_per_second"), &CodecMetrics::get_encode_usec_per_second);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_allocations"), &CodecMetrics::get_allocations);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_errors"), &CodecMetrics::get_errors);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_concealed_frames"), &CodecMetrics::get_concealed_frames);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_fec_recovered_frames"), &CodecMetrics::get_fec_recovered_frames);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("reset"), &CodecMetrics::reset);
+
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("set_log_level", "level"), &CodecMetrics::set_log_level);
+    ClassDB::bind_static_method("CodecMetrics", D_METHOD("get_log_level"), &CodecMetrics::get_log_level);
+
+    BIND_ENUM_CONSTANT(LOG_SILENT);
+    BIND_ENUM_CONSTANT(LOG_ERROR);
+    BIND_ENUM_CONSTANT(LOG_INFO);
+    BIND_ENUM_CONSTANT(LOG_VERBOSE);
+}
+
+uint64_t CodecMetrics::now_usec() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ========== Recording ==========
+
+void CodecMetrics::record_decode(int64_t packets, int64_t bytes_in, int64_t bytes_out, uint64_t elapsed_usec, int64_t audio_usec) {
+    add(counters.decoded_packets, packets);
+    add(counters.decoded_bytes_in, bytes_in);
+    add(counters.decoded_bytes_out, bytes_out);
+    add(counters.decode_usec, (int64_t)elapsed_usec);
+    add(counters.decoded_audio_usec, audio_usec);
+}
+
+void CodecMetrics::record_encode(int64_t packets, int64_t bytes_in, int64_t bytes_out, uint64_t elapsed_usec, int64_t audio_usec) {
+    add(counters.encoded_packets, packets);
+    add(counters.encoded_bytes_in, bytes_in);
+    add(counters.encoded_bytes_out, bytes_out);
+    add(counters.encode_usec, (int64_t)elapsed_usec);
+    add(counters.encoded_audio_usec, audio_usec);
+}
+
+void CodecMetrics::record_allocation(int64_t count) {
+    add(counters.allocations, count);
+}
+
+void CodecMetrics::record_error() {
+    add(counters.errors, 1);
+}
+
+void CodecMetrics::record_concealed(int64_t frames) {
+    add(counters.concealed_frames, frames);
+}
+
+void CodecMetrics::record_fec_recovered(int64_t frames) {
+    add(counters.fec_recovered_frames, frames);
+}
+
+// ========== Performance Monitors ==========
+
+void CodecMetrics::register_monitors() {
+    Performance* performance = Performance::get_singleton();
+    for (const Monitor& monitor : MONITORS) {
+        StringName id = String(MONITOR_PREFIX) + monitor.name;
+        if (!performance->has_custom_monitor(id)) {
+            performance->add_custom_monitor(id, monitor.make_callable());
+        }
+    }
+}
+
+void CodecMetrics::unregister_monitors() {
+    Performance* performance = Performance::get_singleton();
+    if (performance == nullptr) {
+        return;
+    }
+    for (const Monitor& monitor : MONITORS) {
+        StringName id = String(MONITOR_PREFIX) + monitor.name;
+        if (performance->has_custom_monitor(id)) {
+            performance->remove_custom_monitor(id);
+        }
+    }
+}
+
+// ========== Counters ==========
+
+int64_t CodecMetrics::get_decoded_packets() {
+    return load(counters.decoded_packets);
+}
+
+int64_t CodecMetrics::get_decoded_bytes_in() {
+    return load(counters.decoded_bytes_in);
+}
+
+int64_t CodecMetrics::get_decoded_bytes_out() {
+    return load(counters.decoded_bytes_out);
+}
+
+int64_t CodecMetrics::get_encoded_packets() {
+    return load(counters.encoded_packets);
+}
+
+int64_t CodecMetrics::get_encoded_bytes_in() {
+    return load(counters.encoded_bytes_in);
+}
+
+int64_t CodecMetrics::get_encoded_bytes_out() {
+    return load(counters.encoded_bytes_out);
+}
+
+double CodecMetrics::get_decode_usec_per_second() {
+    return usec_per_second(counters.decode_usec, counters.decoded_audio_usec);
+}
+
+double CodecMetrics::get_encode_usec_per_second() {
+    return usec_per_second(counters.encode_usec, counters.encoded_audio_usec);
+}
+
+int64_t CodecMetrics::get_allocations() {
+    return load(counters.allocations);
+}
+
+int64_t CodecMetrics::get_errors() {
+    return load(counters.errors);
+}
+
+int64_t CodecMetrics::get_concealed_frames() {
+    return load(counters.concealed_frames);
+}
+
+int64_t CodecMetrics::get_fec_recovered_frames() {
+    return load(counters.fec_recovered_frames);
+}
+
+void CodecMetrics::reset() {
+    std::atomic<int64_t>* all[] = {
+        &counters.decoded_packets, &counters.decoded_bytes_in, &counters.decoded_bytes_out,
+        &counters.decode_usec, &counters.decoded_audio_usec,
+        &counters.encoded_packets, &counters.encoded_bytes_in, &counters.encoded_bytes_out,
+        &counters.encode_usec, &counters.encoded_audio_usec,
+        &counters.allocations, &counters.errors, &counters.concealed_frames, &counters.fec_recovered_frames,
+    };
+    for (std::atomic<int64_t>* counter : all) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+}
+
+void CodecMetrics::set_log_level(LogLevel p_level) {
+    codec_log::level.store(p_level, std::memory_order_relaxed);
+}
+
+CodecMetrics::LogLevel CodecMetrics::get_log_level() {
+    return (LogLevel)codec_log::level.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,65 @@
+#ifndef CODEC_METRICS_H
+#define CODEC_METRICS_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <cstdint>
+
+using namespace godot;
+
+// Process-wide codec counters, published as Performance custom monitors under
+// "P3Opus/". Codec classes accumulate locally and record once per call (or per
+// packet where a call decodes a single packet), so the counters add a few
+// relaxed atomic adds per call. All methods are static and thread-safe.
+class CodecMetrics : public RefCounted {
+    GDCLASS(CodecMetrics, RefCounted)
+
+public:
+    enum LogLevel {
+        LOG_SILENT,
+        LOG_ERROR,
+        LOG_INFO,
+        LOG_VERBOSE,
+    };
+
+protected:
+    static void _bind_methods();
+
+public:
+    // Monotonic clock for the timing counters
+    static uint64_t now_usec();
+
+    // Recording (C++ only). audio_usec is the duration of the audio processed.
+    static void record_decode(int64_t packets, int64_t bytes_in, int64_t bytes_out, uint64_t elapsed_usec, int64_t audio_usec);
+    static void record_encode(int64_t packets, int64_t bytes_in, int64_t bytes_out, uint64_t elapsed_usec, int64_t audio_usec);
+    static void record_allocation(int64_t count = 1);
+    static void record_error();
+    static void record_concealed(int64_t frames);
+    static void record_fec_recovered(int64_t frames);
+
+    // Performance monitor registration (module init/uninit)
+    static void register_monitors();
+    static void unregister_monitors();
+
+    // Counters
+    static int64_t get_decoded_packets();
+    static int64_t get_decoded_bytes_in();
+    static int64_t get_decoded_bytes_out();
+    static int64_t get_encoded_packets();
+    static int64_t get_encoded_bytes_in();
+    static int64_t get_encoded_bytes_out();
+    static double get_decode_usec_per_second();   // Decode time per second of decoded audio
+    static double get_encode_usec_per_second();   // Encode time per second of encoded audio
+    static int64_t get_allocations();
+    static int64_t get_errors();
+    static int64_t get_concealed_frames();
+    static int64_t get_fec_recovered_frames();
+    static void reset();
+
+    // Log verbosity of every codec class (default LOG_ERROR)
+    static void set_log_level(LogLevel level);
+    static LogLevel get_log_level();
+};
+
+VARIANT_ENUM_CAST(CodecMetrics::LogLevel);
+
+#endif // CODEC_METRICS_H
@@ -0,0 +1,265 @@
+#include "audio_kernels.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIO_KERNELS_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define AUDIO_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audio_kernels {
+
+static inline int16_t saturate_sample(float value) {
+    if (value >= 32767.0f) {
+        return 32767;
+    }
+    if (value <= -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)lrintf(value);
+}
+
+void accumulate_int16(float* acc, const int16_t* src, int count, float gain) {
+    int i = 0;
+
+#if defined(AUDIO_KERNELS_SSE2)
+    const __m128 gain4 = _mm_set1_ps(gain);
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // Sign-extend int16 to int32 by unpacking into the high half and shifting back
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        __m128 acc_low = _mm_loadu_ps(acc + i);
+        __m128 acc_high = _mm_loadu_ps(acc + i + 4);
+        acc_low = _mm_add_ps(acc_low, _mm_mul_ps(_mm_cvtepi32_ps(low), gain4));
+        acc_high = _mm_add_ps(acc_high, _mm_mul_ps(_mm_cvtepi32_ps(high), gain4));
+        _mm_storeu_ps(acc + i, acc_low);
+        _mm_storeu_ps(acc + i + 4, acc_high);
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t samples = vld1q_s16(src + i);
+        float32x4_t low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples)));
+        float32x4_t high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples)));
+        vst1q_f32(acc + i, vmlaq_n_f32(vld1q_f32(acc + i), low, gain));
+        vst1q_f32(acc + i + 4, vmlaq_n_f32(vld1q_f32(acc + i + 4), high, gain));
+    }
+#endif
+
+    for (; i < count; i++) {
+        acc[i] += src[i] * gain;
+    }
+}
+
+void saturate_to_int16(const float* src, int16_t* dst, int count) {
+    int i = 0;
+
+#if defined(AUDIO_KERNELS_SSE2)
+    const __m128 max4 = _mm_set1_ps(32767.0f);
+    const __m128 min4 = _mm_set1_ps(-32768.0f);
+    for (; i + 8 <= count; i += 8) {
+        // Clamp before converting: out-of-range cvtps gives INT_MIN
+        __m128 low = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i), max4), min4);
+        __m128 high = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i + 4), max4), min4);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int32x4_t low = vcvtnq_s32_f32(vld1q_f32(src + i));
+        int32x4_t high = vcvtnq_s32_f32(vld1q_f32(src + i + 4));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = saturate_sample(src[i]);
+    }
+}
+
+void upmix_mono_to_stereo(const float* src, float* dst, int frames, float gain) {
+    int i = 0;
+
+#if defined(AUDIO_KERNELS_SSE2)
+    const __m128 gain4 = _mm_set1_ps(gain);
+    for (; i + 4 <= frames; i += 4) {
+        __m128 samples = _mm_mul_ps(_mm_loadu_ps(src + i), gain4);
+        // Duplicate every sample into its left/right pair
+        _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(samples, samples));
+        _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(samples, samples));
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t samples = vmulq_n_f32(vld1q_f32(src + i), gain);
+        float32x4x2_t pairs = { { samples, samples } };
+        vst2q_f32(dst + i * 2, pairs);
+    }
+#endif
+
+    for (; i < frames; i++) {
+        float sample = src[i] * gain;
+        dst[i * 2] = sample;
+        dst[i * 2 + 1] = sample;
+    }
+}
+
+void scale(const float* src, float* dst, int count, float gain) {
+    int i = 0;
+
+#if defined(AUDIO_KERNELS_SSE2)
+    const __m128 gain4 = _mm_set1_ps(gain);
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), gain4));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_loadu_ps(src + i + 4), gain4));
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    for (; i + 8 <= count; i += 8) {
+        vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(src + i), gain));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vld1q_f32(src + i + 4), gain));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = src[i] * gain;
+    }
+}
+
+void downmix_stereo_to_mono(const float* src, float* dst, int frames) {
+    int i = 0;
+
+#if defined(AUDIO_KERNELS_SSE2)
+    const __m128 half4 = _mm_set1_ps(0.5f);
+    for (; i + 4 <= frames; i += 4) {
+        __m128 first = _mm_loadu_ps(src + i * 2);
+        __m128 second = _mm_loadu_ps(src + i * 2 + 4);
+        // Deinterleave four frames into left and right lanes
+        __m128 left = _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 right = _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_add_ps(left, right), half4));
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t pairs = vld2q_f32(src + i * 2);
+        vst1q_f32(dst + i, vmulq_n_f32(vaddq_f32(pairs.val[0], pairs.val[1]), 0.5f));
+    }
+#endif
+
+    for (; i < frames; i++) {
+        dst[i] = (src[i * 2] + src[i * 2 + 1]) * 0.5f;
+    }
+}
+
+float dot_product(const float* a, const float* b, int count) {
+    int i = 0;
+    float sum = 0.0f;
+
+#if defined(AUDIO_KERNELS_SSE2)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    // Horizontal sum of the four lanes
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+    sum = _mm_cvtss_f32(acc0);
+#elif defined(AUDIO_KERNELS_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= count; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+float sum_squares_int16(const int16_t* src, int count) {
+    int i = 0;
+    float sum = 0.0f;
+
+#if defined(AUDIO_KERNELS_SSE2)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+        __m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(low, low));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(high, high));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+    sum = _mm_cvtss_f32(acc0);
+#elif defined(AUDIO_KERNELS_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t samples = vld1q_s16(src + i);
+        float32x4_t low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples)));
+        float32x4_t high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples)));
+        acc0 = vmlaq_f32(acc0, low, low);
+        acc1 = vmlaq_f32(acc1, high, high);
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+
+    for (; i < count; i++) {
+        float sample = src[i];
+        sum += sample * sample;
+    }
+    return sum;
+}
+
+int peak_abs_int16(const int16_t* src, int count) {
+    int i = 0;
+    int max_value = 0;
+    int min_value = 0;
+
+#if defined(AUDIO_KERNELS_SSE2)
+    __m128i max8 = _mm_setzero_si128();
+    __m128i min8 = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        max8 = _mm_max_epi16(max8, samples);
+        min8 = _mm_min_epi16(min8, samples);
+    }
+    // Track max and min separately; negating -32768 in 16 bits would overflow
+    alignas(16) int16_t max_lanes[8];
+    alignas(16) int16_t min_lanes[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(max_lanes), max8);
+    _mm_store_si128(reinterpret_cast<__m128i*>(min_lanes), min8);
+    for (int lane = 0; lane < 8; lane++) {
+        max_value = max_lanes[lane] > max_value ? max_lanes[lane] : max_value;
+        min_value = min_lanes[lane] < min_value ? min_lanes[lane] : min_value;
+    }
+#elif defined(AUDIO_KERNELS_NEON)
+    int16x8_t max8 = vdupq_n_s16(0);
+    int16x8_t min8 = vdupq_n_s16(0);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t samples = vld1q_s16(src + i);
+        max8 = vmaxq_s16(max8, samples);
+        min8 = vminq_s16(min8, samples);
+    }
+    max_value = vmaxvq_s16(max8);
+    min_value = vminvq_s16(min8);
+#endif
+
+    for (; i < count; i++) {
+        max_value = src[i] > max_value ? src[i] : max_value;
+        min_value = src[i] < min_value ? src[i] : min_value;
+    }
+    return max_value > -min_value ? max_value : -min_value;
+}
+
+} // namespace audio_kernels
@@ -0,0 +1,40 @@
+#ifndef AUDIO_KERNELS_H
+#define AUDIO_KERNELS_H
+
+#include <cstdint>
+
+// Vectorized sample kernels used by the mixing and conversion paths.
+// Each kernel has an SSE2 (x86/x86_64) and NEON (arm64) body and a scalar
+// fallback; all bodies produce the same results (float -> int16 rounds to
+// nearest and saturates).
+namespace audio_kernels {
+
+// acc[i] += src[i] * gain
+void accumulate_int16(float* acc, const int16_t* src, int count, float gain);
+
+// dst[i] = clamp(round(src[i]), -32768, 32767)
+void saturate_to_int16(const float* src, int16_t* dst, int count);
+
+// dst[2i] = dst[2i+1] = src[i] * gain (mono to interleaved stereo frames)
+void upmix_mono_to_stereo(const float* src, float* dst, int frames, float gain);
+
+// dst[i] = src[i] * gain
+void scale(const float* src, float* dst, int count, float gain);
+
+// dst[i] = (src[2i] + src[2i+1]) * 0.5 (interleaved stereo frames to mono)
+void downmix_stereo_to_mono(const float* src, float* dst, int frames);
+
+// sum(a[i] * b[i]); the vector bodies sum in a different order than the
+// scalar fallback, so results may differ in the last bits
+float dot_product(const float* a, const float* b, int count);
+
+// sum(src[i]^2) in float (frame energy for level metering and VAD); same
+// summation-order caveat as dot_product
+float sum_squares_int16(const int16_t* src, int count);
+
+// max(|src[i]|), 0 for count <= 0 (|-32768| is reported as 32768)
+int peak_abs_int16(const int16_t* src, int count);
+
+} // namespace audio_kernels
+
+#endif // AUDIO_KERNELS_H
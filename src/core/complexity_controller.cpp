@@ -0,0 +1,96 @@
+#include "complexity_controller.h"
+
+namespace {
+
+constexpr double AVERAGE_WEIGHT = 0.1;      // Weight of the newest sample in the moving average
+constexpr double RAISE_USAGE = 0.6;         // Budget usage below which a level may be given back
+constexpr int RAISE_FRAMES = 25;            // Frames the usage must stay below RAISE_USAGE first
+constexpr int SETTLE_FRAMES = 8;            // Frames measured at a new level before deciding again
+constexpr int MIN_BITRATE = 6000;           // Opus' lowest useful bitrate
+
+} // namespace
+
+ComplexityController::ComplexityController() {
+    configure(2000, 10, 24000, false);
+}
+
+void ComplexityController::configure(int p_budget_usec, int p_max_complexity, int p_target_bitrate, bool p_adapt_bitrate) {
+    budget_usec = p_budget_usec > 0 ? p_budget_usec : 1;
+    max_complexity = p_max_complexity < 0 ? 0 : (p_max_complexity > 10 ? 10 : p_max_complexity);
+    target_bitrate = p_target_bitrate;
+    min_bitrate = target_bitrate / 2 > MIN_BITRATE ? target_bitrate / 2 : MIN_BITRATE;
+    adapt_bitrate = p_adapt_bitrate;
+    changes = 0;
+    reset();
+}
+
+void ComplexityController::reset() {
+    complexity = max_complexity;
+    bitrate = target_bitrate;
+    average_usec = 0.0;
+    primed = false;
+    settle_left = 0;
+    under_frames = 0;
+}
+
+bool ComplexityController::record(double encode_usec) {
+    if (!primed) {
+        average_usec = encode_usec;
+        primed = true;
+    } else {
+        average_usec += (encode_usec - average_usec) * AVERAGE_WEIGHT;
+    }
+
+    if (settle_left > 0) {
+        settle_left--;
+        return false;
+    }
+
+    double usage = average_usec / budget_usec;
+    if (usage > 1.0) {
+        under_frames = 0;
+        return step_down();
+    }
+
+    if (usage < RAISE_USAGE) {
+        if (++under_frames >= RAISE_FRAMES) {
+            under_frames = 0;
+            return step_up();
+        }
+    } else {
+        under_frames = 0;
+    }
+    return false;
+}
+
+bool ComplexityController::step_down() {
+    if (complexity > 0) {
+        complexity--;
+    } else if (adapt_bitrate && bitrate > min_bitrate) {
+        bitrate = bitrate * 3 / 4 > min_bitrate ? bitrate * 3 / 4 : min_bitrate;
+    } else {
+        return false;
+    }
+
+    // The average belongs to the old level; measure the new one from scratch
+    primed = false;
+    settle_left = SETTLE_FRAMES;
+    changes++;
+    return true;
+}
+
+bool ComplexityController::step_up() {
+    // Undo in reverse order: bitrate first, then complexity
+    if (bitrate < target_bitrate) {
+        bitrate = bitrate * 4 / 3 < target_bitrate ? bitrate * 4 / 3 : target_bitrate;
+    } else if (complexity < max_complexity) {
+        complexity++;
+    } else {
+        return false;
+    }
+
+    primed = false;
+    settle_left = SETTLE_FRAMES;
+    changes++;
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef COMPLEXITY_CONTROLLER_H
+#define COMPLEXITY_CONTROLLER_H
+
+#include <cstdint>
+
+// Keeps the average cost of opus_encode under a per-frame CPU budget. Encode
+// times feed an exponential moving average; when it goes over the budget the
+// complexity is stepped down (then, optionally, the bitrate), and once it has
+// stayed well under the budget for a while the steps are undone in reverse
+// order. The gap between the two thresholds and the settle time after every
+// change keep the level from oscillating.
+class ComplexityController {
+public:
+    ComplexityController();
+
+    // Start again at max_complexity and target_bitrate. budget_usec is the
+    // allowed average encode time per frame; the bitrate is only lowered (down
+    // to half of target_bitrate) when adapt_bitrate is set.
+    void configure(int budget_usec, int max_complexity, int target_bitrate, bool adapt_bitrate);
+
+    // Feed the measured encode time of one frame; returns true when the
+    // complexity or bitrate changed and has to be applied to the encoder
+    bool record(double encode_usec);
+
+    void reset();
+
+    int get_complexity() const { return complexity; }
+    int get_bitrate() const { return bitrate; }
+    int get_budget_usec() const { return budget_usec; }
+    double get_average_usec() const { return average_usec; }
+    double get_budget_usage() const { return budget_usec > 0 ? average_usec / budget_usec : 0.0; }
+    int64_t get_changes() const { return changes; }
+
+private:
+    int budget_usec;
+    int max_complexity;
+    int target_bitrate;
+    int min_bitrate;
+    bool adapt_bitrate;
+
+    int complexity;
+    int bitrate;
+    double average_usec;
+    bool primed;            // average_usec holds at least one sample of the current level
+    int settle_left;        // Frames to wait after a change before the next decision
+    int under_frames;       // Consecutive frames below the raise threshold
+    int64_t changes;
+
+    bool step_down();
+    bool step_up();
+};
+
+#endif // COMPLEXITY_CONTROLLER_H
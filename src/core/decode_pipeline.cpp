@@ -0,0 +1,103 @@
+#include "decode_pipeline.h"
+#include <cstring>
+
+DecodePipeline::DecodePipeline()
+    : decoder(nullptr), sample_rate(0), channels(1), max_frame_size(0),
+      worker_scheduled(false), pushed_packets(0), decoded_packets(0), decode_errors(0),
+      overruns(0), underruns(0), underrun_frames(0) {}
+
+void DecodePipeline::configure(OpusDecoder* p_decoder, int p_sample_rate, int p_channels, int p_max_frame_size,
+                               int packet_ring_bytes, int pcm_ring_frames) {
+    decoder = p_decoder;
+    sample_rate = p_sample_rate;
+    channels = p_channels;
+    max_frame_size = p_max_frame_size;
+
+    // Each ring must hold at least one largest record, or it could never drain
+    int min_packet_bytes = p3::HEADER_SIZE + p3::MAX_PACKET_DATA;
+    packet_ring.reset(packet_ring_bytes > min_packet_bytes ? packet_ring_bytes : min_packet_bytes);
+    pcm_ring.reset((size_t)(pcm_ring_frames > max_frame_size ? pcm_ring_frames : max_frame_size) * channels);
+    packet_scratch.resize(min_packet_bytes);
+    pcm_scratch.resize((size_t)max_frame_size * channels);
+    worker_scheduled.store(false, std::memory_order_relaxed);
+    reset_counters();
+}
+
+void DecodePipeline::reset() {
+    packet_ring.reset(packet_ring.capacity());
+    pcm_ring.reset(pcm_ring.capacity());
+    worker_scheduled.store(false, std::memory_order_relaxed);
+    reset_counters();
+}
+
+void DecodePipeline::reset_counters() {
+    pushed_packets.store(0, std::memory_order_relaxed);
+    decoded_packets.store(0, std::memory_order_relaxed);
+    decode_errors.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    underruns.store(0, std::memory_order_relaxed);
+    underrun_frames.store(0, std::memory_order_relaxed);
+}
+
+bool DecodePipeline::push_packet(const uint8_t* data, int size) {
+    if (data == nullptr || !p3::is_valid_data_len(size)) {
+        return false;
+    }
+
+    // Header and payload are published together, so the decode step never
+    // sees a header without its payload
+    uint8_t header[p3::HEADER_SIZE];
+    p3::write_header(header, size);
+    if (!packet_ring.write_all(header, p3::HEADER_SIZE, data, size)) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    pushed_packets.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool DecodePipeline::decode_pending(DecodeStats* stats) {
+    DecodeStats local = {0, 0, 0, 0};
+    bool drained = true;
+
+    while (packet_ring.peek(packet_scratch.data(), p3::HEADER_SIZE) == (size_t)p3::HEADER_SIZE) {
+        int packet_len = p3::header_data_len(packet_scratch.data());
+        packet_ring.peek(packet_scratch.data(), p3::HEADER_SIZE + packet_len);
+        const uint8_t* packet = packet_scratch.data() + p3::HEADER_SIZE;
+
+        // Leave the packet queued until the consumer has made room for it
+        int packet_frames = opus_packet_get_nb_samples(packet, packet_len, sample_rate);
+        if (packet_frames > 0 && (size_t)packet_frames * channels > pcm_ring.free_space()) {
+            drained = false;
+            break;
+        }
+        packet_ring.skip(p3::HEADER_SIZE + packet_len);
+
+        int decoded = opus_decode(decoder, packet, packet_len, pcm_scratch.data(), max_frame_size, 0);
+        if (decoded < 0) {
+            local.errors++;
+            continue;
+        }
+        pcm_ring.write_all(pcm_scratch.data(), (size_t)decoded * channels);
+        local.packets++;
+        local.bytes_in += packet_len;
+        local.frames += decoded;
+    }
+
+    decoded_packets.fetch_add(local.packets, std::memory_order_relaxed);
+    decode_errors.fetch_add(local.errors, std::memory_order_relaxed);
+    if (stats != nullptr) {
+        *stats = local;
+    }
+    return drained;
+}
+
+int DecodePipeline::read_pcm(int16_t* pcm, int frames) {
+    int copied = (int)(pcm_ring.read(pcm, (size_t)frames * channels) / channels);
+    if (copied < frames) {
+        memset(pcm + (size_t)copied * channels, 0, (size_t)(frames - copied) * channels * sizeof(int16_t));
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        underrun_frames.fetch_add(frames - copied, std::memory_order_relaxed);
+    }
+    return copied;
+}
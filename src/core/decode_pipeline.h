@@ -0,0 +1,136 @@
+#ifndef DECODE_PIPELINE_H
+#define DECODE_PIPELINE_H
+
+#include "p3_format.h"
+#include "spsc_ring.h"
+#include <opus.h>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Three-stage Opus decode pipeline for a network thread feeding an audio thread:
+//
+//   producer (network)  --packet ring-->  decode step  --PCM ring-->  consumer (audio)
+//
+// Both rings are lock-free single-producer/single-consumer rings, so each
+// stage may run on its own thread. The decode step may run on the producer
+// thread itself or on a worker, but only one thread may run it at a time.
+// Packets are stored in the packet ring as P3 records (4-byte header plus
+// payload) so they can be framed without a separate length queue.
+//
+// On a worker, request_worker_decode() and run_worker_decode() hand the
+// decode step between the producer and at most one running task, so a task
+// is only started when none is already draining the packet ring.
+//
+// When the consumer falls behind, the decode step stops at the first packet
+// whose PCM does not fit and leaves it queued; once the packet ring is full as
+// well, new packets are dropped and counted as overruns. When the consumer
+// asks for more PCM than is ready, the rest of its buffer is zero-filled and
+// counted as an underrun.
+class DecodePipeline {
+public:
+    // What one decode_pending() call did
+    struct DecodeStats {
+        int packets;
+        int errors;
+        int64_t bytes_in;
+        int64_t frames;     // Samples per channel written to the PCM ring
+    };
+
+    DecodePipeline();
+
+    // Size both rings and clear them and the counters. decoder is used by the
+    // decode step only; max_frame_size is samples per channel of the longest
+    // frame. Not thread-safe: call while no stage is running.
+    void configure(OpusDecoder* decoder, int sample_rate, int channels, int max_frame_size,
+                   int packet_ring_bytes, int pcm_ring_frames);
+
+    // Drop queued packets and PCM and clear the counters. Not thread-safe:
+    // no task may be running.
+    void reset();
+
+    // ----- Producer -----
+
+    // Queue one Opus packet; false when it is empty, too large or the packet
+    // ring is full (counted as an overrun)
+    bool push_packet(const uint8_t* data, int size);
+
+    // ----- Decode step (one thread at a time) -----
+
+    // Decode queued packets into the PCM ring until the packet ring is empty
+    // (returns true) or the next packet's PCM does not fit (returns false)
+    bool decode_pending(DecodeStats* stats = nullptr);
+
+    bool has_pending_packets() const { return packet_ring.available() >= (size_t)p3::HEADER_SIZE; }
+
+    // ----- Worker hand-off -----
+
+    // Producer, after pushing: true when the caller has to start a task that
+    // calls run_worker_decode(); false when a running task will pick the new
+    // packets up itself
+    bool request_worker_decode() { return !worker_scheduled.exchange(true, std::memory_order_acq_rel); }
+
+    // Task body: run decode_step() (which must call decode_pending() and
+    // return its result) until the packet ring is drained. The scheduled flag
+    // is cleared before the last check, so a packet pushed at any point is
+    // either decoded here or makes the producer start a new task. A task that
+    // stopped on a full PCM ring leaves the rest to the next request.
+    template <typename DecodeStep>
+    void run_worker_decode(DecodeStep&& decode_step) {
+        while (true) {
+            bool drained = decode_step();
+            worker_scheduled.store(false, std::memory_order_release);
+            if (!drained || !has_pending_packets() || worker_scheduled.exchange(true, std::memory_order_acq_rel)) {
+                return;
+            }
+        }
+    }
+
+    void run_worker_decode() {
+        run_worker_decode([this]() { return decode_pending(); });
+    }
+
+    // ----- Consumer (wait-free) -----
+
+    // Fill frames samples per channel of interleaved PCM. Returns the frames
+    // taken from the ring; a short read zero-fills the rest and counts one
+    // underrun.
+    int read_pcm(int16_t* pcm, int frames);
+
+    int get_buffered_frames() const { return (int)(pcm_ring.available() / channels); }
+
+    // ----- Counters (readable from any thread) -----
+
+    int64_t get_pushed_packets() const { return pushed_packets.load(std::memory_order_relaxed); }
+    int64_t get_decoded_packets() const { return decoded_packets.load(std::memory_order_relaxed); }
+    int64_t get_decode_errors() const { return decode_errors.load(std::memory_order_relaxed); }
+    int64_t get_overruns() const { return overruns.load(std::memory_order_relaxed); }
+    int64_t get_underruns() const { return underruns.load(std::memory_order_relaxed); }
+    int64_t get_underrun_frames() const { return underrun_frames.load(std::memory_order_relaxed); }
+    void reset_counters();
+
+    int get_channels() const { return channels; }
+    int get_sample_rate() const { return sample_rate; }
+
+private:
+    OpusDecoder* decoder;
+    int sample_rate;
+    int channels;
+    int max_frame_size;
+
+    SpscRing<uint8_t> packet_ring;
+    SpscRing<int16_t> pcm_ring;
+    std::vector<uint8_t> packet_scratch;    // One P3 record, owned by the decode step
+    std::vector<int16_t> pcm_scratch;       // One decoded frame, owned by the decode step
+
+    std::atomic<bool> worker_scheduled;     // A task is running or about to start
+
+    std::atomic<int64_t> pushed_packets;
+    std::atomic<int64_t> decoded_packets;
+    std::atomic<int64_t> decode_errors;
+    std::atomic<int64_t> overruns;          // Packets dropped because the packet ring was full
+    std::atomic<int64_t> underruns;         // Reads that could not be filled completely
+    std::atomic<int64_t> underrun_frames;   // Zero-filled frames handed to the consumer
+};
+
+#endif // DECODE_PIPELINE_H
@@ -0,0 +1,166 @@
+#include "envelope_analyzer.h"
+#include "audio_kernels.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr int BIN_COUNT = EnvelopeAnalyzer::BAND_COUNT * EnvelopeAnalyzer::BINS_PER_BAND;
+
+} // namespace
+
+EnvelopeAnalyzer::EnvelopeAnalyzer()
+    : sample_rate(0), channels(1), window_ms(0), window_frames(0), filled(0), sum_squares(0.0f), peak(0),
+      max_windows(0), dropped_windows(0) {}
+
+bool EnvelopeAnalyzer::configure(int p_sample_rate, int p_channels, int p_window_ms) {
+    output.clear();
+    dropped_windows = 0;
+    filled = 0;
+    sum_squares = 0.0f;
+    peak = 0;
+    window_frames = 0;
+    window_ms = 0;
+    if (p_window_ms <= 0) {
+        return true;
+    }
+    if (p_sample_rate <= 0 || p_channels < 1 || p_channels > 2) {
+        return false;
+    }
+
+    sample_rate = p_sample_rate;
+    channels = p_channels;
+    window_ms = p_window_ms;
+    window_frames = (int)((int64_t)sample_rate * window_ms / 1000);
+    if (window_frames <= 0) {
+        window_frames = 0;
+        window_ms = 0;
+        return false;
+    }
+    mono.assign(window_frames, 0.0f);
+    interleaved.assign((size_t)window_frames * channels, 0.0f);
+
+    // Fold the Hann window, the 1/32768 sample scale and the amplitude
+    // normalization (2 / sum of the window) into the tables. Bins at or above
+    // Nyquist keep all-zero tables and always read 0.
+    std::vector<double> hann(window_frames);
+    double hann_sum = 0.0;
+    for (int n = 0; n < window_frames; n++) {
+        hann[n] = 0.5 - 0.5 * cos(2.0 * PI * (n + 0.5) / window_frames);
+        hann_sum += hann[n];
+    }
+    double scale = 2.0 / (hann_sum * 32768.0);
+
+    bin_tables.assign((size_t)BIN_COUNT * 2 * window_frames, 0.0f);
+    for (int band = 0; band < BAND_COUNT; band++) {
+        double low = BAND_EDGES[band];
+        double width = (BAND_EDGES[band + 1] - low) / BINS_PER_BAND;
+        for (int bin = 0; bin < BINS_PER_BAND; bin++) {
+            double frequency = low + (bin + 0.5) * width;
+            if (frequency >= sample_rate * 0.5) {
+                continue;
+            }
+            float* cos_table = bin_tables.data() + (size_t)(band * BINS_PER_BAND + bin) * 2 * window_frames;
+            float* sin_table = cos_table + window_frames;
+            for (int n = 0; n < window_frames; n++) {
+                double phase = 2.0 * PI * frequency * n / sample_rate;
+                cos_table[n] = (float)(hann[n] * scale * cos(phase));
+                sin_table[n] = (float)(hann[n] * scale * sin(phase));
+            }
+        }
+    }
+    return true;
+}
+
+void EnvelopeAnalyzer::set_max_windows(int p_max_windows) {
+    max_windows = p_max_windows > 0 ? p_max_windows : 0;
+    if (max_windows == 0) {
+        return;
+    }
+    size_t limit = (size_t)max_windows * STRIDE;
+    if (output.size() > limit) {
+        dropped_windows += (int64_t)(output.size() - limit) / STRIDE;
+        output.erase(output.begin(), output.end() - limit);
+    }
+    output.reserve(limit);
+}
+
+void EnvelopeAnalyzer::reserve(int64_t frames) {
+    if (window_frames > 0) {
+        output.reserve(output.size() + (size_t)(frames / window_frames + 1) * STRIDE);
+    }
+}
+
+void EnvelopeAnalyzer::process(const int16_t* pcm, int frames) {
+    while (window_frames > 0 && frames > 0) {
+        int count = window_frames - filled < frames ? window_frames - filled : frames;
+        int samples = count * channels;
+
+        sum_squares += audio_kernels::sum_squares_int16(pcm, samples);
+        int chunk_peak = audio_kernels::peak_abs_int16(pcm, samples);
+        peak = chunk_peak > peak ? chunk_peak : peak;
+
+        // The window buffer is zeroed after each window, so accumulating converts
+        if (channels == 2) {
+            memset(interleaved.data(), 0, samples * sizeof(float));
+            audio_kernels::accumulate_int16(interleaved.data(), pcm, samples, 1.0f);
+            audio_kernels::downmix_stereo_to_mono(interleaved.data(), mono.data() + filled, count);
+        } else {
+            audio_kernels::accumulate_int16(mono.data() + filled, pcm, count, 1.0f);
+        }
+
+        filled += count;
+        pcm += samples;
+        frames -= count;
+        if (filled == window_frames) {
+            emit_window();
+        }
+    }
+}
+
+void EnvelopeAnalyzer::finish() {
+    if (filled > 0) {
+        emit_window();
+    }
+}
+
+void EnvelopeAnalyzer::reset() {
+    output.clear();
+    dropped_windows = 0;
+    filled = 0;
+    sum_squares = 0.0f;
+    peak = 0;
+    if (!mono.empty()) {
+        memset(mono.data(), 0, mono.size() * sizeof(float));
+    }
+}
+
+void EnvelopeAnalyzer::emit_window() {
+    // Shift out the oldest window instead of growing past the reserved size
+    if (max_windows > 0 && output.size() >= (size_t)max_windows * STRIDE) {
+        output.erase(output.begin(), output.begin() + STRIDE);
+        dropped_windows++;
+    }
+
+    float rms = sqrtf(sum_squares / ((float)filled * channels)) / 32768.0f;
+    output.push_back(rms < 1.0f ? rms : 1.0f);
+    output.push_back(peak < 32768 ? peak / 32768.0f : 1.0f);
+
+    for (int band = 0; band < BAND_COUNT; band++) {
+        float power = 0.0f;
+        for (int bin = 0; bin < BINS_PER_BAND; bin++) {
+            const float* cos_table = bin_tables.data() + (size_t)(band * BINS_PER_BAND + bin) * 2 * window_frames;
+            float re = audio_kernels::dot_product(mono.data(), cos_table, window_frames);
+            float im = audio_kernels::dot_product(mono.data(), cos_table + window_frames, window_frames);
+            power += re * re + im * im;
+        }
+        float amplitude = sqrtf(power / BINS_PER_BAND);
+        output.push_back(amplitude < 1.0f ? amplitude : 1.0f);
+    }
+
+    memset(mono.data(), 0, window_frames * sizeof(float));
+    filled = 0;
+    sum_squares = 0.0f;
+    peak = 0;
+}
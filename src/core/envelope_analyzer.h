@@ -0,0 +1,84 @@
+#ifndef ENVELOPE_ANALYZER_H
+#define ENVELOPE_ANALYZER_H
+
+#include <cstdint>
+#include <vector>
+
+// Per-window loudness and band energy of decoded PCM, for lip sync. The
+// decode loops feed each packet right after decoding it, while its samples
+// are still in cache, so the envelope costs no second pass over the PCM.
+//
+// Every window produces STRIDE floats, all linear in [0, 1]:
+//
+//   rms | peak | band 0 | band 1 | band 2 | band 3
+//
+// A band value is the RMS of the amplitudes measured at BINS_PER_BAND
+// frequencies spread across the band. Each one is a Hann-windowed DFT bin
+// scaled so that a sine at that frequency reads its amplitude, computed as two
+// dot products of the mono window against precomputed cos/sin tables, so the
+// whole analysis runs on the vectorized audio kernels.
+class EnvelopeAnalyzer {
+public:
+    static constexpr int BAND_COUNT = 4;
+    static constexpr int STRIDE = 2 + BAND_COUNT;
+    static constexpr int BINS_PER_BAND = 3;
+
+    // Band edges in Hz: jaw/voicing, open vowels, front vowels, fricatives
+    static constexpr float BAND_EDGES[BAND_COUNT + 1] = {150.0f, 500.0f, 1200.0f, 2800.0f, 6000.0f};
+
+    EnvelopeAnalyzer();
+
+    // window_ms <= 0 disables the analyzer; returns false on a bad format
+    bool configure(int sample_rate, int channels, int window_ms);
+
+    bool is_enabled() const { return window_frames > 0; }
+    int get_window_frames() const { return window_frames; }
+    int get_window_ms() const { return window_ms; }
+
+    // Keep at most max_windows windows in the output (0, the default, keeps
+    // every window). The storage is reserved here, so with a limit a
+    // completed window never allocates: when the output is full the oldest
+    // window is dropped and counted.
+    void set_max_windows(int max_windows);
+    int get_max_windows() const { return max_windows; }
+
+    // Analyze frames of interleaved PCM; every completed window is appended
+    // to the output
+    void process(const int16_t* pcm, int frames);
+
+    // Append the trailing partial window, if any (zero-padded)
+    void finish();
+
+    // Reserve output for about frames more samples per channel
+    void reserve(int64_t frames);
+
+    const std::vector<float>& get_output() const { return output; }
+    int get_window_count() const { return (int)(output.size() / STRIDE); }
+    int64_t get_dropped_windows() const { return dropped_windows; }
+
+    // Drop the output; a partial window in progress is kept
+    void clear_output() { output.clear(); }
+
+    // Drop the output, the partial window and the dropped-window counter
+    void reset();
+
+private:
+    int sample_rate;
+    int channels;
+    int window_ms;
+    int window_frames;
+    int filled;                         // Frames of the current window seen so far
+    float sum_squares;                  // Over all channels of the current window
+    int peak;
+    int max_windows;                    // 0 for no limit
+    int64_t dropped_windows;
+
+    std::vector<float> mono;            // Current window as mono floats, zero-padded
+    std::vector<float> interleaved;     // Stereo conversion scratch
+    std::vector<float> bin_tables;      // cos then sin table per bin, window_frames each
+    std::vector<float> output;
+
+    void emit_window();
+};
+
+#endif // ENVELOPE_ANALYZER_H
@@ -0,0 +1,55 @@
+#ifndef OPUS_CONFIG_H
+#define OPUS_CONFIG_H
+
+// Audio configurations accepted by the decoders and the encoder. Opus codes
+// at these rates and channel counts natively; any other combination would
+// need resampling or remixing in front of the codec.
+namespace opus_config {
+
+static constexpr int DEFAULT_SAMPLE_RATE = 16000;
+static constexpr int SAMPLE_RATE_AUTO = 0;  // Decoders: the smallest supported rate at or above the engine mix rate
+static constexpr int DEFAULT_CHANNELS = 1;
+static constexpr int DEFAULT_FRAME_MS = 60;
+
+static constexpr int MAX_SAMPLE_RATE = 48000;
+static constexpr int MAX_CHANNELS = 2;
+static constexpr int MAX_FRAME_MS = 120;  // Longest packet Opus can produce or decode
+
+// Interleaved samples in the longest frame of the largest configuration;
+// sizes fixed buffers that must fit any supported configuration
+static constexpr int MAX_FRAME_CAPACITY = MAX_SAMPLE_RATE * MAX_FRAME_MS / 1000 * MAX_CHANNELS;
+
+inline bool is_valid_sample_rate(int sample_rate) {
+    return sample_rate == 8000 || sample_rate == 12000 || sample_rate == 16000 ||
+           sample_rate == 24000 || sample_rate == 48000;
+}
+
+inline bool is_valid_channels(int channels) {
+    return channels >= 1 && channels <= MAX_CHANNELS;
+}
+
+// Smallest supported rate at or above device_rate (48000 above that), so a
+// decoder can produce audio at the output device rate directly
+inline int output_rate_for(int device_rate) {
+    static constexpr int RATES[] = {8000, 12000, 16000, 24000, 48000};
+    for (int rate : RATES) {
+        if (rate >= device_rate) {
+            return rate;
+        }
+    }
+    return MAX_SAMPLE_RATE;
+}
+
+// Frame durations the encoder accepts (whole milliseconds only)
+inline bool is_valid_frame_ms(int frame_ms) {
+    return frame_ms == 5 || frame_ms == 10 || frame_ms == 20 || frame_ms == 40 || frame_ms == 60;
+}
+
+// Samples per channel in frame_ms at sample_rate
+inline int frame_samples(int sample_rate, int frame_ms) {
+    return sample_rate * frame_ms / 1000;
+}
+
+} // namespace opus_config
+
+#endif // OPUS_CONFIG_H
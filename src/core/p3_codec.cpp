@@ -0,0 +1,130 @@
+#include "p3_codec.h"
+#include "envelope_analyzer.h"
+#include <cstring>
+
+namespace p3 {
+
+template <int Channels>
+ReadResult decode_packets(DecodeState& state, const uint8_t* data, int64_t size, int64_t& pos,
+                          const std::atomic<bool>* cancel) {
+    while (true) {
+        if (cancel != nullptr && cancel->load(std::memory_order_relaxed)) {
+            state.cancelled = true;
+            return READ_OK;
+        }
+
+        // Read p3 header (4 bytes) and locate the Opus payload
+        const uint8_t* packet = nullptr;
+        int data_len = 0;
+        ReadResult read_result = read_packet(data, size, pos, packet, data_len);
+        if (read_result != READ_OK) {
+            return read_result;
+        }
+
+        // Decode Opus data directly into the output at the current write position
+        int64_t remaining = state.pcm_capacity - state.total_pcm_samples;
+        int decoded_samples = opus_decode(state.decoder, packet, data_len,
+                                          state.pcm_out + state.total_pcm_samples * Channels,
+                                          (int)(remaining < state.max_frame_size ? remaining : state.max_frame_size), 0);
+        if (decoded_samples < 0) {
+            state.error = decoded_samples;
+            return READ_OK;
+        }
+
+        if (state.envelope != nullptr) {
+            state.envelope->process(state.pcm_out + state.total_pcm_samples * Channels, decoded_samples);
+        }
+        state.packet_count++;
+        state.total_pcm_samples += decoded_samples;
+    }
+}
+
+template <int Channels>
+int decode_segment(OpusDecoder* decoder, const uint8_t* data, int64_t size, const PacketTable& table,
+                   int sample_rate, int first_packet, int end_packet, int preroll_packets,
+                   int max_frame_size, int16_t* pcm_out, int16_t* scratch) {
+    int decode_from = first_packet > preroll_packets ? first_packet - preroll_packets : 0;
+    int64_t pos = decode_from < table.packet_count ? table.offsets[decode_from] : size;
+
+    for (int i = decode_from; i < end_packet; i++) {
+        const uint8_t* packet = nullptr;
+        int data_len = 0;
+        if (read_packet(data, size, pos, packet, data_len) != READ_OK) {
+            return OPUS_INVALID_PACKET;
+        }
+
+        int decoded_samples;
+        if (i < first_packet) {
+            // Pre-roll: only warms up the decoder state
+            decoded_samples = opus_decode(decoder, packet, data_len, scratch, max_frame_size, 0);
+        } else {
+            // Every segment writes at its own known offset in the shared output
+            int64_t start = table.packet_start(i, sample_rate);
+            int packet_samples = (int)(table.packet_start(i + 1, sample_rate) - start);
+            decoded_samples = opus_decode(decoder, packet, data_len, pcm_out + start * Channels, packet_samples, 0);
+        }
+
+        if (decoded_samples < 0) {
+            return decoded_samples;
+        }
+    }
+    return OPUS_OK;
+}
+
+template <int Channels>
+int64_t encode_frames(OpusEncoder* encoder, const int16_t* pcm, int64_t sample_count, int frame_size,
+                      int max_packet_size, int header_bytes, uint8_t* out, int32_t* packet_sizes,
+                      int16_t* padded_frame) {
+    int samples_per_frame = frame_size * Channels;
+    int64_t complete_frames = sample_count / samples_per_frame;
+    int remaining_samples = (int)(sample_count % samples_per_frame);
+    int64_t total_frames = complete_frames + (remaining_samples > 0 ? 1 : 0);
+    int64_t out_pos = 0;
+
+    for (int64_t frame = 0; frame < total_frames; frame++) {
+        const int16_t* frame_pcm = pcm + frame * samples_per_frame;
+
+        // Handle remaining incomplete frame by padding with zeros
+        if (frame == complete_frames) {
+            memcpy(padded_frame, frame_pcm, remaining_samples * sizeof(int16_t));
+            memset(padded_frame + remaining_samples, 0, (samples_per_frame - remaining_samples) * sizeof(int16_t));
+            frame_pcm = padded_frame;
+        }
+
+        int encoded_size = opus_encode(encoder, frame_pcm, frame_size, out + out_pos + header_bytes, max_packet_size);
+        if (encoded_size < 0) {
+            return encoded_size;
+        }
+
+        if (header_bytes == HEADER_SIZE) {
+            write_header(out + out_pos, encoded_size);
+        }
+        if (packet_sizes != nullptr) {
+            packet_sizes[frame] = encoded_size;
+        }
+        out_pos += header_bytes + encoded_size;
+    }
+
+    return out_pos;
+}
+
+template ReadResult decode_packets<1>(DecodeState&, const uint8_t*, int64_t, int64_t&, const std::atomic<bool>*);
+template ReadResult decode_packets<2>(DecodeState&, const uint8_t*, int64_t, int64_t&, const std::atomic<bool>*);
+template int decode_segment<1>(OpusDecoder*, const uint8_t*, int64_t, const PacketTable&, int, int, int, int, int, int16_t*, int16_t*);
+template int decode_segment<2>(OpusDecoder*, const uint8_t*, int64_t, const PacketTable&, int, int, int, int, int, int16_t*, int16_t*);
+template int64_t encode_frames<1>(OpusEncoder*, const int16_t*, int64_t, int, int, int, uint8_t*, int32_t*, int16_t*);
+template int64_t encode_frames<2>(OpusEncoder*, const int16_t*, int64_t, int, int, int, uint8_t*, int32_t*, int16_t*);
+
+uint64_t fnv1a(const void* data, int64_t size, uint64_t hash) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (int64_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t pcm_checksum(const int16_t* pcm, int64_t sample_count) {
+    return fnv1a(pcm, sample_count * (int64_t)sizeof(int16_t));
+}
+
+} // namespace p3
@@ -0,0 +1,112 @@
+#ifndef P3_CODEC_H
+#define P3_CODEC_H
+
+#include "p3_format.h"
+#include <opus.h>
+#include <atomic>
+#include <cstdint>
+
+class EnvelopeAnalyzer;
+
+// Godot-independent P3 decode and encode loops. The Godot classes wrap these
+// with PackedByteArray handling, logging and metrics; the benchmark links them
+// directly. Both loops are specialized per channel count (1 or 2).
+namespace p3 {
+
+// Running state of one decode walk. pcm_out points into the final output,
+// sized by the caller (usually from a scan_packets pre-scan).
+struct DecodeState {
+    OpusDecoder* decoder;
+    int16_t* pcm_out;
+    int64_t pcm_capacity;       // Samples per channel available in pcm_out
+    int max_frame_size;         // Samples per channel in the longest frame
+    int packet_count;
+    int64_t total_pcm_samples;
+    int error;                  // Opus error that stopped the walk, OPUS_OK otherwise
+    bool cancelled;
+    EnvelopeAnalyzer* envelope; // Optional; fed every decoded packet while it is still in cache
+
+    void begin(OpusDecoder* p_decoder, int16_t* p_pcm_out, int64_t p_pcm_capacity, int p_max_frame_size) {
+        decoder = p_decoder;
+        pcm_out = p_pcm_out;
+        pcm_capacity = p_pcm_capacity;
+        max_frame_size = p_max_frame_size;
+        packet_count = 0;
+        total_pcm_samples = 0;
+        error = OPUS_OK;
+        cancelled = false;
+        envelope = nullptr;
+    }
+
+    bool failed() const { return error != OPUS_OK || cancelled; }
+};
+
+// Decode every complete packet in data[pos, size) straight into state.pcm_out.
+// Stops at the first decode error or once *cancel becomes true. Returns the read
+// result that stopped the walk, with pos at the first unconsumed byte.
+template <int Channels>
+ReadResult decode_packets(DecodeState& state, const uint8_t* data, int64_t size, int64_t& pos,
+                          const std::atomic<bool>* cancel = nullptr);
+
+// Packet table as P3Index keeps it: byte offset and first sample (at 48 kHz)
+// of every packet, plus the stream length
+struct PacketTable {
+    const int64_t* offsets;
+    const int64_t* starts;
+    int packet_count;
+    int64_t total_samples;
+
+    // First sample of packet at sample_rate; packet_count gives the stream length
+    int64_t packet_start(int packet, int sample_rate) const {
+        return (packet < packet_count ? starts[packet] : total_samples) / (48000 / sample_rate);
+    }
+};
+
+// Packets each segment of a parallel decode decodes and drops before its
+// first packet. A fresh decoder does not reach the serial decoder's state
+// exactly, so samples after a segment boundary may differ from a serial
+// decode by up to PARALLEL_MAX_SAMPLE_ERROR. On demo/voice.p3 the largest
+// difference over every possible boundary is 72 (about -53 dBFS) at 16 and
+// 48 kHz with this pre-roll, against 1427 with 2 packets. No practical
+// pre-roll makes it bit-exact there (12 packets still differ by 38).
+static constexpr int PARALLEL_PREROLL_PACKETS = 4;
+static constexpr int PARALLEL_MAX_SAMPLE_ERROR = 128;  // About -48 dBFS
+
+// Decode packets [first_packet, end_packet) of data straight to their place in
+// pcm_out, the output of the whole stream. Up to preroll_packets earlier
+// packets are decoded into scratch (max_frame_size * Channels samples) first,
+// to warm up the fresh decoder. Returns OPUS_OK, the first Opus error, or
+// OPUS_INVALID_PACKET when the table does not fit data.
+template <int Channels>
+int decode_segment(OpusDecoder* decoder, const uint8_t* data, int64_t size, const PacketTable& table,
+                   int sample_rate, int first_packet, int end_packet, int preroll_packets,
+                   int max_frame_size, int16_t* pcm_out, int16_t* scratch);
+
+// Frames needed for sample_count interleaved samples, the last one zero-padded
+inline int64_t encoded_frame_count(int64_t sample_count, int frame_size, int channels) {
+    int64_t samples_per_frame = (int64_t)frame_size * channels;
+    return (sample_count + samples_per_frame - 1) / samples_per_frame;
+}
+
+// Encode sample_count interleaved samples in frame_size frames. header_bytes of
+// space are left before every packet and filled with a P3 header when equal to
+// HEADER_SIZE. out must hold encoded_frame_count() * (header_bytes +
+// max_packet_size) bytes and packet_sizes (optional) one entry per frame;
+// padded_frame is scratch for the final partial frame (frame_size * Channels).
+// Returns the bytes written, or a negative Opus error.
+template <int Channels>
+int64_t encode_frames(OpusEncoder* encoder, const int16_t* pcm, int64_t sample_count, int frame_size,
+                      int max_packet_size, int header_bytes, uint8_t* out, int32_t* packet_sizes,
+                      int16_t* padded_frame);
+
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+// FNV-1a over size bytes, continuing from hash (chain calls to hash several buffers)
+uint64_t fnv1a(const void* data, int64_t size, uint64_t hash = FNV_OFFSET_BASIS);
+
+// FNV-1a over a PCM buffer, for comparing decoder output across builds
+uint64_t pcm_checksum(const int16_t* pcm, int64_t sample_count);
+
+} // namespace p3
+
+#endif // P3_CODEC_H
@@ -0,0 +1,155 @@
+#ifndef P3_FORMAT_H
+#define P3_FORMAT_H
+
+#include <opus.h>
+#include <cstdint>
+#include <cstring>
+
+// P3 container helpers shared by every class that walks a P3 byte stream.
+// A P3 stream is a sequence of packets, each one a 4-byte header followed by
+// a single raw Opus packet:
+//
+//   packet_type (1B) | reserved (1B) | data_len (2B, big endian) | opus_data
+namespace p3 {
+
+// P3 format header structure
+struct P3Header {
+    uint8_t packet_type;    // 1 byte type
+    uint8_t reserved;       // 1 byte reserved
+    uint16_t data_len;      // 2 bytes length (big endian)
+};
+
+static constexpr int HEADER_SIZE = sizeof(P3Header);
+static constexpr int MAX_PACKET_DATA = 4096;  // Largest Opus payload accepted in one packet
+static constexpr int MAX_PACKET_SAMPLES_48K = 5760;  // Longest Opus packet (120 ms) at 48 kHz
+
+enum ReadResult {
+    READ_OK,                // A complete packet was read
+    READ_END,               // Not enough bytes left for another header
+    READ_INVALID_LENGTH,    // data_len is 0 or larger than MAX_PACKET_DATA
+    READ_TRUNCATED,         // Header is valid but the payload runs past the end
+};
+
+// Convert from big endian to host byte order
+inline uint16_t be16_to_host(uint16_t value) {
+    return ((value & 0xFF) << 8) | ((value >> 8) & 0xFF);
+}
+
+// Read the payload length declared by the 4-byte header at data
+inline int header_data_len(const uint8_t* data) {
+    P3Header header;
+    memcpy(&header, data, sizeof(P3Header));
+    return be16_to_host(header.data_len);
+}
+
+inline bool is_valid_data_len(int packet_len) {
+    return packet_len > 0 && packet_len <= MAX_PACKET_DATA;
+}
+
+// Write a packet header for a payload of packet_len bytes (packet type 0)
+inline void write_header(uint8_t* dst, int packet_len) {
+    dst[0] = 0;
+    dst[1] = 0;
+    dst[2] = (uint8_t)((packet_len >> 8) & 0xFF);
+    dst[3] = (uint8_t)(packet_len & 0xFF);
+}
+
+// Parse the header at data + pos. On READ_OK, packet/packet_len point at the
+// Opus payload inside data and pos is advanced past it. On READ_TRUNCATED and
+// READ_INVALID_LENGTH packet_len still holds the declared length and pos is left
+// untouched, so callers can report or wait for more bytes. A negative pos
+// (e.g. from a corrupt index) reads as READ_END.
+inline ReadResult read_packet(const uint8_t* data, int64_t size, int64_t& pos,
+                              const uint8_t*& packet, int& packet_len) {
+    if (pos < 0 || pos + HEADER_SIZE > size) {
+        return READ_END;
+    }
+
+    packet_len = header_data_len(data + pos);
+    if (!is_valid_data_len(packet_len)) {
+        return READ_INVALID_LENGTH;
+    }
+
+    if (pos + HEADER_SIZE + packet_len > size) {
+        return READ_TRUNCATED;
+    }
+
+    packet = data + pos + HEADER_SIZE;
+    pos += HEADER_SIZE + packet_len;
+    return READ_OK;
+}
+
+// Result of a header-only pass over a P3 buffer
+struct ScanInfo {
+    int packet_count;       // Valid packets before the end or the first bad packet
+    int64_t total_samples;  // Samples per channel in those packets
+    int64_t error_pos;      // Byte offset of the first bad packet, -1 if none
+};
+
+// Walk every header and sum opus_packet_get_nb_samples without decoding
+// anything. Returns false on an invalid length, a truncated payload or an
+// invalid Opus TOC; info still describes the packets before the bad one.
+inline bool scan_packets(const uint8_t* data, int64_t size, int sample_rate, ScanInfo& info) {
+    info.packet_count = 0;
+    info.total_samples = 0;
+    info.error_pos = -1;
+
+    int64_t pos = 0;
+    while (true) {
+        const uint8_t* packet = nullptr;
+        int packet_len = 0;
+        ReadResult read_result = read_packet(data, size, pos, packet, packet_len);
+        if (read_result == READ_END) {
+            return true;
+        }
+
+        int packet_samples = read_result == READ_OK ? opus_packet_get_nb_samples(packet, packet_len, sample_rate) : -1;
+        if (packet_samples <= 0) {
+            info.error_pos = read_result == READ_OK ? pos - packet_len - HEADER_SIZE : pos;
+            return false;
+        }
+
+        info.packet_count++;
+        info.total_samples += packet_samples;
+    }
+}
+
+// Check a packet table that did not come from scan_packets (a stored index)
+// against what a scan of source_size bytes can produce: packets start at byte
+// 0, each one spans a valid header plus payload, and each one lasts between 1
+// sample and 120 ms at 48 kHz. Tables that pass never point outside the data
+// or claim more samples than the packets can hold.
+inline bool is_valid_packet_table(const int64_t* offsets, const int64_t* starts, int count,
+                                  int64_t total_samples, int64_t source_size) {
+    if (count < 0 || source_size < 0) {
+        return false;
+    }
+    if (count == 0) {
+        return total_samples == 0 && source_size < HEADER_SIZE;
+    }
+    if (offsets[0] != 0 || starts[0] != 0) {
+        return false;
+    }
+
+    // offsets[i] and starts[i] are already known to be in range, so only
+    // comparisons against them are needed (no overflowing subtraction)
+    int64_t max_last_bytes = HEADER_SIZE + MAX_PACKET_DATA + HEADER_SIZE - 1;  // Plus a partial trailing header
+    for (int i = 0; i < count; i++) {
+        bool last = i + 1 == count;
+        int64_t next_offset = last ? source_size : offsets[i + 1];
+        int64_t next_start = last ? total_samples : starts[i + 1];
+
+        if (next_offset <= offsets[i] + HEADER_SIZE ||
+            next_offset > offsets[i] + (last ? max_last_bytes : HEADER_SIZE + MAX_PACKET_DATA)) {
+            return false;
+        }
+        if (next_start <= starts[i] || next_start > starts[i] + MAX_PACKET_SAMPLES_48K) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace p3
+
+#endif // P3_FORMAT_H
@@ -0,0 +1,90 @@
+#ifndef P3_STREAM_PARSER_H
+#define P3_STREAM_PARSER_H
+
+#include "p3_format.h"
+#include <cstring>
+
+namespace p3 {
+
+// Reassembles P3 packets from a byte stream that arrives in chunks of any
+// size (TCP, WebSocket frames). Packets that lie completely inside a chunk are
+// handed out in place; only the packet split across two chunks is copied, into
+// a fixed carry buffer, so parsing never allocates.
+class StreamParser {
+public:
+    StreamParser() : carry_size(0) {}
+
+    // Parse data[0, size) after whatever was carried over from earlier chunks
+    // and call on_packet(const uint8_t* packet, int packet_len) for every
+    // completed packet, in stream order. Returns READ_INVALID_LENGTH (and drops
+    // the carried bytes) when a header declares an impossible length, which
+    // means the stream is not P3 or lost bytes; READ_OK otherwise.
+    template <typename OnPacket>
+    ReadResult feed(const uint8_t* data, int64_t size, OnPacket&& on_packet) {
+        int64_t pos = 0;
+
+        // Finish the packet started by the previous chunk
+        if (carry_size > 0) {
+            if (carry_size < HEADER_SIZE && !fill_carry(data, size, pos, HEADER_SIZE)) {
+                return READ_OK;
+            }
+
+            int packet_len = header_data_len(carry);
+            if (!is_valid_data_len(packet_len)) {
+                reset();
+                return READ_INVALID_LENGTH;
+            }
+            if (!fill_carry(data, size, pos, HEADER_SIZE + packet_len)) {
+                return READ_OK;
+            }
+
+            carry_size = 0;
+            on_packet(carry + HEADER_SIZE, packet_len);
+        }
+
+        while (true) {
+            const uint8_t* packet = nullptr;
+            int packet_len = 0;
+            ReadResult read_result = read_packet(data, size, pos, packet, packet_len);
+            if (read_result == READ_OK) {
+                on_packet(packet, packet_len);
+                continue;
+            }
+            if (read_result == READ_INVALID_LENGTH) {
+                reset();
+                return READ_INVALID_LENGTH;
+            }
+
+            // Partial header or payload: keep it for the next chunk
+            carry_size = (int)(size - pos);
+            memcpy(carry, data + pos, carry_size);
+            return READ_OK;
+        }
+    }
+
+    void reset() { carry_size = 0; }
+
+    // Bytes of an incomplete packet waiting for the next chunk
+    int get_pending_bytes() const { return carry_size; }
+
+private:
+    uint8_t carry[HEADER_SIZE + MAX_PACKET_DATA];
+    int carry_size;
+
+    // Copy bytes from data into carry until it holds target bytes; false if
+    // the chunk ran out first
+    bool fill_carry(const uint8_t* data, int64_t size, int64_t& pos, int target) {
+        int64_t take = target - carry_size;
+        if (take > size - pos) {
+            take = size - pos;
+        }
+        memcpy(carry + carry_size, data + pos, take);
+        carry_size += (int)take;
+        pos += take;
+        return carry_size == target;
+    }
+};
+
+} // namespace p3
+
+#endif // P3_STREAM_PARSER_H
@@ -0,0 +1,57 @@
+#include "pcm_ring.h"
+#include <cstring>
+
+PcmRing::PcmRing() : channels(1), read_pos(0), count(0), dropped_frames(0) {}
+
+bool PcmRing::configure(int capacity_frames, int p_channels) {
+    channels = p_channels > 0 ? p_channels : 1;
+    size_t samples = (size_t)(capacity_frames > 0 ? capacity_frames : 0) * channels;
+    bool reallocated = buffer.size() != samples;
+    if (reallocated) {
+        buffer.assign(samples, 0);
+    }
+    clear();
+    return reallocated;
+}
+
+void PcmRing::clear() {
+    read_pos = 0;
+    count = 0;
+    dropped_frames = 0;
+}
+
+void PcmRing::write(const int16_t* pcm, int frames) {
+    int capacity = (int)buffer.size();
+    int samples = frames * channels;
+    if (samples <= 0 || samples > capacity) {
+        return;
+    }
+
+    if (count + samples > capacity) {
+        int drop = count + samples - capacity;
+        read_pos = (read_pos + drop) % capacity;
+        count -= drop;
+        dropped_frames += drop / channels;
+    }
+
+    int write_pos = (read_pos + count) % capacity;
+    int first = capacity - write_pos < samples ? capacity - write_pos : samples;
+    memcpy(buffer.data() + write_pos, pcm, first * sizeof(int16_t));
+    memcpy(buffer.data(), pcm + first, (samples - first) * sizeof(int16_t));
+    count += samples;
+}
+
+int PcmRing::read(int16_t* pcm, int max_frames) {
+    int capacity = (int)buffer.size();
+    int samples = max_frames * channels < count ? max_frames * channels : count;
+    if (samples <= 0) {
+        return 0;
+    }
+
+    int first = capacity - read_pos < samples ? capacity - read_pos : samples;
+    memcpy(pcm, buffer.data() + read_pos, first * sizeof(int16_t));
+    memcpy(pcm + first, buffer.data(), (samples - first) * sizeof(int16_t));
+    read_pos = (read_pos + samples) % capacity;
+    count -= samples;
+    return samples / channels;
+}
@@ -0,0 +1,45 @@
+#ifndef PCM_RING_H
+#define PCM_RING_H
+
+#include <cstdint>
+#include <vector>
+
+// Single-threaded ring of interleaved int16 PCM between a decoder and a
+// reader pulling fixed-size blocks. Storage is sized once by configure();
+// write() and read() only copy, at most in two pieces at the wrap-around, so
+// the steady state does not touch the heap.
+//
+// When a write does not fit, the oldest frames are dropped (and counted) so
+// the latency between writer and reader stays bounded by the capacity.
+class PcmRing {
+public:
+    PcmRing();
+
+    // Room for capacity_frames frames of channels samples; drops the contents.
+    // Returns true when the storage had to be reallocated.
+    bool configure(int capacity_frames, int channels);
+
+    // Append frames frames of interleaved PCM, dropping the oldest on overflow.
+    // frames must not exceed the capacity.
+    void write(const int16_t* pcm, int frames);
+
+    // Move at most max_frames of the oldest frames to pcm; returns the frames read
+    int read(int16_t* pcm, int max_frames);
+
+    // Drop the contents and the dropped-frame counter
+    void clear();
+
+    int get_capacity() const { return channels > 0 ? (int)buffer.size() / channels : 0; }
+    int get_available() const { return channels > 0 ? count / channels : 0; }
+    int get_free() const { return channels > 0 ? ((int)buffer.size() - count) / channels : 0; }
+    int64_t get_dropped_frames() const { return dropped_frames; }
+
+private:
+    std::vector<int16_t> buffer;
+    int channels;
+    int read_pos;                   // Sample index of the oldest frame
+    int count;                      // Buffered samples (frames * channels)
+    int64_t dropped_frames;
+};
+
+#endif // PCM_RING_H
@@ -0,0 +1,137 @@
+#include "polyphase_resampler.h"
+#include "audio_kernels.h"
+#include <cmath>
+
+static int greatest_common_divisor(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth-order modified Bessel function of the first kind (Kaiser window)
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double half = x * 0.5;
+    for (int k = 1; k < 64 && term > sum * 1e-12; k++) {
+        term *= (half / k) * (half / k);
+        sum += term;
+    }
+    return sum;
+}
+
+PolyphaseResampler::PolyphaseResampler() {
+    input_rate = 0;
+    output_rate = 0;
+    up = 1;
+    down = 1;
+    taps_per_phase = 0;
+    next_base = 0;
+    phase = 0;
+}
+
+bool PolyphaseResampler::configure(int p_input_rate, int p_output_rate, float output_gain) {
+    if (p_input_rate <= 0 || p_output_rate <= 0) {
+        return false;
+    }
+
+    input_rate = p_input_rate;
+    output_rate = p_output_rate;
+    int divisor = greatest_common_divisor(input_rate, output_rate);
+    up = output_rate / divisor;
+    down = input_rate / divisor;
+
+    // The passband is flat to 7/8 of the lower Nyquist frequency and the
+    // stopband starts at that Nyquist, so the transition band is 1/16 of the
+    // lower rate (7-8 kHz for 48k -> 16k). Reaching about 70 dB over that
+    // band takes TAPS_PER_RATIO taps per phase for every whole step of
+    // decimation.
+    int ratio = (down + up - 1) / up;
+    taps_per_phase = TAPS_PER_RATIO * (ratio > 1 ? ratio : 1);
+
+    // Windowed-sinc prototype at the upsampled rate, cutoff in the middle of
+    // the transition band
+    const double pi = 3.14159265358979323846;
+    int length = up * taps_per_phase;
+    double lower_nyquist = 0.5 / (up > down ? up : down);
+    double cutoff = lower_nyquist * (PASSBAND_EDGE + 1.0) * 0.5;
+    double center = (length - 1) * 0.5;
+    double window_norm = bessel_i0(KAISER_BETA);
+    std::vector<double> prototype(length);
+    for (int i = 0; i < length; i++) {
+        double x = i - center;
+        double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * x) / (pi * x);
+        double position = x / (center > 0.0 ? center : 1.0);
+        double window = bessel_i0(KAISER_BETA * std::sqrt(std::fmax(0.0, 1.0 - position * position))) / window_norm;
+        prototype[i] = sinc * window * up * output_gain;
+    }
+
+    // Phase p uses prototype taps p, p + up, p + 2 * up, ...; store them
+    // oldest-input-first so the dot product walks history forwards
+    coefficients.resize(length);
+    for (int p = 0; p < up; p++) {
+        float* branch = coefficients.data() + (size_t)p * taps_per_phase;
+        for (int k = 0; k < taps_per_phase; k++) {
+            branch[taps_per_phase - 1 - k] = (float)prototype[(size_t)k * up + p];
+        }
+    }
+
+    reset();
+    return true;
+}
+
+void PolyphaseResampler::reset() {
+    history.assign(taps_per_phase > 0 ? taps_per_phase - 1 : 0, 0.0f);
+    next_base = taps_per_phase - 1;
+    phase = 0;
+}
+
+int PolyphaseResampler::get_max_output(int count) const {
+    if (down == 0) {
+        return 0;
+    }
+    return (int)(((int64_t)count * up) / down) + 1;
+}
+
+double PolyphaseResampler::get_delay_samples() const {
+    if (down == 0) {
+        return 0.0;
+    }
+    return (up * (double)taps_per_phase - 1.0) * 0.5 / down;
+}
+
+int PolyphaseResampler::process(const float* input, int count, float* output) {
+    if (taps_per_phase == 0 || count <= 0) {
+        return 0;
+    }
+
+    size_t kept = history.size();
+    history.resize(kept + count);
+    for (int i = 0; i < count; i++) {
+        history[kept + i] = input[i];
+    }
+
+    int produced = 0;
+    int available = (int)history.size();
+    while (next_base < available) {
+        const float* taps = history.data() + next_base - (taps_per_phase - 1);
+        output[produced++] = audio_kernels::dot_product(coefficients.data() + (size_t)phase * taps_per_phase, taps, taps_per_phase);
+
+        phase += down;
+        next_base += phase / up;
+        phase %= up;
+    }
+
+    // Keep only the history the next output still needs; capacity stays
+    int first_needed = next_base - (taps_per_phase - 1);
+    if (first_needed > available) {
+        first_needed = available;
+    }
+    history.erase(history.begin(), history.begin() + first_needed);
+    next_base -= first_needed;
+
+    return produced;
+}
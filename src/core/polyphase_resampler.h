@@ -0,0 +1,53 @@
+#ifndef POLYPHASE_RESAMPLER_H
+#define POLYPHASE_RESAMPLER_H
+
+#include <cstdint>
+#include <vector>
+
+// Streaming rational-ratio resampler for mono float audio. The prototype
+// low-pass (Kaiser-windowed sinc) is split into `up` phases of taps_per_phase
+// coefficients each, stored reversed so every output sample is a single
+// audio_kernels::dot_product over contiguous input history.
+//
+// Input may arrive in chunks of any size; history between calls is kept
+// internally and the working buffer only grows to the largest chunk seen.
+class PolyphaseResampler {
+public:
+    PolyphaseResampler();
+
+    // Set up the filter for input_rate -> output_rate; every output sample is
+    // multiplied by output_gain (e.g. 32767 to produce int16-range floats)
+    bool configure(int input_rate, int output_rate, float output_gain = 1.0f);
+
+    // Consume count input samples and write the produced samples to output,
+    // which must hold at least get_max_output(count) samples
+    int process(const float* input, int count, float* output);
+
+    // Upper bound of samples process() produces for count input samples
+    int get_max_output(int count) const;
+
+    // Filter group delay in output samples
+    double get_delay_samples() const;
+
+    void reset();
+
+    int get_input_rate() const { return input_rate; }
+    int get_output_rate() const { return output_rate; }
+
+private:
+    static constexpr double PASSBAND_EDGE = 0.875;  // Flat passband as a fraction of the lower Nyquist frequency
+    static constexpr double KAISER_BETA = 7.0;      // About 70 dB stopband attenuation
+    static constexpr int TAPS_PER_RATIO = 72;       // Taps per phase for each whole step of decimation
+
+    int input_rate;
+    int output_rate;
+    int up;                         // Interpolation factor (output_rate / gcd)
+    int down;                       // Decimation factor (input_rate / gcd)
+    int taps_per_phase;
+    std::vector<float> coefficients;  // up phases x taps_per_phase, each phase reversed
+    std::vector<float> history;       // Last taps_per_phase - 1 inputs followed by new input
+    int next_base;                    // Index in history of the newest input tap of the next output
+    int phase;                        // Polyphase branch of the next output
+};
+
+#endif // POLYPHASE_RESAMPLER_H
@@ -0,0 +1,141 @@
+#ifndef SLRU_CACHE_H
+#define SLRU_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+// Byte-budgeted cache with segmented LRU eviction. New entries start in the
+// probation segment; a second hit moves them to the protected segment, which
+// may use up to protected_percent of the budget (its least recently used
+// entries fall back to probation when it grows past that). Eviction takes the
+// least recently used probation entry first, including one put() has just
+// inserted, and touches the protected segment only once probation is empty,
+// so a burst of one-off entries cannot push out entries that are used again
+// and again.
+//
+// Not thread-safe; callers hold their own lock.
+template <typename Key, typename Value>
+class SlruCache {
+public:
+    explicit SlruCache(int64_t p_budget_bytes = 0, int p_protected_percent = 80)
+        : budget_bytes(p_budget_bytes), protected_percent(p_protected_percent),
+          used_bytes(0), protected_bytes(0), evictions(0) {}
+
+    // Look up key and mark it used; nullptr on a miss. The pointer stays valid
+    // until the next put/erase/clear/set_budget.
+    Value* get(const Key& key) {
+        auto found = index.find(key);
+        if (found == index.end()) {
+            return nullptr;
+        }
+
+        auto entry = found->second;
+        if (entry->is_protected) {
+            protected_list.splice(protected_list.begin(), protected_list, entry);
+        } else {
+            entry->is_protected = true;
+            protected_bytes += entry->bytes;
+            protected_list.splice(protected_list.begin(), probation, entry);
+            demote_protected();
+        }
+        return &entry->value;
+    }
+
+    bool contains(const Key& key) const { return index.count(key) != 0; }
+
+    // Insert or replace key, then evict down to the budget. Returns false when
+    // the entry is not kept: it is larger than the whole budget, or the
+    // protected entries leave no room for it in probation.
+    bool put(const Key& key, const Value& value, int64_t bytes) {
+        erase(key);
+        if (bytes > budget_bytes) {
+            return false;
+        }
+
+        probation.push_front(Entry{key, value, bytes, false});
+        index[key] = probation.begin();
+        used_bytes += bytes;
+        evict_to_budget();
+        return contains(key);
+    }
+
+    bool erase(const Key& key) {
+        auto found = index.find(key);
+        if (found == index.end()) {
+            return false;
+        }
+        remove(found->second);
+        return true;
+    }
+
+    void clear() {
+        probation.clear();
+        protected_list.clear();
+        index.clear();
+        used_bytes = 0;
+        protected_bytes = 0;
+    }
+
+    void set_budget(int64_t bytes) {
+        budget_bytes = bytes > 0 ? bytes : 0;
+        demote_protected();
+        evict_to_budget();
+    }
+
+    int64_t get_budget() const { return budget_bytes; }
+    int64_t get_used_bytes() const { return used_bytes; }
+    int64_t get_evictions() const { return evictions; }
+    int get_entry_count() const { return (int)index.size(); }
+    void reset_evictions() { evictions = 0; }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        int64_t bytes;
+        bool is_protected;
+    };
+    using EntryList = std::list<Entry>;
+
+    EntryList probation;        // Front is the most recently used
+    EntryList protected_list;
+    std::unordered_map<Key, typename EntryList::iterator> index;
+    int64_t budget_bytes;
+    int protected_percent;
+    int64_t used_bytes;
+    int64_t protected_bytes;
+    int64_t evictions;
+
+    void remove(typename EntryList::iterator entry) {
+        used_bytes -= entry->bytes;
+        index.erase(entry->key);
+        if (entry->is_protected) {
+            protected_bytes -= entry->bytes;
+            protected_list.erase(entry);
+        } else {
+            probation.erase(entry);
+        }
+    }
+
+    // Move protected entries back to probation until the segment fits its share
+    void demote_protected() {
+        int64_t limit = budget_bytes * protected_percent / 100;
+        while (protected_bytes > limit && !protected_list.empty()) {
+            auto entry = std::prev(protected_list.end());
+            entry->is_protected = false;
+            protected_bytes -= entry->bytes;
+            probation.splice(probation.begin(), protected_list, entry);
+        }
+    }
+
+    void evict_to_budget() {
+        while (used_bytes > budget_bytes && !index.empty()) {
+            EntryList& victims = probation.empty() ? protected_list : probation;
+            remove(std::prev(victims.end()));
+            evictions++;
+        }
+    }
+};
+
+#endif // SLRU_CACHE_H
@@ -0,0 +1,123 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Lock-free single-producer/single-consumer ring of trivially copyable items.
+// One thread may call the producer methods and one other thread the consumer
+// methods at the same time, without locks; every call is wait-free (a bounded
+// memcpy and one atomic store). reset() is not thread-safe and must only run
+// while neither side is active.
+//
+// The read and write counters only grow and are reduced by the power-of-two
+// mask when indexing, so full and empty are told apart without a spare slot.
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing items are copied with memcpy");
+
+public:
+    SpscRing() : mask(0), read_pos(0), write_pos(0) {}
+
+    // Allocate room for at least min_capacity items and drop the contents
+    void reset(size_t min_capacity) {
+        size_t capacity = 1;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+        buffer.assign(capacity, T());
+        mask = capacity - 1;
+        read_pos.store(0, std::memory_order_relaxed);
+        write_pos.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return buffer.size(); }
+
+    // ----- Producer -----
+
+    size_t free_space() const {
+        return buffer.size() - (write_pos.load(std::memory_order_relaxed) - read_pos.load(std::memory_order_acquire));
+    }
+
+    // Append first and then second as one unit: either all items become
+    // visible to the consumer at once or, when there is not enough room,
+    // nothing is written
+    bool write_all(const T* first, size_t first_count, const T* second = nullptr, size_t second_count = 0) {
+        if (first_count + second_count > free_space()) {
+            return false;
+        }
+        size_t pos = write_pos.load(std::memory_order_relaxed);
+        copy_in(pos, first, first_count);
+        copy_in(pos + first_count, second, second_count);
+        write_pos.store(pos + first_count + second_count, std::memory_order_release);
+        return true;
+    }
+
+    // ----- Consumer -----
+
+    size_t available() const {
+        return write_pos.load(std::memory_order_acquire) - read_pos.load(std::memory_order_relaxed);
+    }
+
+    // Copy up to count items without consuming them; returns the items copied
+    size_t peek(T* items, size_t count) const {
+        size_t ready = available();
+        if (count > ready) {
+            count = ready;
+        }
+        copy_out(read_pos.load(std::memory_order_relaxed), items, count);
+        return count;
+    }
+
+    // Consume up to count items; returns the items read
+    size_t read(T* items, size_t count) {
+        count = peek(items, count);
+        read_pos.store(read_pos.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        return count;
+    }
+
+    // Drop up to count items; returns the items dropped
+    size_t skip(size_t count) {
+        size_t ready = available();
+        if (count > ready) {
+            count = ready;
+        }
+        read_pos.store(read_pos.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    std::vector<T> buffer;
+    size_t mask;
+
+    // Each counter is written by one side only; keep them on separate cache
+    // lines so the two threads do not invalidate each other on every call
+    alignas(64) std::atomic<size_t> read_pos;
+    alignas(64) std::atomic<size_t> write_pos;
+
+    // Copy in at most two pieces around the end of the buffer
+    void copy_in(size_t pos, const T* items, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        size_t start = pos & mask;
+        size_t first = buffer.size() - start < count ? buffer.size() - start : count;
+        memcpy(buffer.data() + start, items, first * sizeof(T));
+        memcpy(buffer.data(), items + first, (count - first) * sizeof(T));
+    }
+
+    void copy_out(size_t pos, T* items, size_t count) const {
+        if (count == 0) {
+            return;
+        }
+        size_t start = pos & mask;
+        size_t first = buffer.size() - start < count ? buffer.size() - start : count;
+        memcpy(items, buffer.data() + start, first * sizeof(T));
+        memcpy(items + first, buffer.data(), (count - first) * sizeof(T));
+    }
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,47 @@
+#include "voice_activity.h"
+#include "audio_kernels.h"
+#include <cmath>
+
+namespace {
+
+constexpr float FULL_SCALE_POWER = 32768.0f * 32768.0f;
+constexpr float SILENCE_DB = -120.0f;
+
+} // namespace
+
+VoiceActivityDetector::VoiceActivityDetector() {
+    configure(-45.0f, 5);
+}
+
+void VoiceActivityDetector::configure(float p_threshold_db, int p_hangover_frames) {
+    threshold_db = p_threshold_db;
+    threshold_power = FULL_SCALE_POWER * powf(10.0f, threshold_db / 10.0f);
+    hangover_frames = p_hangover_frames > 0 ? p_hangover_frames : 0;
+    reset();
+}
+
+bool VoiceActivityDetector::process(const int16_t* pcm, int count) {
+    if (count <= 0) {
+        return speech;
+    }
+
+    float power = audio_kernels::sum_squares_int16(pcm, count) / count;
+    level_db = power > 0.0f ? 10.0f * log10f(power / FULL_SCALE_POWER) : SILENCE_DB;
+
+    if (power >= threshold_power) {
+        hangover_left = hangover_frames;
+        speech = true;
+    } else if (hangover_left > 0) {
+        hangover_left--;
+        speech = true;
+    } else {
+        speech = false;
+    }
+    return speech;
+}
+
+void VoiceActivityDetector::reset() {
+    hangover_left = 0;
+    level_db = SILENCE_DB;
+    speech = false;
+}
@@ -0,0 +1,35 @@
+#ifndef VOICE_ACTIVITY_H
+#define VOICE_ACTIVITY_H
+
+#include <cstdint>
+
+// Energy gate used by the encoder's VAD stage. A frame is speech when its RMS
+// level is at or above threshold_db (dBFS). After the last loud frame the gate
+// stays open for hangover_frames more frames, so word endings and short pauses
+// between words are not clipped.
+class VoiceActivityDetector {
+public:
+    VoiceActivityDetector();
+
+    void configure(float threshold_db, int hangover_frames);
+
+    // Classify one frame of interleaved samples; true means speech
+    bool process(const int16_t* pcm, int count);
+
+    void reset();
+
+    float get_threshold_db() const { return threshold_db; }
+    int get_hangover_frames() const { return hangover_frames; }
+    float get_level_db() const { return level_db; }  // RMS level of the last frame
+    bool is_speech() const { return speech; }
+
+private:
+    float threshold_db;
+    float threshold_power;      // threshold_db as mean square of int16 samples
+    int hangover_frames;
+    int hangover_left;
+    float level_db;
+    bool speech;
+};
+
+#endif // VOICE_ACTIVITY_H
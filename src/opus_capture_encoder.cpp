@@ -0,0 +1,151 @@
+#include "opus_capture_encoder.h"
+#include "audio_kernels.h"
+#include "codec_log.h"
+#include <godot_cpp/classes/audio_server.hpp>
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+using namespace godot;
+
+void OpusCaptureEncoder::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("initialize", "input_rate", "bitrate", "frame_ms"), &OpusCaptureEncoder::initialize, DEFVAL(0), DEFVAL(24000), DEFVAL(opus_config::DEFAULT_FRAME_MS));
+    ClassDB::bind_method(D_METHOD("push_frames", "frames"), &OpusCaptureEncoder::push_frames);
+    ClassDB::bind_method(D_METHOD("capture", "effect"), &OpusCaptureEncoder::capture);
+    ClassDB::bind_method(D_METHOD("reset"), &OpusCaptureEncoder::reset);
+    ClassDB::bind_method(D_METHOD("get_encoder"), &OpusCaptureEncoder::get_encoder);
+    ClassDB::bind_method(D_METHOD("get_input_rate"), &OpusCaptureEncoder::get_input_rate);
+    ClassDB::bind_method(D_METHOD("get_pending_samples"), &OpusCaptureEncoder::get_pending_samples);
+
+    // Statistics
+    ClassDB::bind_method(D_METHOD("get_latency_ms"), &OpusCaptureEncoder::get_latency_ms);
+    ClassDB::bind_method(D_METHOD("get_cpu_usec_per_second"), &OpusCaptureEncoder::get_cpu_usec_per_second);
+    ClassDB::bind_method(D_METHOD("get_packets_encoded"), &OpusCaptureEncoder::get_packets_encoded);
+    ClassDB::bind_method(D_METHOD("reset_statistics"), &OpusCaptureEncoder::reset_statistics);
+}
+
+OpusCaptureEncoder::OpusCaptureEncoder() {
+    input_rate = 0;
+    input_frames = 0;
+    encode_usec = 0;
+    packets_encoded = 0;
+}
+
+OpusCaptureEncoder::~OpusCaptureEncoder() {
+}
+
+bool OpusCaptureEncoder::initialize(int p_input_rate, int bitrate, int frame_ms) {
+    if (p_input_rate <= 0) {
+        p_input_rate = (int)AudioServer::get_singleton()->get_mix_rate();
+    }
+
+    encoder.instantiate();
+    // Captured audio is downmixed, so the encoder always runs mono
+    if (!encoder->initialize(bitrate, opus_config::DEFAULT_SAMPLE_RATE, 1, frame_ms)) {
+        encoder.unref();
+        return false;
+    }
+
+    // Scale to int16 range inside the filter so quantizing is a single saturate
+    if (!resampler.configure(p_input_rate, encoder->get_sample_rate(), 32767.0f)) {
+        CODEC_LOG_ERROR("OpusCaptureEncoder: Invalid input rate ", p_input_rate);
+        encoder.unref();
+        return false;
+    }
+    input_rate = p_input_rate;
+
+    reset_statistics();
+
+    CODEC_LOG_INFO("OpusCaptureEncoder: Initialized (", input_rate, "Hz stereo -> ", encoder->get_sample_rate(), "Hz mono)");
+    return true;
+}
+
+Array OpusCaptureEncoder::push_frames(const PackedVector2Array& frames) {
+    Array packets;
+    if (encoder.is_null()) {
+        CODEC_LOG_ERROR("OpusCaptureEncoder: Not initialized");
+        return packets;
+    }
+
+    int frame_count = frames.size();
+    if (frame_count == 0) {
+        return packets;
+    }
+
+    uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+    if ((int)mono.size() < frame_count) {
+        mono.resize(frame_count);
+    }
+#ifdef REAL_T_IS_DOUBLE
+    const Vector2* frames_in = frames.ptr();
+    for (int i = 0; i < frame_count; i++) {
+        mono[i] = (float)((frames_in[i].x + frames_in[i].y) * 0.5);
+    }
+#else
+    // Vector2 is two floats, so the array is already interleaved stereo
+    audio_kernels::downmix_stereo_to_mono(reinterpret_cast<const float*>(frames.ptr()), mono.data(), frame_count);
+#endif
+
+    int max_output = resampler.get_max_output(frame_count);
+    if ((int)resampled.size() < max_output) {
+        resampled.resize(max_output);
+    }
+    int produced = resampler.process(mono.data(), frame_count, resampled.data());
+
+    if ((int)quantized.size() < produced) {
+        quantized.resize(produced);
+    }
+    audio_kernels::saturate_to_int16(resampled.data(), quantized.data(), produced);
+
+    // Encode every complete frame; the encoder keeps the remainder for the next call
+    encoder->push_samples(quantized.data(), produced);
+    packets = encoder->pop_packets();
+    packets_encoded += packets.size();
+
+    input_frames += frame_count;
+    encode_usec += Time::get_singleton()->get_ticks_usec() - start_usec;
+    return packets;
+}
+
+Array OpusCaptureEncoder::capture(const Ref<AudioEffectCapture>& effect) {
+    if (effect.is_null()) {
+        CODEC_LOG_ERROR("OpusCaptureEncoder: Invalid capture effect");
+        return Array();
+    }
+
+    int available = effect->get_frames_available();
+    if (available <= 0) {
+        return Array();
+    }
+    return push_frames(effect->get_buffer(available));
+}
+
+void OpusCaptureEncoder::reset() {
+    resampler.reset();
+    if (encoder.is_valid()) {
+        encoder->reset();
+    }
+}
+
+double OpusCaptureEncoder::get_latency_ms() const {
+    if (encoder.is_null()) {
+        return 0.0;
+    }
+
+    double samples = resampler.get_delay_samples() + encoder->get_buffered_samples() + encoder->get_lookahead_samples();
+    return samples * 1000.0 / encoder->get_sample_rate();
+}
+
+double OpusCaptureEncoder::get_cpu_usec_per_second() const {
+    if (input_frames == 0 || input_rate == 0) {
+        return 0.0;
+    }
+    double audio_seconds = (double)input_frames / input_rate;
+    return (double)encode_usec / audio_seconds;
+}
+
+void OpusCaptureEncoder::reset_statistics() {
+    input_frames = 0;
+    encode_usec = 0;
+    packets_encoded = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef OPUS_CAPTURE_ENCODER_H
+#define OPUS_CAPTURE_ENCODER_H
+
+#include <godot_cpp/classes/audio_effect_capture.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
+#include "opus_encoder.h"
+#include "polyphase_resampler.h"
+#include <vector>
+
+using namespace godot;
+
+// Microphone-to-Opus pipeline. Takes stereo float frames at the capture rate
+// (usually AudioServer mix rate, 44.1 or 48 kHz) straight from
+// AudioEffectCapture, downmixes and resamples them to 16 kHz mono in native
+// kernels, quantizes to int16 and streams the result through an OpusEncoder
+// (push_samples/pop_packets). Samples short of a full frame are carried to the
+// next call, so no padding is ever encoded.
+class OpusCaptureEncoder : public RefCounted {
+    GDCLASS(OpusCaptureEncoder, RefCounted)
+
+private:
+    Ref<OpusEncoder> encoder;
+    PolyphaseResampler resampler;
+    int input_rate;
+
+    // Working buffers, grown to the largest chunk seen and then reused
+    std::vector<float> mono;
+    std::vector<float> resampled;
+    std::vector<int16_t> quantized;
+
+    // Statistics
+    int64_t input_frames;
+    int64_t encode_usec;
+    int64_t packets_encoded;
+
+protected:
+    static void _bind_methods();
+
+public:
+    OpusCaptureEncoder();
+    ~OpusCaptureEncoder();
+
+    // Set up for input_rate (0 = AudioServer mix rate), encoder bitrate and
+    // frame duration (10 or 20 ms for low-latency voice chat)
+    bool initialize(int input_rate = 0, int bitrate = 24000, int frame_ms = opus_config::DEFAULT_FRAME_MS);
+
+    // Feed stereo frames; returns an Array of PackedByteArray packets ready to send
+    Array push_frames(const PackedVector2Array& frames);
+
+    // Drain every frame currently available in a capture effect and encode it
+    Array capture(const Ref<AudioEffectCapture>& effect);
+
+    // Drop carried-over samples and filter history (e.g. after muting)
+    void reset();
+
+    // The underlying encoder, for bitrate/complexity/FEC settings
+    Ref<OpusEncoder> get_encoder() const { return encoder; }
+
+    int get_input_rate() const { return input_rate; }
+    int get_pending_samples() const { return encoder.is_valid() ? encoder->get_buffered_samples() : 0; }
+
+    // Capture-to-packet latency: resampler delay, carried-over samples and encoder lookahead
+    double get_latency_ms() const;
+
+    // Native processing time per second of captured audio
+    double get_cpu_usec_per_second() const;
+    int64_t get_packets_encoded() const { return packets_encoded; }
+    void reset_statistics();
+};
+
+#endif // OPUS_CAPTURE_ENCODER_H
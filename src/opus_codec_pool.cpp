@@ -0,0 +1,222 @@
+#include "opus_codec_pool.h"
+#include "codec_log.h"
+#include "codec_metrics.h"
+#include <godot_cpp/core/class_db.hpp>
+#include <mutex>
+#include <vector>
+
+using namespace godot;
+
+namespace {
+
+// Free list of equally sized codec states carved out of arena blocks
+struct Arena {
+    int slot_size = 0;
+    std::vector<uint8_t*> blocks;
+    std::vector<void*> free_slots;
+};
+
+// Usage counters of one codec kind (all channel counts together)
+struct KindStats {
+    int in_use = 0;
+    int high_water = 0;
+    int capacity = 0;
+};
+
+enum CodecKind {
+    KIND_DECODER,
+    KIND_ENCODER,
+    KIND_COUNT,
+};
+
+constexpr int MAX_CHANNELS = 2;
+
+std::mutex pool_mutex;
+Arena arenas[KIND_COUNT][MAX_CHANNELS];
+KindStats stats[KIND_COUNT];
+
+int codec_size(CodecKind kind, int channels) {
+    int size = kind == KIND_DECODER ? opus_decoder_get_size(channels) : opus_encoder_get_size(channels);
+    // Keep every slot 16-byte aligned inside its block
+    return (size + 15) & ~15;
+}
+
+// Caller holds pool_mutex
+void grow_arena(CodecKind kind, int channels) {
+    Arena& arena = arenas[kind][channels - 1];
+    if (arena.slot_size == 0) {
+        arena.slot_size = codec_size(kind, channels);
+    }
+
+    uint8_t* block = new uint8_t[(size_t)arena.slot_size * OpusCodecPool::ARENA_SLOTS];
+    CodecMetrics::record_allocation();
+    arena.blocks.push_back(block);
+    for (int i = OpusCodecPool::ARENA_SLOTS - 1; i >= 0; i--) {
+        arena.free_slots.push_back(block + (size_t)i * arena.slot_size);
+    }
+    stats[kind].capacity += OpusCodecPool::ARENA_SLOTS;
+}
+
+void* acquire_slot(CodecKind kind, int channels) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    Arena& arena = arenas[kind][channels - 1];
+    if (arena.free_slots.empty()) {
+        grow_arena(kind, channels);
+    }
+
+    void* slot = arena.free_slots.back();
+    arena.free_slots.pop_back();
+
+    KindStats& kind_stats = stats[kind];
+    kind_stats.in_use++;
+    if (kind_stats.in_use > kind_stats.high_water) {
+        kind_stats.high_water = kind_stats.in_use;
+    }
+    return slot;
+}
+
+void release_slot(CodecKind kind, int channels, void* slot) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    arenas[kind][channels - 1].free_slots.push_back(slot);
+    stats[kind].in_use--;
+}
+
+void reserve_slots(CodecKind kind, int count, int channels) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    Arena& arena = arenas[kind][channels - 1];
+    while ((int)arena.free_slots.size() < count) {
+        grow_arena(kind, channels);
+    }
+}
+
+bool valid_channels(int channels) {
+    return channels >= 1 && channels <= MAX_CHANNELS;
+}
+
+} // namespace
+
+void OpusCodecPool::_bind_methods() {
+    ClassDB::bind_static_method("OpusCodecPool", D_METHOD("reserve_decoders", "count", "channels"), &OpusCodecPool::reserve_decoders, DEFVAL(1));
+    ClassDB::bind_static_method("OpusCodecPool", D_METHOD("reserve_encoders", "count", "channels"), &OpusCodecPool::reserve_encoders, DEFVAL(1));
+
+    ClassDB::bind_static_method("OpusCodecPool", D_METHOD("get_decoders_in_use"), &OpusCodecPool::get_decoders_in_use);
+    ClassDB::bind_static_method("OpusCodecPool", D_METHOD("get_decoder_high_water_mark"), &OpusCodecPool::get_decoder_high_water_mark);
+    ClassDB::bind_static_method("OpusCodecPool", D_METHOD("get_decoder_capacity"), &OpusCodecPool::get_decoder_capacity);
+    ClassDB::bind_static_method("OpusCodecPool", D_METHOD("get_encoders_in_use"), &OpusCodecPool::get_encoders_in_use);
+    ClassDB::bind_static_method("OpusCodecPool", D_METHOD("get_encoder_high_water_mark"), &OpusCodecPool::get_encoder_high_water_mark);
+    ClassDB::bind_static_method("OpusCodecPool", D_METHOD("get_encoder_capacity"), &OpusCodecPool::get_encoder_capacity);
+    ClassDB::bind_static_method("OpusCodecPool", D_METHOD("reset_high_water_marks"), &OpusCodecPool::reset_high_water_marks);
+}
+
+OpusDecoder* OpusCodecPool::acquire_decoder(int sample_rate, int channels) {
+    if (!valid_channels(channels)) {
+        CODEC_LOG_ERROR("OpusCodecPool: Unsupported channel count ", channels);
+        return nullptr;
+    }
+
+    OpusDecoder* decoder = static_cast<OpusDecoder*>(acquire_slot(KIND_DECODER, channels));
+    int error = opus_decoder_init(decoder, sample_rate, channels);
+    if (error != OPUS_OK) {
+        CODEC_LOG_ERROR("OpusCodecPool: Failed to init decoder: ", opus_strerror(error));
+        release_slot(KIND_DECODER, channels, decoder);
+        return nullptr;
+    }
+    return decoder;
+}
+
+::OpusEncoder* OpusCodecPool::acquire_encoder(int sample_rate, int channels, int application) {
+    if (!valid_channels(channels)) {
+        CODEC_LOG_ERROR("OpusCodecPool: Unsupported channel count ", channels);
+        return nullptr;
+    }
+
+    ::OpusEncoder* encoder = static_cast<::OpusEncoder*>(acquire_slot(KIND_ENCODER, channels));
+    int error = opus_encoder_init(encoder, sample_rate, channels, application);
+    if (error != OPUS_OK) {
+        CODEC_LOG_ERROR("OpusCodecPool: Failed to init encoder: ", opus_strerror(error));
+        release_slot(KIND_ENCODER, channels, encoder);
+        return nullptr;
+    }
+    return encoder;
+}
+
+void OpusCodecPool::release_decoder(OpusDecoder* decoder, int channels) {
+    if (decoder != nullptr && valid_channels(channels)) {
+        release_slot(KIND_DECODER, channels, decoder);
+    }
+}
+
+void OpusCodecPool::release_encoder(::OpusEncoder* encoder, int channels) {
+    if (encoder != nullptr && valid_channels(channels)) {
+        release_slot(KIND_ENCODER, channels, encoder);
+    }
+}
+
+void OpusCodecPool::reserve_decoders(int count, int channels) {
+    if (valid_channels(channels)) {
+        reserve_slots(KIND_DECODER, count, channels);
+    }
+}
+
+void OpusCodecPool::reserve_encoders(int count, int channels) {
+    if (valid_channels(channels)) {
+        reserve_slots(KIND_ENCODER, count, channels);
+    }
+}
+
+void OpusCodecPool::shutdown() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    for (int kind = 0; kind < KIND_COUNT; kind++) {
+        if (stats[kind].in_use > 0) {
+            CODEC_LOG_ERROR("OpusCodecPool: ", stats[kind].in_use, " codec states still in use at shutdown");
+            continue;
+        }
+
+        for (int channels = 0; channels < MAX_CHANNELS; channels++) {
+            Arena& arena = arenas[kind][channels];
+            for (uint8_t* block : arena.blocks) {
+                delete[] block;
+            }
+            arena.blocks.clear();
+            arena.free_slots.clear();
+        }
+        stats[kind].capacity = 0;
+    }
+}
+
+int OpusCodecPool::get_decoders_in_use() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return stats[KIND_DECODER].in_use;
+}
+
+int OpusCodecPool::get_decoder_high_water_mark() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return stats[KIND_DECODER].high_water;
+}
+
+int OpusCodecPool::get_decoder_capacity() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return stats[KIND_DECODER].capacity;
+}
+
+int OpusCodecPool::get_encoders_in_use() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return stats[KIND_ENCODER].in_use;
+}
+
+int OpusCodecPool::get_encoder_high_water_mark() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return stats[KIND_ENCODER].high_water;
+}
+
+int OpusCodecPool::get_encoder_capacity() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return stats[KIND_ENCODER].capacity;
+}
+
+void OpusCodecPool::reset_high_water_marks() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    for (int kind = 0; kind < KIND_COUNT; kind++) {
+        stats[kind].high_water = stats[kind].in_use;
+    }
+}
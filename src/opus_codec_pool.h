@@ -0,0 +1,49 @@
+#ifndef OPUS_CODEC_POOL_H
+#define OPUS_CODEC_POOL_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <opus.h>
+
+using namespace godot;
+
+// Process-wide pool of Opus codec states. States live in contiguous arena
+// blocks sized with opus_decoder_get_size/opus_encoder_get_size and are reset
+// in place with opus_decoder_init/opus_encoder_init when handed out, so
+// starting a session never touches the heap once the pool is warm.
+// All methods are static and thread-safe.
+class OpusCodecPool : public RefCounted {
+    GDCLASS(OpusCodecPool, RefCounted)
+
+public:
+    static constexpr int ARENA_SLOTS = 16;  // Codec states allocated per arena block
+
+protected:
+    static void _bind_methods();
+
+public:
+    // Hand out a freshly initialized state; nullptr on invalid parameters
+    static OpusDecoder* acquire_decoder(int sample_rate, int channels);
+    static ::OpusEncoder* acquire_encoder(int sample_rate, int channels, int application);
+
+    // Return a state to the pool; channels must match the acquire call
+    static void release_decoder(OpusDecoder* decoder, int channels);
+    static void release_encoder(::OpusEncoder* encoder, int channels);
+
+    // Pre-allocate arena space so the first sessions do not allocate either
+    static void reserve_decoders(int count, int channels = 1);
+    static void reserve_encoders(int count, int channels = 1);
+
+    // Free all arena blocks (called on module shutdown)
+    static void shutdown();
+
+    // Pool statistics
+    static int get_decoders_in_use();
+    static int get_decoder_high_water_mark();
+    static int get_decoder_capacity();
+    static int get_encoders_in_use();
+    static int get_encoder_high_water_mark();
+    static int get_encoder_capacity();
+    static void reset_high_water_marks();
+};
+
+#endif // OPUS_CODEC_POOL_H
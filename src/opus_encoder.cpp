@@ -1,192 +1,558 @@
 #include "opus_encoder.h"
+#include "codec_log.h"
+#include "codec_metrics.h"
+#include "opus_codec_pool.h"
+#include "p3_codec.h"
 #include <godot_cpp/core/class_db.hpp>
-#include <godot_cpp/variant/utility_functions.hpp>
-#include <vector>
+#include <cstring>
 
 OpusEncoder::OpusEncoder() : encoder(nullptr) {
+    sample_rate = opus_config::DEFAULT_SAMPLE_RATE;
+    channels = opus_config::DEFAULT_CHANNELS;
+    frame_size = opus_config::frame_samples(sample_rate, opus_config::DEFAULT_FRAME_MS);
+    stream_read = 0;
+    stream_count = 0;
+    vad_mode = VAD_OFF;
+    vad_threshold_db = -45.0f;
+    vad_hangover_ms = 300;
+    speech_frames = 0;
+    silent_frames = 0;
+    configure_vad();
+    adaptive_complexity = false;
+    adaptive_bitrate = false;
+    adaptive_budget_usec = 0;
+    complexity = 10;
+    bitrate = 64000;
 }
 
 OpusEncoder::~OpusEncoder() {
     if (encoder) {
-        opus_encoder_destroy(encoder);
+        OpusCodecPool::release_encoder(encoder, channels);
         encoder = nullptr;
     }
 }
 
 void OpusEncoder::_bind_methods() {
-    ClassDB::bind_method(D_METHOD("initialize", "bitrate"), &OpusEncoder::initialize, DEFVAL(64000));
+    ClassDB::bind_method(D_METHOD("initialize", "bitrate", "sample_rate", "channels", "frame_ms"), &OpusEncoder::initialize,
+                         DEFVAL(64000), DEFVAL(opus_config::DEFAULT_SAMPLE_RATE), DEFVAL(opus_config::DEFAULT_CHANNELS), DEFVAL(opus_config::DEFAULT_FRAME_MS));
     ClassDB::bind_method(D_METHOD("encode", "pcm_data"), &OpusEncoder::encode);
+    ClassDB::bind_method(D_METHOD("encode_p3", "pcm_data"), &OpusEncoder::encode_p3);
+    ClassDB::bind_method(D_METHOD("encode_packets", "pcm_data"), &OpusEncoder::encode_packets);
+    ClassDB::bind_method(D_METHOD("push_pcm", "pcm_data"), &OpusEncoder::push_pcm);
+    ClassDB::bind_method(D_METHOD("pop_packets"), &OpusEncoder::pop_packets);
+    ClassDB::bind_method(D_METHOD("flush"), &OpusEncoder::flush);
+    ClassDB::bind_method(D_METHOD("get_buffered_samples"), &OpusEncoder::get_buffered_samples);
     ClassDB::bind_method(D_METHOD("set_bitrate", "bitrate"), &OpusEncoder::set_bitrate);
     ClassDB::bind_method(D_METHOD("set_complexity", "complexity"), &OpusEncoder::set_complexity);
+    ClassDB::bind_method(D_METHOD("set_adaptive_complexity", "enabled"), &OpusEncoder::set_adaptive_complexity);
+    ClassDB::bind_method(D_METHOD("is_adaptive_complexity"), &OpusEncoder::is_adaptive_complexity);
+    ClassDB::bind_method(D_METHOD("set_adaptive_bitrate", "enabled"), &OpusEncoder::set_adaptive_bitrate);
+    ClassDB::bind_method(D_METHOD("is_adaptive_bitrate"), &OpusEncoder::is_adaptive_bitrate);
+    ClassDB::bind_method(D_METHOD("set_adaptive_budget_usec", "budget_usec"), &OpusEncoder::set_adaptive_budget_usec);
+    ClassDB::bind_method(D_METHOD("get_adaptive_budget_usec"), &OpusEncoder::get_adaptive_budget_usec);
+    ClassDB::bind_method(D_METHOD("get_complexity"), &OpusEncoder::get_complexity);
+    ClassDB::bind_method(D_METHOD("get_bitrate"), &OpusEncoder::get_bitrate);
+    ClassDB::bind_method(D_METHOD("get_encode_usec_average"), &OpusEncoder::get_encode_usec_average);
+    ClassDB::bind_method(D_METHOD("get_budget_usage"), &OpusEncoder::get_budget_usage);
+    ClassDB::bind_method(D_METHOD("get_complexity_changes"), &OpusEncoder::get_complexity_changes);
     ClassDB::bind_method(D_METHOD("set_signal_type", "signal_type"), &OpusEncoder::set_signal_type);
+    ClassDB::bind_method(D_METHOD("set_inband_fec", "enabled"), &OpusEncoder::set_inband_fec);
+    ClassDB::bind_method(D_METHOD("set_packet_loss_perc", "percent"), &OpusEncoder::set_packet_loss_perc);
+    ClassDB::bind_method(D_METHOD("set_vad_mode", "mode"), &OpusEncoder::set_vad_mode);
+    ClassDB::bind_method(D_METHOD("get_vad_mode"), &OpusEncoder::get_vad_mode);
+    ClassDB::bind_method(D_METHOD("set_vad_threshold_db", "threshold_db"), &OpusEncoder::set_vad_threshold_db);
+    ClassDB::bind_method(D_METHOD("get_vad_threshold_db"), &OpusEncoder::get_vad_threshold_db);
+    ClassDB::bind_method(D_METHOD("set_vad_hangover_ms", "hangover_ms"), &OpusEncoder::set_vad_hangover_ms);
+    ClassDB::bind_method(D_METHOD("get_vad_hangover_ms"), &OpusEncoder::get_vad_hangover_ms);
+    ClassDB::bind_method(D_METHOD("is_speech"), &OpusEncoder::is_speech);
+    ClassDB::bind_method(D_METHOD("get_vad_level_db"), &OpusEncoder::get_vad_level_db);
+    ClassDB::bind_method(D_METHOD("get_frame_voice_flags"), &OpusEncoder::get_frame_voice_flags);
+    ClassDB::bind_method(D_METHOD("get_speech_frames"), &OpusEncoder::get_speech_frames);
+    ClassDB::bind_method(D_METHOD("get_silent_frames"), &OpusEncoder::get_silent_frames);
     ClassDB::bind_method(D_METHOD("get_sample_rate"), &OpusEncoder::get_sample_rate);
     ClassDB::bind_method(D_METHOD("get_channels"), &OpusEncoder::get_channels);
     ClassDB::bind_method(D_METHOD("get_frame_size"), &OpusEncoder::get_frame_size);
     ClassDB::bind_method(D_METHOD("is_initialized"), &OpusEncoder::is_initialized);
     ClassDB::bind_method(D_METHOD("reset"), &OpusEncoder::reset);
+
+    BIND_ENUM_CONSTANT(VAD_OFF);
+    BIND_ENUM_CONSTANT(VAD_SUPPRESS);
+    BIND_ENUM_CONSTANT(VAD_DTX);
 }
 
-bool OpusEncoder::initialize(int bitrate) {
+bool OpusEncoder::initialize(int bitrate, int p_sample_rate, int p_channels, int frame_ms) {
     if (encoder) {
-        opus_encoder_destroy(encoder);
+        OpusCodecPool::release_encoder(encoder, channels);
         encoder = nullptr;
     }
     
-    int error;
-    encoder = opus_encoder_create(SAMPLE_RATE, CHANNELS, OPUS_APPLICATION_VOIP, &error);
+    if (!opus_config::is_valid_sample_rate(p_sample_rate) || !opus_config::is_valid_channels(p_channels) || !opus_config::is_valid_frame_ms(frame_ms)) {
+        CODEC_LOG_ERROR("Unsupported encoder format: ", p_sample_rate, " Hz, ", p_channels, " channels, ", frame_ms, " ms frames");
+        return false;
+    }
+    sample_rate = p_sample_rate;
+    channels = p_channels;
+    frame_size = opus_config::frame_samples(sample_rate, frame_ms);
+    padded_frame.resize(frame_size * channels);
+    stream_buffer.assign(frame_size * channels * 4, 0);
+    stream_read = 0;
+    stream_count = 0;
+    packet_buffer.resize(MAX_PACKET_SIZE);
+    frame_voice_flags.reserve(16);
+    configure_vad();
     
-    if (error != OPUS_OK || !encoder) {
-        UtilityFunctions::print("Failed to create Opus encoder: ", opus_strerror(error));
+    // Pooled encoder state, reset in place by opus_encoder_init
+    encoder = OpusCodecPool::acquire_encoder(sample_rate, channels, OPUS_APPLICATION_VOIP);
+    
+    if (!encoder) {
+        CODEC_LOG_ERROR("Failed to create Opus encoder");
         return false;
     }
     
     // Set initial bitrate
     if (!set_bitrate(bitrate)) {
-        opus_encoder_destroy(encoder);
+        OpusCodecPool::release_encoder(encoder, channels);
         encoder = nullptr;
         return false;
     }
     
-    UtilityFunctions::print("Opus encoder initialized successfully with bitrate: ", bitrate);
+    // The pooled state comes back with default settings, so re-apply DTX
+    if (vad_mode == VAD_DTX) {
+        opus_encoder_ctl(encoder, OPUS_SET_DTX(1));
+    }
+    
+    // Start from the encoder's default complexity until set_complexity is called
+    opus_int32 default_complexity = 10;
+    opus_encoder_ctl(encoder, OPUS_GET_COMPLEXITY(&default_complexity));
+    complexity = default_complexity;
+    configure_adaptive();
+    
+    CODEC_LOG_INFO("Opus encoder initialized successfully with bitrate: ", bitrate, " (", sample_rate, " Hz, ", channels, " channels, ", frame_ms, " ms frames)");
     return true;
 }
 
-PackedByteArray OpusEncoder::encode(const PackedByteArray& pcm_data) {
-    PackedByteArray result;
+int OpusEncoder::encode_frame(const opus_int16* pcm, unsigned char* packet, int max_packet_size) {
+    if (!adaptive_complexity) {
+        return opus_encode(encoder, pcm, frame_size, packet, max_packet_size);
+    }
     
+    uint64_t started_usec = CodecMetrics::now_usec();
+    int encoded_size = opus_encode(encoder, pcm, frame_size, packet, max_packet_size);
+    if (encoded_size >= 0) {
+        adapt_complexity(CodecMetrics::now_usec() - started_usec, 1);
+    }
+    return encoded_size;
+}
+
+bool OpusEncoder::encode_frames(const PackedByteArray& pcm_data, int header_bytes, PackedByteArray& encoded_data, PackedInt32Array* packet_sizes) {
     if (!encoder) {
-        UtilityFunctions::print("Encoder not initialized");
-        return result;
+        CODEC_LOG_ERROR("Encoder not initialized");
+        return false;
     }
     
     if (pcm_data.size() == 0) {
-        UtilityFunctions::print("Empty PCM data");
-        return result;
+        CODEC_LOG_ERROR("Empty PCM data");
+        return false;
     }
     
-    // PCM data should be 16-bit signed integers
-    int samples_per_frame = FRAME_SIZE * CHANNELS;
-    int bytes_per_frame = samples_per_frame * sizeof(int16_t);
+    // Size the output once for the worst case and write every packet in place
+    uint64_t started_usec = CodecMetrics::now_usec();
+    int64_t sample_count = pcm_data.size() / sizeof(int16_t);
+    int64_t total_frames = p3::encoded_frame_count(sample_count, frame_size, channels);
+    encoded_data.resize(total_frames * (header_bytes + MAX_PACKET_SIZE));
+    CodecMetrics::record_allocation();
     
-    // Calculate number of complete frames and remaining bytes
-    int complete_frames = pcm_data.size() / bytes_per_frame;
-    int remaining_bytes = pcm_data.size() % bytes_per_frame;
+    int32_t* sizes_out = nullptr;
+    if (packet_sizes) {
+        packet_sizes->resize(total_frames);
+        sizes_out = packet_sizes->ptrw();
+    }
     
     const int16_t* pcm_ptr = reinterpret_cast<const int16_t*>(pcm_data.ptr());
+    int64_t out_pos = channels == 2
+        ? p3::encode_frames<2>(encoder, pcm_ptr, sample_count, frame_size, MAX_PACKET_SIZE, header_bytes, encoded_data.ptrw(), sizes_out, padded_frame.data())
+        : p3::encode_frames<1>(encoder, pcm_ptr, sample_count, frame_size, MAX_PACKET_SIZE, header_bytes, encoded_data.ptrw(), sizes_out, padded_frame.data());
+    
+    if (out_pos < 0) {
+        CODEC_LOG_ERROR("Encoding failed: ", opus_strerror((int)out_pos));
+        CodecMetrics::record_error();
+        encoded_data = PackedByteArray();
+        return false;
+    }
     
-    // Prepare output buffer for all encoded frames
+    // Trim to the bytes actually written
+    encoded_data.resize(out_pos);
+    uint64_t elapsed_usec = CodecMetrics::now_usec() - started_usec;
+    CodecMetrics::record_encode(total_frames, pcm_data.size(), out_pos, elapsed_usec,
+                                total_frames * frame_size * 1000000 / sample_rate);
+    
+    // The batch loop is not timed per frame; its average feeds the controller once
+    if (adaptive_complexity) {
+        adapt_complexity(elapsed_usec, total_frames);
+    }
+    
+    int remaining_samples = (int)(sample_count % (frame_size * channels)) / channels;
+    if (remaining_samples > 0) {
+        float remaining_ms = (float)remaining_samples / sample_rate * 1000.0f;
+        CODEC_LOG_VERBOSE("Processed incomplete frame: ", remaining_samples, " samples (", remaining_ms, " ms)");
+    }
+    
+    return true;
+}
+
+PackedByteArray OpusEncoder::encode(const PackedByteArray& pcm_data) {
     PackedByteArray encoded_data;
+    encode_frames(pcm_data, 0, encoded_data, nullptr);
+    return encoded_data;
+}
+
+PackedByteArray OpusEncoder::encode_p3(const PackedByteArray& pcm_data) {
+    PackedByteArray encoded_data;
+    encode_frames(pcm_data, p3::HEADER_SIZE, encoded_data, nullptr);
+    return encoded_data;
+}
+
+Array OpusEncoder::encode_packets(const PackedByteArray& pcm_data) {
+    Array packets;
+    PackedByteArray encoded_data;
+    PackedInt32Array packet_sizes;
     
-    // Encode complete frames
-    for (int frame = 0; frame < complete_frames; frame++) {
-        unsigned char opus_packet[MAX_PACKET_SIZE];
-        
-        // Encode one frame
-        int encoded_size = opus_encode(encoder, 
-                                     pcm_ptr + (frame * samples_per_frame), 
-                                     FRAME_SIZE, 
-                                     opus_packet, 
-                                     MAX_PACKET_SIZE);
-        
-        if (encoded_size < 0) {
-            UtilityFunctions::print("Encoding failed: ", opus_strerror(encoded_size));
-            return PackedByteArray(); // Return empty array on error
+    if (!encode_frames(pcm_data, 0, encoded_data, &packet_sizes)) {
+        return packets;
+    }
+    
+    // Split the single encoded buffer into per-packet arrays
+    packets.resize(packet_sizes.size());
+    int64_t offset = 0;
+    for (int i = 0; i < packet_sizes.size(); i++) {
+        packets[i] = encoded_data.slice(offset, offset + packet_sizes[i]);
+        offset += packet_sizes[i];
+    }
+    
+    return packets;
+}
+
+void OpusEncoder::push_samples(const int16_t* pcm, int sample_count) {
+    if (sample_count <= 0) {
+        return;
+    }
+    
+    int capacity = (int)stream_buffer.size();
+    if (stream_count + sample_count > capacity) {
+        // Grow once to fit, unwrapping the buffered samples to the front
+        int new_capacity = capacity > 0 ? capacity : frame_size * channels;
+        while (new_capacity < stream_count + sample_count) {
+            new_capacity *= 2;
         }
-        
-        // Append encoded data
-        int old_size = encoded_data.size();
-        encoded_data.resize(old_size + encoded_size);
-        memcpy(encoded_data.ptrw() + old_size, opus_packet, encoded_size);
+        std::vector<int16_t> grown(new_capacity);
+        CodecMetrics::record_allocation();
+        for (int i = 0; i < stream_count; i++) {
+            grown[i] = stream_buffer[(stream_read + i) % capacity];
+        }
+        stream_buffer.swap(grown);
+        stream_read = 0;
+        capacity = new_capacity;
+    }
+    
+    // Copy in at most two pieces around the end of the ring
+    int write_pos = (stream_read + stream_count) % capacity;
+    int first = capacity - write_pos < sample_count ? capacity - write_pos : sample_count;
+    memcpy(stream_buffer.data() + write_pos, pcm, first * sizeof(int16_t));
+    memcpy(stream_buffer.data(), pcm + first, (sample_count - first) * sizeof(int16_t));
+    stream_count += sample_count;
+}
+
+void OpusEncoder::push_pcm(const PackedByteArray& pcm_data) {
+    if (!encoder) {
+        CODEC_LOG_ERROR("Encoder not initialized");
+        return;
     }
     
-    // Handle remaining incomplete frame by padding with zeros
-    if (remaining_bytes > 0) {
-        // Create a buffer for the padded frame
-        std::vector<int16_t> padded_frame(samples_per_frame, 0);
+    push_samples(reinterpret_cast<const int16_t*>(pcm_data.ptr()), pcm_data.size() / sizeof(int16_t));
+}
+
+int OpusEncoder::append_stream_packet(const int16_t* frame_pcm, Array& packets) {
+    int encoded_size = encode_frame(frame_pcm, packet_buffer.data(), MAX_PACKET_SIZE);
+    if (encoded_size < 0) {
+        CODEC_LOG_ERROR("Encoding failed: ", opus_strerror(encoded_size));
+        CodecMetrics::record_error();
+        return encoded_size;
+    }
+    
+    PackedByteArray packet;
+    packet.resize(encoded_size);
+    memcpy(packet.ptrw(), packet_buffer.data(), encoded_size);
+    packets.append(packet);
+    return encoded_size;
+}
+
+Array OpusEncoder::pop_packets() {
+    Array packets;
+    if (!encoder) {
+        CODEC_LOG_ERROR("Encoder not initialized");
+        return packets;
+    }
+    
+    int samples_per_frame = frame_size * channels;
+    int capacity = (int)stream_buffer.size();
+    frame_voice_flags.clear();
+    if (stream_count < samples_per_frame) {
+        return packets;
+    }
+    
+    uint64_t started_usec = CodecMetrics::now_usec();
+    int64_t bytes_out = 0;
+    while (stream_count >= samples_per_frame) {
+        // Encode in place unless the frame wraps around the end of the ring
+        const int16_t* frame_pcm = stream_buffer.data() + stream_read;
+        if (stream_read + samples_per_frame > capacity) {
+            int first = capacity - stream_read;
+            memcpy(padded_frame.data(), stream_buffer.data() + stream_read, first * sizeof(int16_t));
+            memcpy(padded_frame.data() + first, stream_buffer.data(), (samples_per_frame - first) * sizeof(int16_t));
+            frame_pcm = padded_frame.data();
+        }
         
-        // Copy remaining samples
-        int remaining_samples = remaining_bytes / sizeof(int16_t);
-        memcpy(padded_frame.data(), pcm_ptr + (complete_frames * samples_per_frame), remaining_bytes);
+        stream_read = (stream_read + samples_per_frame) % capacity;
+        stream_count -= samples_per_frame;
         
-        // Encode the padded frame
-        unsigned char opus_packet[MAX_PACKET_SIZE];
-        int encoded_size = opus_encode(encoder, 
-                                     padded_frame.data(), 
-                                     FRAME_SIZE, 
-                                     opus_packet, 
-                                     MAX_PACKET_SIZE);
+        // Silent frames past the hangover cost one energy pass instead of an encode
+        bool speech = true;
+        if (vad_mode != VAD_OFF) {
+            speech = vad.process(frame_pcm, samples_per_frame);
+            if (speech) {
+                speech_frames++;
+            } else {
+                silent_frames++;
+            }
+        }
+        frame_voice_flags.push_back(speech ? 1 : 0);
+        if (!speech && vad_mode == VAD_SUPPRESS) {
+            continue;
+        }
         
+        int encoded_size = append_stream_packet(frame_pcm, packets);
         if (encoded_size < 0) {
-            UtilityFunctions::print("Warning: Failed to encode incomplete frame: ", opus_strerror(encoded_size));
-            UtilityFunctions::print("Keeping PCM format for remaining ", remaining_bytes, " bytes (", remaining_samples, " samples)");
-        } else {
-            // Append encoded data
-            int old_size = encoded_data.size();
-            encoded_data.resize(old_size + encoded_size);
-            memcpy(encoded_data.ptrw() + old_size, opus_packet, encoded_size);
-            complete_frames++; // Count the padded frame as encoded
+            break;
         }
+        bytes_out += encoded_size;
     }
     
-    // UtilityFunctions::print("Encoded ", complete_frames, " frames, total size: ", encoded_data.size(), " bytes");
-    if (remaining_bytes > 0) {
-        int remaining_samples = remaining_bytes / sizeof(int16_t);
-        float remaining_ms = (float)remaining_samples / SAMPLE_RATE * 1000.0f;
-        UtilityFunctions::print("Processed incomplete frame: ", remaining_bytes, " bytes (", remaining_samples, " samples, ", remaining_ms, " ms)");
+    int64_t packet_count = packets.size();
+    CodecMetrics::record_allocation(packet_count);
+    CodecMetrics::record_encode(packet_count, packet_count * samples_per_frame * (int64_t)sizeof(int16_t), bytes_out,
+                                CodecMetrics::now_usec() - started_usec, packet_count * frame_size * 1000000 / sample_rate);
+    return packets;
+}
+
+Array OpusEncoder::flush() {
+    if (!encoder) {
+        CODEC_LOG_ERROR("Encoder not initialized");
+        return Array();
     }
     
-    return encoded_data;
+    // Zero-pad the partial frame up to a full one, then encode what is left
+    int samples_per_frame = frame_size * channels;
+    int partial = stream_count % samples_per_frame;
+    if (partial > 0) {
+        memset(padded_frame.data(), 0, (samples_per_frame - partial) * sizeof(int16_t));
+        push_samples(padded_frame.data(), samples_per_frame - partial);
+    }
+    
+    return pop_packets();
+}
+
+void OpusEncoder::configure_vad() {
+    int frame_ms = frame_size * 1000 / sample_rate;
+    vad.configure(vad_threshold_db, (vad_hangover_ms + frame_ms - 1) / frame_ms);
+}
+
+bool OpusEncoder::set_vad_mode(VadMode mode) {
+    if (mode < VAD_OFF || mode > VAD_DTX) {
+        CODEC_LOG_ERROR("Invalid VAD mode ", (int)mode);
+        return false;
+    }
+    
+    if (encoder) {
+        int error = opus_encoder_ctl(encoder, OPUS_SET_DTX(mode == VAD_DTX ? 1 : 0));
+        if (error != OPUS_OK) {
+            CODEC_LOG_ERROR("Failed to set DTX: ", opus_strerror(error));
+            return false;
+        }
+    }
+    
+    vad_mode = mode;
+    vad.reset();
+    return true;
+}
+
+void OpusEncoder::set_vad_threshold_db(float threshold_db) {
+    vad_threshold_db = threshold_db;
+    configure_vad();
+}
+
+void OpusEncoder::set_vad_hangover_ms(int hangover_ms) {
+    vad_hangover_ms = hangover_ms > 0 ? hangover_ms : 0;
+    configure_vad();
+}
+
+PackedByteArray OpusEncoder::get_frame_voice_flags() const {
+    PackedByteArray flags;
+    flags.resize(frame_voice_flags.size());
+    if (!frame_voice_flags.empty()) {
+        memcpy(flags.ptrw(), frame_voice_flags.data(), frame_voice_flags.size());
+    }
+    return flags;
+}
+
+int OpusEncoder::get_lookahead_samples() const {
+    opus_int32 lookahead = 0;
+    if (!encoder || opus_encoder_ctl(encoder, OPUS_GET_LOOKAHEAD(&lookahead)) != OPUS_OK) {
+        return 0;
+    }
+    return lookahead;
+}
+
+void OpusEncoder::configure_adaptive() {
+    int budget_usec = adaptive_budget_usec > 0 ? adaptive_budget_usec : (int)((int64_t)frame_size * 100000 / sample_rate);
+    complexity_controller.configure(budget_usec, complexity, bitrate, adaptive_bitrate);
+    if (!encoder) {
+        return;
+    }
+    
+    // Back to the user settings; the controller starts from the top
+    opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(complexity));
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate));
+}
+
+void OpusEncoder::adapt_complexity(uint64_t elapsed_usec, int64_t frames) {
+    int previous_bitrate = complexity_controller.get_bitrate();
+    if (frames <= 0 || !complexity_controller.record((double)elapsed_usec / frames)) {
+        return;
+    }
+    
+    opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(complexity_controller.get_complexity()));
+    if (complexity_controller.get_bitrate() != previous_bitrate) {
+        opus_encoder_ctl(encoder, OPUS_SET_BITRATE(complexity_controller.get_bitrate()));
+    }
+    CODEC_LOG_VERBOSE("Adaptive complexity: level ", complexity_controller.get_complexity(), ", bitrate ", complexity_controller.get_bitrate(),
+                      " (", complexity_controller.get_average_usec(), " us of ", complexity_controller.get_budget_usec(), " us budget)");
+}
+
+void OpusEncoder::set_adaptive_complexity(bool enabled) {
+    adaptive_complexity = enabled;
+    configure_adaptive();
+}
+
+void OpusEncoder::set_adaptive_bitrate(bool enabled) {
+    adaptive_bitrate = enabled;
+    configure_adaptive();
+}
+
+void OpusEncoder::set_adaptive_budget_usec(int budget_usec) {
+    adaptive_budget_usec = budget_usec > 0 ? budget_usec : 0;
+    configure_adaptive();
 }
 
-bool OpusEncoder::set_bitrate(int bitrate) {
+int OpusEncoder::get_complexity() const {
+    return adaptive_complexity ? complexity_controller.get_complexity() : complexity;
+}
+
+int OpusEncoder::get_bitrate() const {
+    return adaptive_complexity ? complexity_controller.get_bitrate() : bitrate;
+}
+
+bool OpusEncoder::set_bitrate(int p_bitrate) {
     if (!encoder) {
-        UtilityFunctions::print("Encoder not initialized");
+        CODEC_LOG_ERROR("Encoder not initialized");
         return false;
     }
     
-    int error = opus_encoder_ctl(encoder, OPUS_SET_BITRATE(bitrate));
+    int error = opus_encoder_ctl(encoder, OPUS_SET_BITRATE(p_bitrate));
     if (error != OPUS_OK) {
-        UtilityFunctions::print("Failed to set bitrate: ", opus_strerror(error));
+        CODEC_LOG_ERROR("Failed to set bitrate: ", opus_strerror(error));
         return false;
     }
     
+    bitrate = p_bitrate;
+    if (adaptive_complexity) {
+        configure_adaptive();
+    }
     return true;
 }
 
-bool OpusEncoder::set_complexity(int complexity) {
+bool OpusEncoder::set_complexity(int p_complexity) {
     if (!encoder) {
-        UtilityFunctions::print("Encoder not initialized");
+        CODEC_LOG_ERROR("Encoder not initialized");
         return false;
     }
     
-    if (complexity < 0 || complexity > 10) {
-        UtilityFunctions::print("Complexity must be between 0 and 10");
+    if (p_complexity < 0 || p_complexity > 10) {
+        CODEC_LOG_ERROR("Complexity must be between 0 and 10");
         return false;
     }
     
-    int error = opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(complexity));
+    int error = opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(p_complexity));
     if (error != OPUS_OK) {
-        UtilityFunctions::print("Failed to set complexity: ", opus_strerror(error));
+        CODEC_LOG_ERROR("Failed to set complexity: ", opus_strerror(error));
         return false;
     }
     
+    complexity = p_complexity;
+    if (adaptive_complexity) {
+        configure_adaptive();
+    }
     return true;
 }
 
 bool OpusEncoder::set_signal_type(int signal_type) {
     if (!encoder) {
-        UtilityFunctions::print("Encoder not initialized");
+        CODEC_LOG_ERROR("Encoder not initialized");
         return false;
     }
     
     if (signal_type != OPUS_SIGNAL_VOICE && signal_type != OPUS_SIGNAL_MUSIC) {
-        UtilityFunctions::print("Invalid signal type. Use OPUS_SIGNAL_VOICE or OPUS_SIGNAL_MUSIC");
+        CODEC_LOG_ERROR("Invalid signal type. Use OPUS_SIGNAL_VOICE or OPUS_SIGNAL_MUSIC");
         return false;
     }
     
     int error = opus_encoder_ctl(encoder, OPUS_SET_SIGNAL(signal_type));
     if (error != OPUS_OK) {
-        UtilityFunctions::print("Failed to set signal type: ", opus_strerror(error));
+        CODEC_LOG_ERROR("Failed to set signal type: ", opus_strerror(error));
+        return false;
+    }
+    
+    return true;
+}
+
+bool OpusEncoder::set_inband_fec(bool enabled) {
+    if (!encoder) {
+        CODEC_LOG_ERROR("Encoder not initialized");
+        return false;
+    }
+    
+    int error = opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(enabled ? 1 : 0));
+    if (error != OPUS_OK) {
+        CODEC_LOG_ERROR("Failed to set inband FEC: ", opus_strerror(error));
+        return false;
+    }
+    
+    return true;
+}
+
+bool OpusEncoder::set_packet_loss_perc(int percent) {
+    if (!encoder) {
+        CODEC_LOG_ERROR("Encoder not initialized");
+        return false;
+    }
+    
+    if (percent < 0 || percent > 100) {
+        CODEC_LOG_ERROR("Packet loss percentage must be between 0 and 100");
+        return false;
+    }
+    
+    int error = opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(percent));
+    if (error != OPUS_OK) {
+        CODEC_LOG_ERROR("Failed to set packet loss percentage: ", opus_strerror(error));
         return false;
     }
     
@@ -195,12 +561,18 @@ bool OpusEncoder::set_signal_type(int signal_type) {
 
 void OpusEncoder::reset() {
     if (!encoder) {
-        UtilityFunctions::print("Encoder not initialized");
+        CODEC_LOG_ERROR("Encoder not initialized");
         return;
     }
     
     int error = opus_encoder_ctl(encoder, OPUS_RESET_STATE);
     if (error != OPUS_OK) {
-        UtilityFunctions::print("Failed to reset encoder: ", opus_strerror(error));
+        CODEC_LOG_ERROR("Failed to reset encoder: ", opus_strerror(error));
     }
+    
+    // Buffered stream samples belong to the discarded state
+    stream_read = 0;
+    stream_count = 0;
+    vad.reset();
+    frame_voice_flags.clear();
 } 
\ No newline at end of file
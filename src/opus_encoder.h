@@ -2,23 +2,89 @@
 #define OPUS_ENCODER_H
 
 #include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/array.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
 #include <godot_cpp/variant/string.hpp>
+#include "complexity_controller.h"
+#include "opus_config.h"
+#include "voice_activity.h"
 #include <opus.h>
+#include <vector>
 
 using namespace godot;
 
 class OpusEncoder : public RefCounted {
     GDCLASS(OpusEncoder, RefCounted)
 
+public:
+    // What the streaming path does with frames the VAD classifies as silence
+    enum VadMode {
+        VAD_OFF,        // Encode every frame
+        VAD_SUPPRESS,   // Skip silent frames entirely: no encode cost, no packet
+        VAD_DTX,        // Encode with Opus DTX, which sends tiny packets during silence
+    };
+
 private:
     ::OpusEncoder* encoder;  // Use :: to avoid name conflict
     
-    static constexpr int SAMPLE_RATE = 16000;  // Fixed sample rate at 16000Hz
-    static constexpr int CHANNELS = 1;         // Mono channel
-    static constexpr int FRAME_SIZE = SAMPLE_RATE * 60 / 1000;  // 60ms frame size
     static constexpr int MAX_PACKET_SIZE = 4000;  // Maximum Opus packet size
 
+    // Format chosen at initialize(); defaults to 16000Hz mono 60ms frames
+    int sample_rate;
+    int channels;
+    int frame_size;  // Samples per channel in one frame
+
+    // Zero-padded copy of the final partial frame, or of a streamed frame that
+    // wraps around the end of stream_buffer
+    std::vector<int16_t> padded_frame;
+
+    // Streaming input: ring of interleaved samples not yet encoded. Sized for a
+    // few frames at initialize() and only grown when one push exceeds it.
+    std::vector<int16_t> stream_buffer;
+    int stream_read;    // Ring index of the oldest buffered sample
+    int stream_count;   // Interleaved samples buffered
+    std::vector<uint8_t> packet_buffer;  // One encoded packet before it is copied out
+
+    // Voice activity detection on the streaming path (pop_packets/flush)
+    VoiceActivityDetector vad;
+    VadMode vad_mode;
+    float vad_threshold_db;
+    int vad_hangover_ms;
+    std::vector<uint8_t> frame_voice_flags;  // 1 = speech, per frame of the last pop_packets
+    int64_t speech_frames;
+    int64_t silent_frames;
+
+    void configure_vad();
+
+    // Adaptive complexity: complexity and bitrate are the values last set by
+    // the user and act as the ceiling the controller works under
+    ComplexityController complexity_controller;
+    bool adaptive_complexity;
+    bool adaptive_bitrate;
+    int adaptive_budget_usec;   // 0 = 10% of the frame duration
+    int complexity;
+    int bitrate;
+
+    // Restart the controller from the user settings and apply its level
+    void configure_adaptive();
+
+    // Feed the encode time of frames frames to the controller and apply a new level
+    void adapt_complexity(uint64_t elapsed_usec, int64_t frames);
+
+    // Encode and append one streamed frame to packets; returns the packet size
+    // or a negative Opus error
+    int append_stream_packet(const int16_t* frame_pcm, Array& packets);
+
+    // Encode one frame_size frame; returns the packet size or a negative Opus error
+    int encode_frame(const opus_int16* pcm, unsigned char* packet, int max_packet_size);
+
+    // Encode pcm_data into one buffer sized up front from the frame count and
+    // trimmed once at the end. header_bytes of space are left before every packet
+    // (p3::HEADER_SIZE for a P3 container, 0 for raw packets) and packet sizes are
+    // recorded in packet_sizes when it is not null.
+    bool encode_frames(const PackedByteArray& pcm_data, int header_bytes, PackedByteArray& encoded_data, PackedInt32Array* packet_sizes);
+
 protected:
     static void _bind_methods();
 
@@ -26,21 +92,76 @@ public:
     OpusEncoder();
     ~OpusEncoder();
 
-    // Initialize encoder with bitrate
-    bool initialize(int bitrate = 64000);
+    // Initialize encoder with bitrate and format (frame_ms: 5, 10, 20, 40 or 60)
+    bool initialize(int bitrate = 64000, int sample_rate = opus_config::DEFAULT_SAMPLE_RATE,
+                    int channels = opus_config::DEFAULT_CHANNELS, int frame_ms = opus_config::DEFAULT_FRAME_MS);
     
     // Encode PCM data to Opus format
     PackedByteArray encode(const PackedByteArray& pcm_data);
+
+    // Encode PCM data into a P3 container (4-byte header before every packet)
+    PackedByteArray encode_p3(const PackedByteArray& pcm_data);
+
+    // Encode PCM data and return one PackedByteArray per Opus packet
+    Array encode_packets(const PackedByteArray& pcm_data);
+    
+    // Streaming API: push_pcm() buffers any amount of PCM, pop_packets() encodes
+    // only complete frames and keeps the remainder for the next push, flush()
+    // zero-pads the final partial frame. Steady-state calls do not allocate
+    // besides the returned packets.
+    void push_pcm(const PackedByteArray& pcm_data);
+    Array pop_packets();
+    Array flush();
+    int get_buffered_samples() const { return stream_count / channels; }  // Per channel
+
+    // push_pcm for C++ callers; sample_count counts interleaved samples
+    void push_samples(const int16_t* pcm, int sample_count);
+
+    int get_lookahead_samples() const;  // Encoder algorithmic delay at the encoder sample rate
+
+    // Voice activity detection for the streaming API. Frames whose RMS level
+    // stays below the threshold for longer than the hangover are silence; in
+    // VAD_SUPPRESS they produce no packet. Batch encode()/encode_p3() always
+    // encode every frame.
+    bool set_vad_mode(VadMode mode);
+    VadMode get_vad_mode() const { return vad_mode; }
+    void set_vad_threshold_db(float threshold_db);   // dBFS, default -45
+    float get_vad_threshold_db() const { return vad_threshold_db; }
+    void set_vad_hangover_ms(int hangover_ms);       // Default 300
+    int get_vad_hangover_ms() const { return vad_hangover_ms; }
+    bool is_speech() const { return vad_mode == VAD_OFF || vad.is_speech(); }  // Class of the last frame
+    float get_vad_level_db() const { return vad.get_level_db(); }
+    PackedByteArray get_frame_voice_flags() const;   // One byte per frame of the last pop_packets/flush
+    int64_t get_speech_frames() const { return speech_frames; }
+    int64_t get_silent_frames() const { return silent_frames; }
     
+    // Adaptive complexity: every opus_encode is timed and the complexity (and,
+    // with adaptive bitrate, the bitrate) is lowered while the average encode
+    // time per frame exceeds the budget and raised again once it is well under
+    // it. set_complexity/set_bitrate set the ceiling.
+    void set_adaptive_complexity(bool enabled);
+    bool is_adaptive_complexity() const { return adaptive_complexity; }
+    void set_adaptive_bitrate(bool enabled);
+    bool is_adaptive_bitrate() const { return adaptive_bitrate; }
+    void set_adaptive_budget_usec(int budget_usec);  // Per frame; 0 = 10% of the frame duration
+    int get_adaptive_budget_usec() const { return complexity_controller.get_budget_usec(); }
+    int get_complexity() const;             // Level in use
+    int get_bitrate() const;                // Bitrate in use
+    double get_encode_usec_average() const { return complexity_controller.get_average_usec(); }
+    double get_budget_usage() const { return complexity_controller.get_budget_usage(); }  // 1.0 = at the budget
+    int64_t get_complexity_changes() const { return complexity_controller.get_changes(); }
+
     // Set encoder parameters
     bool set_bitrate(int bitrate);
     bool set_complexity(int complexity);  // 0-10, higher = better quality but slower
     bool set_signal_type(int signal_type);  // OPUS_SIGNAL_VOICE or OPUS_SIGNAL_MUSIC
+    bool set_inband_fec(bool enabled);  // Embed redundancy for the previous frame (SILK/hybrid modes only)
+    bool set_packet_loss_perc(int percent);  // 0-100, expected loss; drives how much FEC is spent
     
     // Get audio parameters
-    int get_sample_rate() const { return SAMPLE_RATE; }
-    int get_channels() const { return CHANNELS; }
-    int get_frame_size() const { return FRAME_SIZE; }
+    int get_sample_rate() const { return sample_rate; }
+    int get_channels() const { return channels; }
+    int get_frame_size() const { return frame_size; }
     
     // Check if encoder is initialized
     bool is_initialized() const { return encoder != nullptr; }
@@ -49,4 +170,6 @@ public:
     void reset();
 };
 
+VARIANT_ENUM_CAST(OpusEncoder::VadMode);
+
 #endif // OPUS_ENCODER_H 
\ No newline at end of file
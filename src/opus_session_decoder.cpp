@@ -1,6 +1,13 @@
 #include "opus_session_decoder.h"
+#include "audio_kernels.h"
+#include "codec_log.h"
+#include "codec_metrics.h"
+#include "opus_codec_pool.h"
+#include "output_rate.h"
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 #include <godot_cpp/core/class_db.hpp>
-#include <godot_cpp/variant/utility_functions.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
 #include <opus.h>
 #include <cstring>
 
@@ -8,7 +15,7 @@ using namespace godot;
 
 void OpusSessionDecoder::_bind_methods() {
     // Session management
-    ClassDB::bind_method(D_METHOD("start_session"), &OpusSessionDecoder::start_session);
+    ClassDB::bind_method(D_METHOD("start_session", "sample_rate", "channels"), &OpusSessionDecoder::start_session, DEFVAL(opus_config::SAMPLE_RATE_AUTO), DEFVAL(opus_config::DEFAULT_CHANNELS));
     ClassDB::bind_method(D_METHOD("end_session"), &OpusSessionDecoder::end_session);
     ClassDB::bind_method(D_METHOD("reset_session"), &OpusSessionDecoder::reset_session);
     ClassDB::bind_method(D_METHOD("is_session_active"), &OpusSessionDecoder::is_session_active);
@@ -16,6 +23,64 @@ void OpusSessionDecoder::_bind_methods() {
     // Decoding methods
     ClassDB::bind_method(D_METHOD("decode_packet", "opus_data"), &OpusSessionDecoder::decode_packet);
     ClassDB::bind_method(D_METHOD("decode_packets", "opus_packets"), &OpusSessionDecoder::decode_packets);
+    ClassDB::bind_method(D_METHOD("decode_packet_frames", "opus_data", "gain"), &OpusSessionDecoder::decode_packet_frames, DEFVAL(1.0f));
+    ClassDB::bind_method(D_METHOD("decode_packets_frames", "opus_packets", "gain"), &OpusSessionDecoder::decode_packets_frames, DEFVAL(1.0f));
+    ClassDB::bind_method(D_METHOD("push_packets_to_generator", "playback", "opus_packets", "gain"), &OpusSessionDecoder::push_packets_to_generator, DEFVAL(1.0f));
+    ClassDB::bind_method(D_METHOD("get_generator_pending_packets"), &OpusSessionDecoder::get_generator_pending_packets);
+    ClassDB::bind_method(D_METHOD("get_generator_dropped_packets"), &OpusSessionDecoder::get_generator_dropped_packets);
+    
+    // PCM ring buffer
+    ClassDB::bind_method(D_METHOD("decode_packet_to_ring", "opus_data"), &OpusSessionDecoder::decode_packet_to_ring);
+    ClassDB::bind_method(D_METHOD("read_pcm", "max_samples"), &OpusSessionDecoder::read_pcm);
+    ClassDB::bind_method(D_METHOD("clear_pcm_ring"), &OpusSessionDecoder::clear_pcm_ring);
+    ClassDB::bind_method(D_METHOD("set_pcm_ring_capacity_ms", "capacity_ms"), &OpusSessionDecoder::set_pcm_ring_capacity_ms);
+    ClassDB::bind_method(D_METHOD("get_pcm_ring_capacity_ms"), &OpusSessionDecoder::get_pcm_ring_capacity_ms);
+    ClassDB::bind_method(D_METHOD("get_pcm_available"), &OpusSessionDecoder::get_pcm_available);
+    ClassDB::bind_method(D_METHOD("get_pcm_free"), &OpusSessionDecoder::get_pcm_free);
+    ClassDB::bind_method(D_METHOD("get_pcm_dropped_samples"), &OpusSessionDecoder::get_pcm_dropped_samples);
+    
+    // P3 byte stream
+    ClassDB::bind_method(D_METHOD("feed_p3_bytes", "chunk"), &OpusSessionDecoder::feed_p3_bytes);
+    ClassDB::bind_method(D_METHOD("feed_p3_stream", "peer"), &OpusSessionDecoder::feed_p3_stream);
+    ClassDB::bind_method(D_METHOD("get_p3_pending_bytes"), &OpusSessionDecoder::get_p3_pending_bytes);
+    
+    // Lip-sync envelope
+    ClassDB::bind_method(D_METHOD("enable_envelope", "window_ms"), &OpusSessionDecoder::enable_envelope, DEFVAL(20));
+    ClassDB::bind_method(D_METHOD("disable_envelope"), &OpusSessionDecoder::disable_envelope);
+    ClassDB::bind_method(D_METHOD("is_envelope_enabled"), &OpusSessionDecoder::is_envelope_enabled);
+    ClassDB::bind_method(D_METHOD("take_envelope"), &OpusSessionDecoder::take_envelope);
+    ClassDB::bind_method(D_METHOD("get_envelope_dropped_windows"), &OpusSessionDecoder::get_envelope_dropped_windows);
+    ClassDB::bind_method(D_METHOD("decode_packets_with_envelope", "opus_packets"), &OpusSessionDecoder::decode_packets_with_envelope);
+    
+    // Pipeline mode
+    ClassDB::bind_method(D_METHOD("enable_pipeline", "capacity_ms", "decode_on_worker"), &OpusSessionDecoder::enable_pipeline, DEFVAL(200), DEFVAL(false));
+    ClassDB::bind_method(D_METHOD("disable_pipeline"), &OpusSessionDecoder::disable_pipeline);
+    ClassDB::bind_method(D_METHOD("is_pipeline_enabled"), &OpusSessionDecoder::is_pipeline_enabled);
+    ClassDB::bind_method(D_METHOD("is_pipeline_decoding_on_worker"), &OpusSessionDecoder::is_pipeline_decoding_on_worker);
+    ClassDB::bind_method(D_METHOD("pipeline_push_packet", "opus_data"), &OpusSessionDecoder::pipeline_push_packet);
+    ClassDB::bind_method(D_METHOD("pipeline_decode"), &OpusSessionDecoder::pipeline_decode);
+    ClassDB::bind_method(D_METHOD("pipeline_pop_pcm", "frames"), &OpusSessionDecoder::pipeline_pop_pcm);
+    ClassDB::bind_method(D_METHOD("get_pipeline_buffered_frames"), &OpusSessionDecoder::get_pipeline_buffered_frames);
+    ClassDB::bind_method(D_METHOD("get_pipeline_overruns"), &OpusSessionDecoder::get_pipeline_overruns);
+    ClassDB::bind_method(D_METHOD("get_pipeline_underruns"), &OpusSessionDecoder::get_pipeline_underruns);
+    ClassDB::bind_method(D_METHOD("get_pipeline_underrun_frames"), &OpusSessionDecoder::get_pipeline_underrun_frames);
+    ClassDB::bind_method(D_METHOD("get_pipeline_decoded_packets"), &OpusSessionDecoder::get_pipeline_decoded_packets);
+    ClassDB::bind_method(D_METHOD("reset_pipeline_counters"), &OpusSessionDecoder::reset_pipeline_counters);
+    
+    // Jitter buffer
+    ClassDB::bind_method(D_METHOD("enable_jitter_buffer", "min_depth_ms", "max_depth_ms", "timestamp_rate"), &OpusSessionDecoder::enable_jitter_buffer, DEFVAL(60), DEFVAL(480), DEFVAL(DEFAULT_TIMESTAMP_RATE));
+    ClassDB::bind_method(D_METHOD("disable_jitter_buffer"), &OpusSessionDecoder::disable_jitter_buffer);
+    ClassDB::bind_method(D_METHOD("is_jitter_buffer_enabled"), &OpusSessionDecoder::is_jitter_buffer_enabled);
+    ClassDB::bind_method(D_METHOD("push_jitter_packet", "sequence", "timestamp", "opus_data"), &OpusSessionDecoder::push_jitter_packet);
+    ClassDB::bind_method(D_METHOD("pop_jitter_frame"), &OpusSessionDecoder::pop_jitter_frame);
+    ClassDB::bind_method(D_METHOD("get_jitter_buffer_target_ms"), &OpusSessionDecoder::get_jitter_buffer_target_ms);
+    ClassDB::bind_method(D_METHOD("get_jitter_buffered_packets"), &OpusSessionDecoder::get_jitter_buffered_packets);
+    ClassDB::bind_method(D_METHOD("get_jitter_ms"), &OpusSessionDecoder::get_jitter_ms);
+    ClassDB::bind_method(D_METHOD("get_concealed_frames"), &OpusSessionDecoder::get_concealed_frames);
+    ClassDB::bind_method(D_METHOD("get_fec_recovered_frames"), &OpusSessionDecoder::get_fec_recovered_frames);
+    ClassDB::bind_method(D_METHOD("get_inserted_frames"), &OpusSessionDecoder::get_inserted_frames);
+    ClassDB::bind_method(D_METHOD("get_skipped_frames"), &OpusSessionDecoder::get_skipped_frames);
+    ClassDB::bind_method(D_METHOD("get_late_packets"), &OpusSessionDecoder::get_late_packets);
     
     // Statistics and info
     ClassDB::bind_method(D_METHOD("get_total_decoded_samples"), &OpusSessionDecoder::get_total_decoded_samples);
@@ -31,9 +96,25 @@ void OpusSessionDecoder::_bind_methods() {
 
 OpusSessionDecoder::OpusSessionDecoder() {
     decoder = nullptr;
+    sample_rate = opus_config::DEFAULT_SAMPLE_RATE;
+    channels = opus_config::DEFAULT_CHANNELS;
+    max_frame_size = opus_config::frame_samples(sample_rate, opus_config::MAX_FRAME_MS);
     session_active = false;
     total_decoded_samples = 0;
     packet_count = 0;
+    jitter_enabled = false;
+    min_depth_ms = 60;
+    max_depth_ms = 480;
+    timestamp_rate = DEFAULT_TIMESTAMP_RATE;
+    reset_jitter_state();
+    float_buffer.resize(opus_config::MAX_FRAME_CAPACITY);
+    pcm_scratch.resize(opus_config::MAX_FRAME_CAPACITY);
+    pcm_ring_ms = DEFAULT_PCM_RING_MS;
+    envelope_window_ms = 0;
+    generator_dropped_packets = 0;
+    pipeline_enabled = false;
+    pipeline_on_worker = false;
+    pipeline_task_id = -1;
 }
 
 OpusSessionDecoder::~OpusSessionDecoder() {
@@ -42,18 +123,27 @@ OpusSessionDecoder::~OpusSessionDecoder() {
 
 // ========== Session Management ==========
 
-bool OpusSessionDecoder::start_session() {
+bool OpusSessionDecoder::start_session(int p_sample_rate, int p_channels) {
     // 如果已经有活跃会话，先结束
     if (session_active) {
         end_session();
     }
     
-    int error;
-    decoder = opus_decoder_create(SAMPLE_RATE, CHANNELS, &error);
+    // 自动采样率：直接按混音采样率解码，播放时无需再重采样
+    p_sample_rate = resolve_output_rate(p_sample_rate);
+    if (!opus_config::is_valid_sample_rate(p_sample_rate) || !opus_config::is_valid_channels(p_channels)) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Unsupported format ", p_sample_rate, "Hz, ", p_channels, " channels");
+        return false;
+    }
+    sample_rate = p_sample_rate;
+    channels = p_channels;
+    max_frame_size = opus_config::frame_samples(sample_rate, opus_config::MAX_FRAME_MS);
     
-    if (error != OPUS_OK) {
-        UtilityFunctions::print("OpusSessionDecoder: Failed to create decoder: ", opus_strerror(error));
-        decoder = nullptr;
+    // 从编解码器池获取已重置的解码器，避免每次会话都分配堆内存
+    decoder = OpusCodecPool::acquire_decoder(sample_rate, channels);
+    
+    if (decoder == nullptr) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Failed to create decoder");
         session_active = false;
         return false;
     }
@@ -61,19 +151,28 @@ bool OpusSessionDecoder::start_session() {
     session_active = true;
     total_decoded_samples = 0;
     packet_count = 0;
+    reset_jitter_state();
+    allocate_pcm_ring();
+    p3_parser.reset();
+    envelope.configure(sample_rate, channels, envelope_window_ms);
+    generator_pending.clear();
+    generator_dropped_packets = 0;
     
-    UtilityFunctions::print("OpusSessionDecoder: Session started (", SAMPLE_RATE, "Hz, ", CHANNELS, " channel)");
+    CODEC_LOG_INFO("OpusSessionDecoder: Session started (", sample_rate, "Hz, ", channels, " channel)");
     return true;
 }
 
 void OpusSessionDecoder::end_session() {
+    // 解码器归还到池之前，工作线程上的解码任务必须结束
+    disable_pipeline();
+    
     if (decoder != nullptr) {
-        opus_decoder_destroy(decoder);
+        OpusCodecPool::release_decoder(decoder, channels);
         decoder = nullptr;
     }
     
     if (session_active) {
-        UtilityFunctions::print("OpusSessionDecoder: Session ended (processed ", packet_count, " packets, ", 
+        CODEC_LOG_INFO("OpusSessionDecoder: Session ended (processed ", packet_count, " packets, ", 
                                total_decoded_samples, " samples, ", get_total_decoded_duration(), " seconds)");
     }
     
@@ -82,18 +181,27 @@ void OpusSessionDecoder::end_session() {
 
 void OpusSessionDecoder::reset_session() {
     if (!session_active || decoder == nullptr) {
-        UtilityFunctions::print("OpusSessionDecoder: No active session to reset");
+        CODEC_LOG_ERROR("OpusSessionDecoder: No active session to reset");
         return;
     }
     
-    // 重置解码器状态但不销毁
+    // 重置解码器状态但不销毁；工作线程可能正在使用解码器，先等它结束
+    wait_pipeline_task();
     int error = opus_decoder_ctl(decoder, OPUS_RESET_STATE);
     if (error != OPUS_OK) {
-        UtilityFunctions::print("OpusSessionDecoder: Failed to reset decoder state: ", opus_strerror(error));
+        CODEC_LOG_ERROR("OpusSessionDecoder: Failed to reset decoder state: ", opus_strerror(error));
     } else {
-        UtilityFunctions::print("OpusSessionDecoder: Decoder state reset");
+        CODEC_LOG_INFO("OpusSessionDecoder: Decoder state reset");
     }
     
+    // 抖动缓冲中的包、环形缓冲中的样本和未完成的P3包属于旧状态，一并丢弃
+    reset_jitter_state();
+    clear_pcm_ring();
+    p3_parser.reset();
+    pipeline.reset();
+    envelope.reset();
+    generator_pending.clear();
+    
     // 可选择是否重置统计信息
     // reset_statistics();
 }
@@ -108,36 +216,38 @@ PackedByteArray OpusSessionDecoder::decode_packet(const PackedByteArray& opus_da
     PackedByteArray result;
     
     if (!session_active || decoder == nullptr) {
-        UtilityFunctions::print("OpusSessionDecoder: No active session. Call start_session() first.");
+        CODEC_LOG_ERROR("OpusSessionDecoder: No active session. Call start_session() first.");
         return result;
     }
     
     if (opus_data.size() == 0) {
-        UtilityFunctions::print("OpusSessionDecoder: Empty opus data");
+        CODEC_LOG_ERROR("OpusSessionDecoder: Empty opus data");
         return result;
     }
     
-    // 分配解码缓冲区
-    opus_int16* pcm_buffer = new opus_int16[MAX_FRAME_SIZE * CHANNELS];
-    
-    // 解码 Opus 包
-    int decoded_samples = opus_decode(decoder, opus_data.ptr(), opus_data.size(), pcm_buffer, MAX_FRAME_SIZE, 0);
+    // 解码到会话持有的暂存区，只有返回给脚本的结果需要分配
+    uint64_t started_usec = CodecMetrics::now_usec();
+    int decoded_samples = opus_decode(decoder, opus_data.ptr(), opus_data.size(), pcm_scratch.data(), max_frame_size, 0);
     
     if (decoded_samples > 0) {
+        analyze_envelope(pcm_scratch.data(), decoded_samples);
+        
         // 转换为 PackedByteArray
-        int pcm_bytes = decoded_samples * CHANNELS * sizeof(opus_int16);
+        int pcm_bytes = decoded_samples * channels * sizeof(opus_int16);
         result.resize(pcm_bytes);
-        memcpy(result.ptrw(), pcm_buffer, pcm_bytes);
+        CodecMetrics::record_allocation();
+        memcpy(result.ptrw(), pcm_scratch.data(), pcm_bytes);
         
         // 更新统计信息
         total_decoded_samples += decoded_samples;
         packet_count++;
+        record_decode_metrics(1, opus_data.size(), pcm_bytes, decoded_samples, started_usec);
         
     } else if (decoded_samples < 0) {
-        UtilityFunctions::print("OpusSessionDecoder: Decode failed: ", opus_strerror(decoded_samples));
+        CODEC_LOG_ERROR("OpusSessionDecoder: Decode failed: ", opus_strerror(decoded_samples));
+        CodecMetrics::record_error();
     }
     
-    delete[] pcm_buffer;
     return result;
 }
 
@@ -145,30 +255,73 @@ PackedByteArray OpusSessionDecoder::decode_packets(const Array& opus_packets) {
     PackedByteArray result;
     
     if (!session_active || decoder == nullptr) {
-        UtilityFunctions::print("OpusSessionDecoder: No active session. Call start_session() first.");
+        CODEC_LOG_ERROR("OpusSessionDecoder: No active session. Call start_session() first.");
         return result;
     }
     
     if (opus_packets.size() == 0) {
-        UtilityFunctions::print("OpusSessionDecoder: Empty packets array");
+        CODEC_LOG_ERROR("OpusSessionDecoder: Empty packets array");
         return result;
     }
     
-    UtilityFunctions::print("OpusSessionDecoder: Decoding ", opus_packets.size(), " packets...");
+    CODEC_LOG_VERBOSE("OpusSessionDecoder: Decoding ", opus_packets.size(), " packets...");
     
-    // 分配解码缓冲区
-    opus_int16* pcm_buffer = new opus_int16[MAX_FRAME_SIZE * CHANNELS];
-    PackedByteArray temp_pcm_data;
+    // 预扫描：通过包头计算总样本数，一次性分配输出缓冲区
+    uint64_t started_usec = CodecMetrics::now_usec();
+    int64_t bytes_in = 0;
+    int64_t expected_samples = 0;
+    for (int i = 0; i < opus_packets.size(); i++) {
+        Variant packet_variant = opus_packets[i];
+        
+        if (packet_variant.get_type() != Variant::PACKED_BYTE_ARRAY) {
+            CODEC_LOG_ERROR("OpusSessionDecoder: Packet ", i, " is not PackedByteArray, skipping");
+            continue;
+        }
+        
+        PackedByteArray opus_packet = packet_variant;
+        if (opus_packet.size() == 0) {
+            continue;
+        }
+        
+        int packet_samples = opus_packet_get_nb_samples(opus_packet.ptr(), opus_packet.size(), sample_rate);
+        if (packet_samples > 0) {
+            expected_samples += packet_samples;
+        }
+        bytes_in += opus_packet.size();
+    }
     
+    result.resize(expected_samples * channels * sizeof(opus_int16));
+    CodecMetrics::record_allocation();
+    opus_int16* pcm_out = reinterpret_cast<opus_int16*>(result.ptrw());
+    
+    // 批量解码，直接写入最终缓冲区；按声道数选择特化版本
     int success_count = 0;
+    int64_t batch_samples = channels == 2 ? decode_batch<2>(opus_packets, pcm_out, success_count)
+                                          : decode_batch<1>(opus_packets, pcm_out, success_count);
+    
+    // 解码失败的包不占用输出空间，最后裁剪一次
+    if (batch_samples != expected_samples) {
+        result.resize(batch_samples * channels * sizeof(opus_int16));
+    }
+    
+    // 更新统计信息
+    total_decoded_samples += batch_samples;
+    packet_count += success_count;
+    record_decode_metrics(success_count, bytes_in, result.size(), batch_samples, started_usec);
+    
+    CODEC_LOG_VERBOSE("OpusSessionDecoder: Batch complete - ", success_count, "/", opus_packets.size(), 
+                           " packets successful, ", batch_samples, " samples decoded");
+    
+    return result;
+}
+
+template <int Channels>
+int64_t OpusSessionDecoder::decode_batch(const Array& opus_packets, int16_t* pcm_out, int& success_count) {
     int64_t batch_samples = 0;
     
-    // 批量解码
     for (int i = 0; i < opus_packets.size(); i++) {
         Variant packet_variant = opus_packets[i];
-        
         if (packet_variant.get_type() != Variant::PACKED_BYTE_ARRAY) {
-            UtilityFunctions::print("OpusSessionDecoder: Packet ", i, " is not PackedByteArray, skipping");
             continue;
         }
         
@@ -177,36 +330,692 @@ PackedByteArray OpusSessionDecoder::decode_packets(const Array& opus_packets) {
             continue;
         }
         
+        int packet_samples = opus_packet_get_nb_samples(opus_packet.ptr(), opus_packet.size(), sample_rate);
+        if (packet_samples <= 0) {
+            CODEC_LOG_ERROR("OpusSessionDecoder: Packet ", i, " decode failed: ", opus_strerror(packet_samples < 0 ? packet_samples : OPUS_INVALID_PACKET));
+            CodecMetrics::record_error();
+            continue;
+        }
+        
         // 解码包
-        int decoded_samples = opus_decode(decoder, opus_packet.ptr(), opus_packet.size(), pcm_buffer, MAX_FRAME_SIZE, 0);
+        int decoded_samples = opus_decode(decoder, opus_packet.ptr(), opus_packet.size(), pcm_out + batch_samples * Channels, packet_samples, 0);
         
         if (decoded_samples > 0) {
-            // 添加到结果
-            int pcm_bytes = decoded_samples * CHANNELS * sizeof(opus_int16);
-            int old_size = temp_pcm_data.size();
-            temp_pcm_data.resize(old_size + pcm_bytes);
-            memcpy(temp_pcm_data.ptrw() + old_size, pcm_buffer, pcm_bytes);
-            
+            analyze_envelope(pcm_out + batch_samples * Channels, decoded_samples);
             success_count++;
             batch_samples += decoded_samples;
             
             if ((i + 1) % 50 == 0) {
-                UtilityFunctions::print("OpusSessionDecoder: Processed ", i + 1, "/", opus_packets.size(), " packets");
+                CODEC_LOG_VERBOSE("OpusSessionDecoder: Processed ", i + 1, "/", opus_packets.size(), " packets");
             }
         } else if (decoded_samples < 0) {
-            UtilityFunctions::print("OpusSessionDecoder: Packet ", i, " decode failed: ", opus_strerror(decoded_samples));
+            CODEC_LOG_ERROR("OpusSessionDecoder: Packet ", i, " decode failed: ", opus_strerror(decoded_samples));
+            CodecMetrics::record_error();
         }
     }
     
-    // 更新统计信息
-    total_decoded_samples += batch_samples;
-    packet_count += success_count;
+    return batch_samples;
+}
+
+// 按声道数特化的立体声帧写入：单声道上混，立体声按增益直接拷贝
+template <int Channels>
+static void write_stereo_frames(const float* pcm, Vector2* frames, int count, float gain) {
+#ifdef REAL_T_IS_DOUBLE
+    for (int s = 0; s < count; s++) {
+        if constexpr (Channels == 1) {
+            frames[s] = Vector2(pcm[s] * gain, pcm[s] * gain);
+        } else {
+            frames[s] = Vector2(pcm[s * 2] * gain, pcm[s * 2 + 1] * gain);
+        }
+    }
+#else
+    // Vector2为两个float，可按交错立体声直接写入
+    if constexpr (Channels == 1) {
+        audio_kernels::upmix_mono_to_stereo(pcm, reinterpret_cast<float*>(frames), count, gain);
+    } else {
+        audio_kernels::scale(pcm, reinterpret_cast<float*>(frames), count * 2, gain);
+    }
+#endif
+}
+
+int64_t OpusSessionDecoder::decode_packets_to_frames(const Array& opus_packets, float gain, PackedVector2Array& frames) {
+    if (!session_active || decoder == nullptr) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: No active session. Call start_session() first.");
+        return 0;
+    }
     
-    UtilityFunctions::print("OpusSessionDecoder: Batch complete - ", success_count, "/", opus_packets.size(), 
-                           " packets successful, ", batch_samples, " samples decoded");
+    // 预扫描：通过包头计算总帧数，一次性分配输出
+    uint64_t started_usec = CodecMetrics::now_usec();
+    int64_t expected_frames = 0;
+    for (int i = 0; i < opus_packets.size(); i++) {
+        Variant packet_variant = opus_packets[i];
+        if (packet_variant.get_type() != Variant::PACKED_BYTE_ARRAY) {
+            continue;
+        }
+        
+        PackedByteArray opus_packet = packet_variant;
+        if (opus_packet.size() == 0) {
+            continue;
+        }
+        
+        int packet_samples = opus_packet_get_nb_samples(opus_packet.ptr(), opus_packet.size(), sample_rate);
+        if (packet_samples > 0) {
+            expected_frames += packet_samples;
+        }
+    }
+    
+    frames.resize(expected_frames);
+    CodecMetrics::record_allocation();
+    Vector2* frames_out = frames.ptrw();
+    int64_t written_frames = 0;
+    int64_t bytes_in = 0;
+    int decoded_packets = 0;
+    
+    for (int i = 0; i < opus_packets.size(); i++) {
+        Variant packet_variant = opus_packets[i];
+        if (packet_variant.get_type() != Variant::PACKED_BYTE_ARRAY) {
+            continue;
+        }
+        
+        PackedByteArray opus_packet = packet_variant;
+        if (opus_packet.size() == 0) {
+            continue;
+        }
+        
+        // opus_decode_float输出[-1, 1]浮点，省去int16到float的转换
+        int decoded_samples = opus_decode_float(decoder, opus_packet.ptr(), opus_packet.size(), float_buffer.data(), max_frame_size, 0);
+        if (decoded_samples < 0) {
+            CODEC_LOG_ERROR("OpusSessionDecoder: Packet ", i, " decode failed: ", opus_strerror(decoded_samples));
+            CodecMetrics::record_error();
+            continue;
+        }
+        if (written_frames + decoded_samples > expected_frames) {
+            decoded_samples = (int)(expected_frames - written_frames);
+        }
+        
+        if (channels == 2) {
+            write_stereo_frames<2>(float_buffer.data(), frames_out + written_frames, decoded_samples, gain);
+        } else {
+            write_stereo_frames<1>(float_buffer.data(), frames_out + written_frames, decoded_samples, gain);
+        }
+        
+        written_frames += decoded_samples;
+        total_decoded_samples += decoded_samples;
+        packet_count++;
+        bytes_in += opus_packet.size();
+        decoded_packets++;
+    }
+    
+    // 解码失败的包不占用输出空间，最后裁剪一次
+    if (written_frames != expected_frames) {
+        frames.resize(written_frames);
+    }
+    record_decode_metrics(decoded_packets, bytes_in, written_frames * (int64_t)sizeof(Vector2), written_frames, started_usec);
+    
+    return written_frames;
+}
+
+PackedVector2Array OpusSessionDecoder::decode_packet_frames(const PackedByteArray& opus_data, float gain) {
+    Array opus_packets;
+    opus_packets.append(opus_data);
+    return decode_packets_frames(opus_packets, gain);
+}
+
+PackedVector2Array OpusSessionDecoder::decode_packets_frames(const Array& opus_packets, float gain) {
+    PackedVector2Array frames;
+    decode_packets_to_frames(opus_packets, gain, frames);
+    return frames;
+}
+
+int OpusSessionDecoder::push_packets_to_generator(const Ref<AudioStreamGeneratorPlayback>& playback, const Array& opus_packets, float gain) {
+    if (playback.is_null()) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Invalid generator playback");
+        return 0;
+    }
+    
+    if (!session_active || decoder == nullptr) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: No active session. Call start_session() first.");
+        return 0;
+    }
+    
+    // 上次放不下的包排在前面，保持播放顺序
+    for (int i = 0; i < opus_packets.size(); i++) {
+        Variant packet_variant = opus_packets[i];
+        if (packet_variant.get_type() == Variant::PACKED_BYTE_ARRAY && PackedByteArray(packet_variant).size() > 0) {
+            generator_pending.append(packet_variant);
+        }
+    }
+    while (generator_pending.size() > MAX_GENERATOR_PENDING_PACKETS) {
+        generator_pending.pop_front();
+        generator_dropped_packets++;
+    }
+    
+    // 先按包头计算帧数，只解码放得下的包；解码后再丢帧会让解码器状态越过丢掉的音频，留下无法恢复的空洞
+    int available = playback->get_frames_available();
+    Array batch;
+    int64_t batch_frames = 0;
+    while (generator_pending.size() > 0) {
+        PackedByteArray opus_packet = generator_pending[0];
+        int packet_samples = opus_packet_get_nb_samples(opus_packet.ptr(), opus_packet.size(), sample_rate);
+        if (packet_samples > 0 && batch_frames + packet_samples > available) {
+            break;
+        }
+        // 无效包也交给解码循环，由它记录错误
+        batch.append(opus_packet);
+        batch_frames += packet_samples > 0 ? packet_samples : 0;
+        generator_pending.pop_front();
+    }
+    if (batch.size() == 0) {
+        return 0;
+    }
+    
+    PackedVector2Array frames;
+    int64_t frame_count = decode_packets_to_frames(batch, gain, frames);
+    if (frame_count == 0 || !playback->push_buffer(frames)) {
+        return 0;
+    }
+    return (int)frame_count;
+}
+
+int OpusSessionDecoder::decode_to(const uint8_t* opus_data, int size, int16_t* pcm, int max_samples) {
+    if (!session_active || decoder == nullptr) {
+        return OPUS_INVALID_STATE;
+    }
+    
+    uint64_t started_usec = CodecMetrics::now_usec();
+    int decoded_samples = opus_decode(decoder, opus_data, size, pcm, max_samples, 0);
+    if (decoded_samples > 0) {
+        analyze_envelope(pcm, decoded_samples);
+        total_decoded_samples += decoded_samples;
+        packet_count++;
+        record_decode_metrics(1, size, decoded_samples * channels * (int64_t)sizeof(int16_t), decoded_samples, started_usec);
+    } else if (decoded_samples < 0) {
+        CodecMetrics::record_error();
+    }
+    return decoded_samples;
+}
+
+// ========== PCM Ring Buffer ==========
+
+void OpusSessionDecoder::allocate_pcm_ring() {
+    // 容量至少容纳一个最大帧，否则每包都会覆盖自身
+    int capacity = opus_config::frame_samples(sample_rate, pcm_ring_ms);
+    if (capacity < max_frame_size) {
+        capacity = max_frame_size;
+    }
+    if (pcm_ring.configure(capacity, channels)) {
+        CodecMetrics::record_allocation();
+    }
+}
+
+void OpusSessionDecoder::set_pcm_ring_capacity_ms(int capacity_ms) {
+    pcm_ring_ms = capacity_ms > 0 ? capacity_ms : DEFAULT_PCM_RING_MS;
+    allocate_pcm_ring();
+}
+
+void OpusSessionDecoder::clear_pcm_ring() {
+    pcm_ring.clear();
+}
+
+int OpusSessionDecoder::decode_packet_to_ring(const PackedByteArray& opus_data) {
+    if (!session_active || decoder == nullptr) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: No active session. Call start_session() first.");
+        return OPUS_INVALID_STATE;
+    }
+    
+    return decode_to_ring(opus_data.ptr(), opus_data.size());
+}
+
+int OpusSessionDecoder::decode_to_ring(const uint8_t* opus_data, int size) {
+    int decoded_samples = decode_to(opus_data, size, pcm_scratch.data(), max_frame_size);
+    if (decoded_samples <= 0) {
+        if (decoded_samples < 0) {
+            CODEC_LOG_ERROR("OpusSessionDecoder: Decode failed: ", opus_strerror(decoded_samples));
+        }
+        return decoded_samples;
+    }
+    
+    // 空间不足时丢弃最旧的样本，保证延迟有上限
+    pcm_ring.write(pcm_scratch.data(), decoded_samples);
+    return decoded_samples;
+}
+
+int OpusSessionDecoder::feed_p3_data(const uint8_t* data, int64_t size) {
+    if (!session_active || decoder == nullptr) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: No active session. Call start_session() first.");
+        return OPUS_INVALID_STATE;
+    }
+    
+    // 完整落在本块内的包直接从输入解码，不做拷贝；单个包解码失败不影响后续包
+    int total_samples = 0;
+    p3::ReadResult read_result = p3_parser.feed(data, size, [this, &total_samples](const uint8_t* packet, int packet_len) {
+        int decoded_samples = decode_to_ring(packet, packet_len);
+        if (decoded_samples > 0) {
+            total_samples += decoded_samples;
+        }
+    });
+    
+    if (read_result == p3::READ_INVALID_LENGTH) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Invalid P3 packet header in byte stream, pending bytes dropped");
+        CodecMetrics::record_error();
+        return OPUS_INVALID_PACKET;
+    }
+    return total_samples;
+}
+
+int OpusSessionDecoder::feed_p3_bytes(const PackedByteArray& chunk) {
+    return feed_p3_data(chunk.ptr(), chunk.size());
+}
+
+int OpusSessionDecoder::feed_p3_stream(const Ref<StreamPeer>& peer) {
+    if (peer.is_null()) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Invalid StreamPeer");
+        return OPUS_BAD_ARG;
+    }
+    
+    int available = peer->get_available_bytes();
+    if (available <= 0) {
+        return 0;
+    }
+    
+    // get_partial_data返回[错误码, 数据]
+    Array result = peer->get_partial_data(available);
+    if ((int)result[0] != OK) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Failed to read from StreamPeer: ", result[0]);
+        return OPUS_INTERNAL_ERROR;
+    }
+    return feed_p3_bytes(result[1]);
+}
+
+int OpusSessionDecoder::read_pcm_into(int16_t* pcm, int max_samples) {
+    return pcm_ring.read(pcm, max_samples);
+}
+
+PackedByteArray OpusSessionDecoder::read_pcm(int max_samples) {
+    PackedByteArray result;
+    int available = get_pcm_available();
+    int samples = max_samples < available ? max_samples : available;
+    if (samples <= 0) {
+        return result;
+    }
+    
+    result.resize(samples * channels * sizeof(int16_t));
+    read_pcm_into(reinterpret_cast<int16_t*>(result.ptrw()), samples);
+    return result;
+}
+
+// ========== Lip-sync Envelope ==========
+
+bool OpusSessionDecoder::enable_envelope(int window_ms) {
+    if (window_ms <= 0) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Invalid envelope window ", window_ms, "ms");
+        return false;
+    }
+    
+    // 表按当前格式生成；start_session换格式时会重新生成
+    envelope_window_ms = window_ms;
+    envelope.configure(sample_rate, channels, envelope_window_ms);
+    
+    // 窗口存放在预留好的固定容量中，解码路径上不再分配；调用方不取走时丢弃最旧的窗口
+    int max_windows = ENVELOPE_HISTORY_MS / window_ms;
+    envelope.set_max_windows(max_windows > 0 ? max_windows : 1);
+    CodecMetrics::record_allocation();
+    return true;
+}
+
+void OpusSessionDecoder::disable_envelope() {
+    envelope_window_ms = 0;
+    envelope.configure(sample_rate, channels, 0);
+}
+
+PackedFloat32Array OpusSessionDecoder::take_envelope() {
+    PackedFloat32Array result;
+    const std::vector<float>& windows = envelope.get_output();
+    if (!windows.empty()) {
+        result.resize(windows.size());
+        memcpy(result.ptrw(), windows.data(), windows.size() * sizeof(float));
+        envelope.clear_output();
+    }
+    return result;
+}
+
+Dictionary OpusSessionDecoder::decode_packets_with_envelope(const Array& opus_packets) {
+    // 批量调用返回这批包的全部窗口，不受保留时长限制；返回前已取走，恢复上限不会丢窗口
+    int max_windows = envelope.get_max_windows();
+    envelope.set_max_windows(0);
+    Dictionary result;
+    result["pcm"] = decode_packets(opus_packets);
+    result["envelope"] = take_envelope();
+    envelope.set_max_windows(max_windows);
+    return result;
+}
+
+// ========== Pipeline Mode ==========
+
+bool OpusSessionDecoder::enable_pipeline(int capacity_ms, bool decode_on_worker) {
+    if (!session_active || decoder == nullptr) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: No active session. Call start_session() first.");
+        return false;
+    }
     
-    delete[] pcm_buffer;
-    return temp_pcm_data;
+    disable_pipeline();
+    if (capacity_ms <= 0) {
+        capacity_ms = DEFAULT_PCM_RING_MS;
+    }
+    
+    // 两个环在这里一次分配，之后推包、解码和读取都不再分配内存
+    pipeline.configure(decoder, sample_rate, channels, max_frame_size,
+                       capacity_ms * PIPELINE_PACKET_BYTES_PER_MS, opus_config::frame_samples(sample_rate, capacity_ms));
+    CodecMetrics::record_allocation();
+    pipeline_on_worker = decode_on_worker;
+    pipeline_enabled = true;
+    
+    CODEC_LOG_INFO("OpusSessionDecoder: Pipeline enabled (", capacity_ms, "ms, decode on ", decode_on_worker ? "worker" : "producer", ")");
+    return true;
+}
+
+void OpusSessionDecoder::disable_pipeline() {
+    wait_pipeline_task();
+    pipeline_enabled = false;
+}
+
+void OpusSessionDecoder::wait_pipeline_task() {
+    if (pipeline_task_id >= 0) {
+        WorkerThreadPool::get_singleton()->wait_for_task_completion(pipeline_task_id);
+        pipeline_task_id = -1;
+    }
+}
+
+bool OpusSessionDecoder::pipeline_push_packet(const PackedByteArray& opus_data) {
+    return pipeline_push_data(opus_data.ptr(), opus_data.size());
+}
+
+bool OpusSessionDecoder::pipeline_push_data(const uint8_t* opus_data, int size) {
+    if (!pipeline_enabled) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Pipeline not enabled. Call enable_pipeline() first.");
+        return false;
+    }
+    if (!p3::is_valid_data_len(size)) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Invalid pipeline packet size ", size);
+        CodecMetrics::record_error();
+        return false;
+    }
+    
+    // 包环已满时本包被丢弃，但仍推进解码，让滞留的包尽快腾出空间
+    bool queued = pipeline.push_packet(opus_data, size);
+    pipeline_decode();
+    return queued;
+}
+
+void OpusSessionDecoder::pipeline_decode() {
+    if (!pipeline_enabled) {
+        return;
+    }
+    if (pipeline_on_worker) {
+        schedule_pipeline_decode();
+    } else {
+        pipeline_decode_step();
+    }
+}
+
+bool OpusSessionDecoder::pipeline_decode_step() {
+    uint64_t started_usec = CodecMetrics::now_usec();
+    DecodePipeline::DecodeStats stats;
+    bool drained = pipeline.decode_pending(&stats);
+    if (stats.packets > 0) {
+        record_decode_metrics(stats.packets, stats.bytes_in, stats.frames * channels * (int64_t)sizeof(int16_t), stats.frames, started_usec);
+    }
+    for (int i = 0; i < stats.errors; i++) {
+        CodecMetrics::record_error();
+    }
+    return drained;
+}
+
+void OpusSessionDecoder::schedule_pipeline_decode() {
+    // 已有任务在运行时它会继续处理新包，不重复派发
+    if (!pipeline.request_worker_decode()) {
+        return;
+    }
+    
+    // 上一个任务已清除标志，只差返回；回收它后再派发新任务
+    wait_pipeline_task();
+    pipeline_task_id = WorkerThreadPool::get_singleton()->add_task(callable_mp(this, &OpusSessionDecoder::pipeline_decode_task), true, "OpusSessionDecoder pipeline decode");
+}
+
+void OpusSessionDecoder::pipeline_decode_task() {
+    // 交接逻辑在核心库中，可脱离Godot在ThreadSanitizer下压力测试
+    pipeline.run_worker_decode([this]() { return pipeline_decode_step(); });
+}
+
+int OpusSessionDecoder::pipeline_pop_into(int16_t* pcm, int frames) {
+    if (!pipeline_enabled || frames <= 0) {
+        return 0;
+    }
+    return pipeline.read_pcm(pcm, frames);
+}
+
+PackedByteArray OpusSessionDecoder::pipeline_pop_pcm(int frames) {
+    PackedByteArray result;
+    if (!pipeline_enabled || frames <= 0) {
+        return result;
+    }
+    
+    result.resize(frames * channels * sizeof(int16_t));
+    pipeline.read_pcm(reinterpret_cast<int16_t*>(result.ptrw()), frames);
+    return result;
+}
+
+int OpusSessionDecoder::get_pipeline_buffered_frames() const {
+    return pipeline_enabled ? pipeline.get_buffered_frames() : 0;
+}
+
+// ========== Jitter Buffer ==========
+
+void OpusSessionDecoder::reset_jitter_state() {
+    playout_started = false;
+    jitter_packets.clear();
+    next_sequence = 0;
+    frame_samples = opus_config::frame_samples(sample_rate, DEFAULT_FRAME_MS);
+    jitter_units = 0.0;
+    last_transit = 0;
+    has_transit = false;
+    empty_frames = 0;
+    frames_since_adjust = 0;
+    concealed_frames = 0;
+    fec_recovered_frames = 0;
+    inserted_frames = 0;
+    skipped_frames = 0;
+    late_packets = 0;
+}
+
+void OpusSessionDecoder::enable_jitter_buffer(int min_depth, int max_depth, int p_timestamp_rate) {
+    min_depth_ms = min_depth > 0 ? min_depth : 0;
+    max_depth_ms = max_depth > min_depth_ms ? max_depth : min_depth_ms;
+    timestamp_rate = p_timestamp_rate > 0 ? p_timestamp_rate : DEFAULT_TIMESTAMP_RATE;
+    jitter_enabled = true;
+    reset_jitter_state();
+}
+
+void OpusSessionDecoder::disable_jitter_buffer() {
+    jitter_enabled = false;
+    reset_jitter_state();
+}
+
+int OpusSessionDecoder::get_target_depth_packets() const {
+    // 目标深度 = 一帧 + 4倍抖动，限制在[min, max]之间，换算为包数
+    double frame_ms = (double)frame_samples * 1000.0 / sample_rate;
+    double target_ms = frame_ms + 4.0 * get_jitter_ms();
+    if (target_ms < min_depth_ms) {
+        target_ms = min_depth_ms;
+    }
+    if (target_ms > max_depth_ms) {
+        target_ms = max_depth_ms;
+    }
+    int packets = (int)((target_ms + frame_ms - 1.0) / frame_ms);
+    return packets > 1 ? packets : 1;
+}
+
+bool OpusSessionDecoder::push_jitter_packet(int64_t sequence, int64_t timestamp, const PackedByteArray& opus_data) {
+    if (!jitter_enabled || !session_active || opus_data.size() == 0) {
+        return false;
+    }
+    
+    // 已经播放过（或已被补偿）的序号视为迟到包
+    if (playout_started && sequence < next_sequence) {
+        late_packets++;
+        return false;
+    }
+    
+    // RFC 3550 抖动估计：到达时间与时间戳之差的变化量做平滑；到达时间按时间戳时钟计量，
+    // 发送端的时钟与会话输出采样率不同时也不会产生恒定漂移
+    int64_t arrival = (int64_t)(Time::get_singleton()->get_ticks_usec() * timestamp_rate / 1000000);
+    int64_t transit = arrival - timestamp;
+    if (has_transit) {
+        int64_t delta = transit - last_transit;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        jitter_units += ((double)delta - jitter_units) / 16.0;
+    }
+    last_transit = transit;
+    has_transit = true;
+    
+    jitter_packets[sequence] = opus_data;
+    
+    // 超出最大深度时丢弃最旧的包以限制延迟
+    int max_packets = (int)((int64_t)max_depth_ms * sample_rate / 1000 / frame_samples) + 1;
+    while ((int)jitter_packets.size() > max_packets) {
+        int64_t oldest = jitter_packets.begin()->first;
+        jitter_packets.erase(jitter_packets.begin());
+        if (playout_started && oldest >= next_sequence) {
+            next_sequence = oldest + 1;
+        }
+        late_packets++;
+    }
+    
+    return true;
+}
+
+PackedByteArray OpusSessionDecoder::pop_jitter_frame() {
+    PackedByteArray result;
+    
+    if (!jitter_enabled || !session_active || decoder == nullptr) {
+        return result;
+    }
+    
+    // 缓冲阶段：积累到目标深度后才开始播放
+    if (!playout_started) {
+        if ((int)jitter_packets.size() < get_target_depth_packets()) {
+            return result;
+        }
+        playout_started = true;
+        next_sequence = jitter_packets.begin()->first;
+        empty_frames = 0;
+        frames_since_adjust = 0;
+    }
+    
+    // 解码到会话持有的暂存区，结果只在最后按实际长度分配一次
+    uint64_t started_usec = CodecMetrics::now_usec();
+    opus_int16* pcm = pcm_scratch.data();
+    int decoded_samples;
+    int64_t bytes_in = 0;
+    
+    // 每次取帧都重新计算目标深度，并向目标修正：过深时跳过一帧，过浅时插入一帧PLC
+    int adjustment = 0;
+    std::map<int64_t, PackedByteArray>::iterator current = jitter_packets.find(next_sequence);
+    frames_since_adjust++;
+    if (current != jitter_packets.end() && frames_since_adjust >= JITTER_ADJUST_INTERVAL) {
+        int target = get_target_depth_packets();
+        int depth = (int)jitter_packets.size();
+        if (depth > target + 1 && jitter_packets.count(next_sequence + 1) != 0) {
+            adjustment = 1;
+        } else if (depth < target) {
+            adjustment = -1;
+        }
+    }
+    
+    if (adjustment > 0) {
+        // 丢弃最旧的一帧：仍然解码以保持解码器状态连续，但不输出
+        opus_decode(decoder, current->second.ptr(), current->second.size(), pcm, max_frame_size, 0);
+        bytes_in += current->second.size();
+        jitter_packets.erase(current);
+        next_sequence++;
+        current = jitter_packets.find(next_sequence);
+        skipped_frames++;
+        frames_since_adjust = 0;
+    }
+    
+    if (adjustment < 0) {
+        // 插入一帧PLC，不消耗缓冲中的包，深度随下一个到达的包增加一帧
+        decoded_samples = opus_decode(decoder, nullptr, 0, pcm, frame_samples, 0);
+        inserted_frames++;
+        frames_since_adjust = 0;
+    } else if (current != jitter_packets.end()) {
+        // 正常解码
+        decoded_samples = opus_decode(decoder, current->second.ptr(), current->second.size(), pcm, max_frame_size, 0);
+        bytes_in += current->second.size();
+        jitter_packets.erase(current);
+        empty_frames = 0;
+        
+        int last_duration = 0;
+        if (decoded_samples > 0 && opus_decoder_ctl(decoder, OPUS_GET_LAST_PACKET_DURATION(&last_duration)) == OPUS_OK && last_duration > 0) {
+            frame_samples = last_duration;
+        }
+        next_sequence++;
+    } else {
+        std::map<int64_t, PackedByteArray>::iterator following = jitter_packets.find(next_sequence + 1);
+        if (following != jitter_packets.end()) {
+            // 下一包已到达：用其带内FEC数据恢复丢失的包
+            decoded_samples = opus_decode(decoder, following->second.ptr(), following->second.size(), pcm, frame_samples, 1);
+            fec_recovered_frames++;
+            CodecMetrics::record_fec_recovered(1);
+        } else {
+            // 无可用数据：PLC丢包补偿
+            decoded_samples = opus_decode(decoder, nullptr, 0, pcm, frame_samples, 0);
+            concealed_frames++;
+            CodecMetrics::record_concealed(1);
+        }
+        
+        // 缓冲长时间为空说明对方已停止发送，重新进入缓冲阶段
+        if (jitter_packets.empty() && ++empty_frames > JITTER_RESYNC_EMPTY_FRAMES) {
+            playout_started = false;
+        }
+        next_sequence++;
+    }
+    
+    if (decoded_samples < 0) {
+        CODEC_LOG_ERROR("OpusSessionDecoder: Jitter buffer decode failed: ", opus_strerror(decoded_samples));
+        CodecMetrics::record_error();
+        decoded_samples = 0;
+    }
+    analyze_envelope(pcm, decoded_samples);
+    
+    total_decoded_samples += decoded_samples;
+    packet_count++;
+    int pcm_bytes = decoded_samples * channels * sizeof(opus_int16);
+    if (pcm_bytes > 0) {
+        result.resize(pcm_bytes);
+        CodecMetrics::record_allocation();
+        memcpy(result.ptrw(), pcm, pcm_bytes);
+    }
+    record_decode_metrics(1, bytes_in, pcm_bytes, decoded_samples, started_usec);
+    return result;
+}
+
+void OpusSessionDecoder::record_decode_metrics(int64_t packets, int64_t bytes_in, int64_t bytes_out, int64_t samples, uint64_t started_usec) const {
+    CodecMetrics::record_decode(packets, bytes_in, bytes_out, CodecMetrics::now_usec() - started_usec, samples * 1000000 / sample_rate);
+}
+
+int OpusSessionDecoder::get_jitter_buffer_target_ms() const {
+    return (int)((int64_t)get_target_depth_packets() * frame_samples * 1000 / sample_rate);
+}
+
+int OpusSessionDecoder::get_jitter_buffered_packets() const {
+    return (int)jitter_packets.size();
+}
+
+double OpusSessionDecoder::get_jitter_ms() const {
+    return jitter_units * 1000.0 / timestamp_rate;
 }
 
 // ========== Statistics and Info ==========
@@ -216,7 +1025,7 @@ int64_t OpusSessionDecoder::get_total_decoded_samples() const {
 }
 
 double OpusSessionDecoder::get_total_decoded_duration() const {
-    return (double)total_decoded_samples / SAMPLE_RATE;
+    return (double)total_decoded_samples / sample_rate;
 }
 
 int OpusSessionDecoder::get_packet_count() const {
@@ -226,5 +1035,5 @@ int OpusSessionDecoder::get_packet_count() const {
 void OpusSessionDecoder::reset_statistics() {
     total_decoded_samples = 0;
     packet_count = 0;
-    UtilityFunctions::print("OpusSessionDecoder: Statistics reset");
+    CODEC_LOG_INFO("OpusSessionDecoder: Statistics reset");
 } 
\ No newline at end of file
@@ -1,9 +1,21 @@
 #ifndef OPUS_SESSION_DECODER_H
 #define OPUS_SESSION_DECODER_H
 
+#include <godot_cpp/classes/audio_stream_generator_playback.hpp>
 #include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/classes/stream_peer.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
 #include <godot_cpp/variant/string.hpp>
+#include "decode_pipeline.h"
+#include "envelope_analyzer.h"
+#include "opus_config.h"
+#include "p3_stream_parser.h"
+#include "pcm_ring.h"
+#include <map>
+#include <vector>
 
 // Forward declaration for Opus
 struct OpusDecoder;
@@ -14,14 +26,92 @@ class OpusSessionDecoder : public RefCounted {
     GDCLASS(OpusSessionDecoder, RefCounted)
 
 private:
-    static constexpr int SAMPLE_RATE = 16000;  // Fixed sample rate at 16000Hz
-    static constexpr int CHANNELS = 1;         // Mono channel
-    static constexpr int MAX_FRAME_SIZE = SAMPLE_RATE * 120 / 1000;  // 120ms max frame size
+    static constexpr int DEFAULT_FRAME_MS = 60;              // 抖动缓冲在收到首包前假定的帧长
+    static constexpr int DEFAULT_TIMESTAMP_RATE = 48000;     // RTP中Opus的时间戳时钟（RFC 7587），与解码采样率无关
+    static constexpr int JITTER_RESYNC_EMPTY_FRAMES = 8;     // 连续空缓冲帧数超过此值后重新缓冲
+    static constexpr int JITTER_ADJUST_INTERVAL = 4;         // 两次深度修正（跳帧或插帧）之间至少间隔的帧数
+    static constexpr int DEFAULT_PCM_RING_MS = 500;          // PCM环形缓冲默认容量
+    static constexpr int PIPELINE_PACKET_BYTES_PER_MS = 16;  // 流水线包环按128kbps的码率估算容量
+    static constexpr int MAX_GENERATOR_PENDING_PACKETS = 32; // 生成器放不下时暂存的未解码包上限
+    static constexpr int ENVELOPE_HISTORY_MS = 2000;         // 未取走的包络窗口最多保留的时长，超出时丢弃最旧的窗口
 
     OpusDecoder* decoder;
+    int sample_rate;                                        // 会话输出采样率
+    int channels;                                           // 会话输出声道数
+    int max_frame_size;                                     // 120ms最大帧的每声道样本数
     bool session_active;
     int64_t total_decoded_samples;
     int packet_count;
+    
+    std::vector<float> float_buffer;                        // 浮点解码暂存区（按最大配置的一帧分配，会话间复用）
+    std::vector<int16_t> pcm_scratch;                       // 整数解码暂存区（同上），取代每包new/delete
+    
+    // PCM环形缓冲：decode_packet_to_ring写入，read_pcm读出，稳态下不分配堆内存
+    PcmRing pcm_ring;                                       // 容量在start_session时按格式分配，写满时丢弃最旧样本
+    int pcm_ring_ms;
+
+    // P3字节流输入：跨块的不完整包暂存在解析器中
+    p3::StreamParser p3_parser;
+
+    // 口型包络：16位解码路径在每包解码后立即分析（样本仍在缓存中），跨调用连续分窗
+    EnvelopeAnalyzer envelope;
+    int envelope_window_ms;                                 // 0表示关闭
+
+    // 生成器输出：放不下的包保持未解码，留到下次调用，解码器状态不会越过被丢弃的音频
+    Array generator_pending;
+    int64_t generator_dropped_packets;                      // 暂存超过上限时丢弃的最旧包
+    void analyze_envelope(const int16_t* pcm, int samples) {
+        if (samples > 0 && envelope.is_enabled()) {
+            envelope.process(pcm, samples);
+        }
+    }
+
+    // 流水线模式：网络线程推包，解码在推包线程或工作线程上进行，音频线程无锁读取PCM
+    DecodePipeline pipeline;
+    bool pipeline_enabled;
+    bool pipeline_on_worker;
+    int64_t pipeline_task_id;                               // 最近一次解码任务，由推包线程持有
+
+    // 抖动缓冲状态
+    bool jitter_enabled;
+    bool playout_started;
+    std::map<int64_t, PackedByteArray> jitter_packets;      // 按序号排序的待播放包
+    int64_t next_sequence;                                  // 下一个要播放的序号
+    int min_depth_ms;
+    int max_depth_ms;
+    int frame_samples;                                      // 最近一包的时长，用于PLC/FEC
+    int timestamp_rate;                                     // 包时间戳的时钟频率
+    double jitter_units;                                    // RFC 3550到达间隔抖动估计（时间戳单位）
+    int64_t last_transit;
+    bool has_transit;
+    int empty_frames;
+    int frames_since_adjust;
+    int64_t concealed_frames;
+    int64_t fec_recovered_frames;
+    int64_t inserted_frames;                                // 缓冲过浅时插入的PLC帧数
+    int64_t skipped_frames;                                 // 缓冲过深时跳过的帧数
+    int64_t late_packets;
+
+    void reset_jitter_state();
+    int get_target_depth_packets() const;
+    
+    // 将包解码为浮点并上混为立体声帧写入frames，返回写入的帧数
+    int64_t decode_packets_to_frames(const Array& opus_packets, float gain, PackedVector2Array& frames);
+    
+    // 按声道数特化的批量解码循环，返回写入pcm_out的每声道样本数
+    template <int Channels>
+    int64_t decode_batch(const Array& opus_packets, int16_t* pcm_out, int& success_count);
+    
+    void allocate_pcm_ring();                               // 按当前格式和容量分配环形缓冲并清空
+    int decode_to_ring(const uint8_t* opus_data, int size);  // 解码一个包并写入环形缓冲
+    
+    bool pipeline_decode_step();                            // 排空包环并记录指标，PCM环写满而停下时返回false
+    void schedule_pipeline_decode();                        // 推包线程调用：没有任务在运行时派发一个
+    void pipeline_decode_task();                            // WorkerThreadPool任务体
+    void wait_pipeline_task();
+    
+    // 每次调用汇总一次全局编解码指标
+    void record_decode_metrics(int64_t packets, int64_t bytes_in, int64_t bytes_out, int64_t samples, uint64_t started_usec) const;
 
 protected:
     static void _bind_methods();
@@ -31,7 +121,7 @@ public:
     ~OpusSessionDecoder();
 
     // Session management
-    bool start_session();                                           // 开始解码会话
+    bool start_session(int sample_rate = opus_config::SAMPLE_RATE_AUTO, int channels = opus_config::DEFAULT_CHANNELS);  // 开始解码会话，默认采样率与引擎混音采样率一致
     void end_session();                                            // 结束解码会话
     void reset_session();                                          // 重置会话状态
     bool is_session_active() const;                               // 检查会话状态
@@ -40,6 +130,75 @@ public:
     PackedByteArray decode_packet(const PackedByteArray& opus_data);  // 解码单个包
     PackedByteArray decode_packets(const Array& opus_packets);        // 批量解码包
     
+    // 浮点解码，直接输出立体声帧（可直接交给AudioStreamGeneratorPlayback）
+    PackedVector2Array decode_packet_frames(const PackedByteArray& opus_data, float gain = 1.0f);   // 解码单个包
+    PackedVector2Array decode_packets_frames(const Array& opus_packets, float gain = 1.0f);         // 批量解码包
+    int push_packets_to_generator(const Ref<AudioStreamGeneratorPlayback>& playback, const Array& opus_packets, float gain = 1.0f);  // 解码放得下的包并推入生成器，返回推入的帧数；其余包留到下次调用
+    int get_generator_pending_packets() const { return generator_pending.size(); }       // 等待生成器空间的包数
+    int64_t get_generator_dropped_packets() const { return generator_dropped_packets; }  // 暂存超过上限时丢弃的包数
+    
+    // 解码到调用方提供的缓冲区（仅供C++使用），返回每声道样本数或Opus错误码
+    int decode_to(const uint8_t* opus_data, int size, int16_t* pcm, int max_samples);
+    
+    // PCM ring buffer (zero allocations per packet; check CodecMetrics.get_allocations())
+    int decode_packet_to_ring(const PackedByteArray& opus_data);        // 解码到环形缓冲，返回每声道样本数或Opus错误码；写满时丢弃最旧样本
+    PackedByteArray read_pcm(int max_samples);                          // 读出至多max_samples个每声道样本（16位PCM）
+    int read_pcm_into(int16_t* pcm, int max_samples);                   // 读到调用方缓冲区（仅供C++使用），返回每声道样本数
+    void clear_pcm_ring();
+    void set_pcm_ring_capacity_ms(int capacity_ms);                     // 重新分配并清空环形缓冲
+    int get_pcm_ring_capacity_ms() const { return pcm_ring_ms; }
+    int get_pcm_available() const { return pcm_ring.get_available(); }  // 可读的每声道样本数
+    int get_pcm_free() const { return pcm_ring.get_free(); }
+    int64_t get_pcm_dropped_samples() const { return pcm_ring.get_dropped_frames(); }
+    
+    // P3 byte stream input: chunks of any size, packets decoded into the PCM ring
+    int feed_p3_bytes(const PackedByteArray& chunk);                    // 解析4字节包头并解码完整的包，返回新增的每声道样本数；流格式错误时返回OPUS_INVALID_PACKET
+    int feed_p3_data(const uint8_t* data, int64_t size);                // 同上（仅供C++使用）
+    int feed_p3_stream(const Ref<StreamPeer>& peer);                    // 读取peer当前可用的全部字节并解码
+    int get_p3_pending_bytes() const { return p3_parser.get_pending_bytes(); }  // 等待后续数据的不完整包字节数
+    
+    // Lip-sync envelope (16-bit decode paths; the float frame paths and the pipeline are not analyzed)
+    bool enable_envelope(int window_ms = 20);                           // 每个窗口输出rms、peak和4个频带电平（均为0..1）
+    void disable_envelope();
+    bool is_envelope_enabled() const { return envelope_window_ms > 0; }
+    PackedFloat32Array take_envelope();                                 // 取出上次调用以来完成的窗口（最多保留最近2秒）
+    int64_t get_envelope_dropped_windows() const { return envelope.get_dropped_windows(); }  // 未及时取走而丢弃的窗口数
+    Dictionary decode_packets_with_envelope(const Array& opus_packets);  // 批量解码：{"pcm": PackedByteArray, "envelope": PackedFloat32Array}
+    
+    // Pipeline mode: one network thread pushes, one audio thread pops, no locks.
+    // 开启后只能由推包线程调用pipeline_push_*/pipeline_decode，由音频线程调用pipeline_pop_*；
+    // 其他会话方法须在两个线程都停止后调用
+    bool enable_pipeline(int capacity_ms = 200, bool decode_on_worker = false);  // 需要活跃会话；capacity_ms为PCM环容量
+    void disable_pipeline();                                            // 等待工作线程上的解码任务结束
+    bool is_pipeline_enabled() const { return pipeline_enabled; }
+    bool is_pipeline_decoding_on_worker() const { return pipeline_on_worker; }
+    bool pipeline_push_packet(const PackedByteArray& opus_data);        // 推包线程：放入一个包并解码或派发解码；包环已满时丢弃并计为溢出
+    bool pipeline_push_data(const uint8_t* opus_data, int size);        // 同上（仅供C++使用）
+    void pipeline_decode();                                             // 推包线程：重试因PCM环写满而滞留的包
+    PackedByteArray pipeline_pop_pcm(int frames);                       // 音频线程：总是返回frames个每声道样本，不足部分补零并计为欠载
+    int pipeline_pop_into(int16_t* pcm, int frames);                    // 同上，无等待且不分配内存（仅供C++使用），返回实际取出的每声道样本数
+    int get_pipeline_buffered_frames() const;                           // PCM环中可读的每声道样本数
+    int64_t get_pipeline_overruns() const { return pipeline.get_overruns(); }          // 包环已满丢弃的包数
+    int64_t get_pipeline_underruns() const { return pipeline.get_underruns(); }        // 未能读满的pop次数
+    int64_t get_pipeline_underrun_frames() const { return pipeline.get_underrun_frames(); }  // 补零的每声道样本数
+    int64_t get_pipeline_decoded_packets() const { return pipeline.get_decoded_packets(); }
+    void reset_pipeline_counters() { pipeline.reset_counters(); }
+    
+    // Jitter buffer (sequence/timestamp input, one frame out per pop)
+    void enable_jitter_buffer(int min_depth = 60, int max_depth = 480, int timestamp_rate = DEFAULT_TIMESTAMP_RATE);  // 开启自适应抖动缓冲（毫秒），timestamp_rate为发送端时间戳的时钟频率
+    void disable_jitter_buffer();                                       // 关闭抖动缓冲
+    bool is_jitter_buffer_enabled() const { return jitter_enabled; }
+    bool push_jitter_packet(int64_t sequence, int64_t timestamp, const PackedByteArray& opus_data);  // 放入一个包（timestamp以timestamp_rate为单位）
+    PackedByteArray pop_jitter_frame();                                 // 取出一帧：正常解码、FEC恢复或PLC补偿，缓冲中返回空；播放中向目标深度修正
+    int get_jitter_buffer_target_ms() const;                            // 当前目标缓冲深度
+    int get_jitter_buffered_packets() const;                            // 当前缓冲包数
+    double get_jitter_ms() const;                                       // 估计的网络抖动
+    int64_t get_concealed_frames() const { return concealed_frames; }   // PLC补偿帧数
+    int64_t get_fec_recovered_frames() const { return fec_recovered_frames; }  // FEC恢复帧数
+    int64_t get_inserted_frames() const { return inserted_frames; }     // 缓冲低于目标深度时插入的PLC帧数
+    int64_t get_skipped_frames() const { return skipped_frames; }       // 缓冲超过目标深度时跳过的帧数
+    int64_t get_late_packets() const { return late_packets; }           // 迟到丢弃的包数
+    
     // Statistics and info
     int64_t get_total_decoded_samples() const;                     // 获取总解码样本数
     double get_total_decoded_duration() const;                     // 获取总解码时长
@@ -47,9 +206,9 @@ public:
     void reset_statistics();                                       // 重置统计信息
     
     // Audio parameters
-    int get_sample_rate() const { return SAMPLE_RATE; }
-    int get_channels() const { return CHANNELS; }
-    int get_max_frame_size() const { return MAX_FRAME_SIZE; }
+    int get_sample_rate() const { return sample_rate; }
+    int get_channels() const { return channels; }
+    int get_max_frame_size() const { return max_frame_size; }
 };
 
 #endif // OPUS_SESSION_DECODER_H 
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef OUTPUT_RATE_H
+#define OUTPUT_RATE_H
+
+#include <godot_cpp/classes/audio_server.hpp>
+#include "opus_config.h"
+
+// Resolve opus_config::SAMPLE_RATE_AUTO to the decode rate matching the
+// engine mix rate; Opus decodes any stream at any supported rate, so audio
+// decoded at the mix rate needs no 16kHz to mix rate conversion afterwards.
+// Other values are returned unchanged.
+inline int resolve_output_rate(int sample_rate) {
+    if (sample_rate != opus_config::SAMPLE_RATE_AUTO) {
+        return sample_rate;
+    }
+
+    godot::AudioServer* server = godot::AudioServer::get_singleton();
+    int mix_rate = server != nullptr ? (int)server->get_mix_rate() : opus_config::MAX_SAMPLE_RATE;
+    return opus_config::output_rate_for(mix_rate);
+}
+
+#endif // OUTPUT_RATE_H
@@ -0,0 +1,281 @@
+#include "p3_decode_service.h"
+#include "codec_log.h"
+#include "output_rate.h"
+#include "p3_decoder.h"
+#include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+#include <algorithm>
+
+using namespace godot;
+
+void P3DecodeService::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("submit_buffer", "p3_data", "priority"), &P3DecodeService::submit_buffer, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("submit_file", "file_path", "priority"), &P3DecodeService::submit_file, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("cancel", "job_id"), &P3DecodeService::cancel);
+    ClassDB::bind_method(D_METHOD("wait", "job_id"), &P3DecodeService::wait);
+    ClassDB::bind_method(D_METHOD("get_status", "job_id"), &P3DecodeService::get_status);
+    ClassDB::bind_method(D_METHOD("set_max_concurrent_jobs", "max_jobs"), &P3DecodeService::set_max_concurrent_jobs);
+    ClassDB::bind_method(D_METHOD("get_max_concurrent_jobs"), &P3DecodeService::get_max_concurrent_jobs);
+    ClassDB::bind_method(D_METHOD("set_sample_rate", "sample_rate"), &P3DecodeService::set_sample_rate);
+    ClassDB::bind_method(D_METHOD("get_sample_rate"), &P3DecodeService::get_sample_rate);
+    ClassDB::bind_method(D_METHOD("get_pending_job_count"), &P3DecodeService::get_pending_job_count);
+    ClassDB::bind_method(D_METHOD("get_running_job_count"), &P3DecodeService::get_running_job_count);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_concurrent_jobs"), "set_max_concurrent_jobs", "get_max_concurrent_jobs");
+
+    ADD_SIGNAL(MethodInfo("job_completed", PropertyInfo(Variant::INT, "job_id"), PropertyInfo(Variant::PACKED_BYTE_ARRAY, "pcm_data")));
+    ADD_SIGNAL(MethodInfo("job_failed", PropertyInfo(Variant::INT, "job_id")));
+
+    BIND_ENUM_CONSTANT(JOB_UNKNOWN);
+    BIND_ENUM_CONSTANT(JOB_QUEUED);
+    BIND_ENUM_CONSTANT(JOB_RUNNING);
+    BIND_ENUM_CONSTANT(JOB_DONE);
+    BIND_ENUM_CONSTANT(JOB_FAILED);
+    BIND_ENUM_CONSTANT(JOB_CANCELLED);
+}
+
+P3DecodeService::P3DecodeService() {
+    next_job_id = 1;
+    running_jobs = 0;
+    // Leave cores for the main and audio threads
+    int cores = OS::get_singleton()->get_processor_count();
+    max_concurrent_jobs = cores > 2 ? cores - 1 : 1;
+    sample_rate = resolve_output_rate(opus_config::SAMPLE_RATE_AUTO);
+}
+
+P3DecodeService::~P3DecodeService() {
+    // Running tasks reference this object; stop them and join before teardown
+    std::vector<int64_t> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.clear();
+        for (std::pair<const int, std::unique_ptr<Job>>& entry : jobs) {
+            Job* job = entry.second.get();
+            job->cancel = true;
+            if (job->task_id >= 0 && !job->task_waited) {
+                tasks.push_back(job->task_id);
+                job->task_waited = true;
+            }
+        }
+    }
+
+    WorkerThreadPool* pool = WorkerThreadPool::get_singleton();
+    for (int64_t task_id : tasks) {
+        pool->wait_for_task_completion(task_id);
+    }
+}
+
+// ========== Submission ==========
+
+int P3DecodeService::submit(Job* job) {
+    std::lock_guard<std::mutex> lock(mutex);
+    job->id = next_job_id++;
+    job->status = JOB_QUEUED;
+    job->cancel = false;
+    job->task_id = -1;
+    job->task_waited = false;
+    jobs[job->id] = std::unique_ptr<Job>(job);
+
+    // Insert after every job of the same or higher priority
+    std::vector<Job*>::iterator position = std::upper_bound(pending.begin(), pending.end(), job,
+            [](const Job* a, const Job* b) { return a->priority > b->priority; });
+    pending.insert(position, job);
+
+    dispatch_locked();
+    return job->id;
+}
+
+int P3DecodeService::submit_buffer(const PackedByteArray& p3_data, int priority) {
+    Job* job = new Job();
+    job->priority = priority;
+    job->is_file = false;
+    job->sample_rate = sample_rate;
+    job->data = p3_data;
+    return submit(job);
+}
+
+int P3DecodeService::submit_file(const String& file_path, int priority) {
+    Job* job = new Job();
+    job->priority = priority;
+    job->is_file = true;
+    job->sample_rate = sample_rate;
+    job->path = file_path;
+    return submit(job);
+}
+
+void P3DecodeService::dispatch_locked() {
+    WorkerThreadPool* pool = WorkerThreadPool::get_singleton();
+    while (running_jobs < max_concurrent_jobs && !pending.empty()) {
+        Job* job = pending.front();
+        pending.erase(pending.begin());
+        job->status = JOB_RUNNING;
+        running_jobs++;
+        job->task_id = pool->add_task(callable_mp(this, &P3DecodeService::run_job).bind(job->id), job->priority > 0, "P3DecodeService job");
+    }
+}
+
+// ========== Execution ==========
+
+void P3DecodeService::execute_job(Job* job) {
+    // A fresh decoder per job: decoder states come from OpusCodecPool, so
+    // concurrent jobs never share one
+    Ref<P3Decoder> decoder;
+    decoder.instantiate();
+    decoder->configure(job->sample_rate);
+    decoder->set_cancel_flag(&job->cancel);
+    PackedByteArray result = job->is_file ? decoder->decode_p3_file(job->path) : decoder->decode_p3(job->data);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    job->data = PackedByteArray();
+    if (job->cancel) {
+        job->status = JOB_CANCELLED;
+    } else if (result.size() == 0) {
+        job->status = JOB_FAILED;
+    } else {
+        job->status = JOB_DONE;
+        job->result = result;
+    }
+}
+
+void P3DecodeService::run_job(int job_id) {
+    Job* job;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = jobs[job_id].get();
+    }
+
+    execute_job(job);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running_jobs--;
+        dispatch_locked();
+    }
+    callable_mp(this, &P3DecodeService::finish_job).call_deferred(job_id);
+}
+
+void P3DecodeService::finish_job(int job_id) {
+    int64_t task_id = -1;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<int, std::unique_ptr<Job>>::iterator found = jobs.find(job_id);
+        if (found == jobs.end() || found->second->task_waited) {
+            // Already collected by wait()
+            return;
+        }
+        found->second->task_waited = true;
+        task_id = found->second->task_id;
+    }
+
+    // The task body has returned, so this does not block
+    WorkerThreadPool::get_singleton()->wait_for_task_completion(task_id);
+
+    JobStatus status;
+    PackedByteArray result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<int, std::unique_ptr<Job>>::iterator found = jobs.find(job_id);
+        status = found->second->status;
+        result = found->second->result;
+        jobs.erase(found);
+    }
+
+    if (status == JOB_DONE) {
+        emit_signal("job_completed", job_id, result);
+    } else if (status == JOB_FAILED) {
+        emit_signal("job_failed", job_id);
+    }
+}
+
+// ========== Control ==========
+
+bool P3DecodeService::cancel(int job_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<int, std::unique_ptr<Job>>::iterator found = jobs.find(job_id);
+    if (found == jobs.end()) {
+        return false;
+    }
+
+    Job* job = found->second.get();
+    if (job->status == JOB_QUEUED) {
+        pending.erase(std::find(pending.begin(), pending.end(), job));
+        jobs.erase(found);
+        return true;
+    }
+    if (job->status == JOB_RUNNING) {
+        job->cancel = true;
+        return true;
+    }
+    return false;
+}
+
+PackedByteArray P3DecodeService::wait(int job_id) {
+    Job* job = nullptr;
+    bool run_here = false;
+    int64_t task_id = -1;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<int, std::unique_ptr<Job>>::iterator found = jobs.find(job_id);
+        if (found == jobs.end()) {
+            return PackedByteArray();
+        }
+
+        job = found->second.get();
+        if (job->status == JOB_QUEUED) {
+            // Do not wait behind the queue; decode on the calling thread
+            pending.erase(std::find(pending.begin(), pending.end(), job));
+            job->status = JOB_RUNNING;
+            run_here = true;
+        } else if (job->task_id >= 0 && !job->task_waited) {
+            task_id = job->task_id;
+            job->task_waited = true;
+        }
+    }
+
+    if (run_here) {
+        execute_job(job);
+    } else if (task_id >= 0) {
+        WorkerThreadPool::get_singleton()->wait_for_task_completion(task_id);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    PackedByteArray result = job->status == JOB_DONE ? job->result : PackedByteArray();
+    jobs.erase(job_id);
+    return result;
+}
+
+P3DecodeService::JobStatus P3DecodeService::get_status(int job_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<int, std::unique_ptr<Job>>::iterator found = jobs.find(job_id);
+    return found != jobs.end() ? found->second->status : JOB_UNKNOWN;
+}
+
+void P3DecodeService::set_max_concurrent_jobs(int max_jobs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_concurrent_jobs = max_jobs > 0 ? max_jobs : 1;
+    dispatch_locked();
+}
+
+bool P3DecodeService::set_sample_rate(int p_sample_rate) {
+    p_sample_rate = resolve_output_rate(p_sample_rate);
+    if (!opus_config::is_valid_sample_rate(p_sample_rate)) {
+        CODEC_LOG_ERROR("P3DecodeService: Unsupported sample rate ", p_sample_rate);
+        return false;
+    }
+
+    sample_rate = p_sample_rate;
+    return true;
+}
+
+int P3DecodeService::get_pending_job_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)pending.size();
+}
+
+int P3DecodeService::get_running_job_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return running_jobs;
+}
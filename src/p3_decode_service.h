@@ -0,0 +1,107 @@
+#ifndef P3_DECODE_SERVICE_H
+#define P3_DECODE_SERVICE_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace godot;
+
+// Background decoding of many P3 buffers or files. Jobs are queued by
+// priority and run as WorkerThreadPool tasks, at most max_concurrent_jobs at
+// a time, each with its own pooled Opus decoder. Completion is reported on
+// the main thread through the job_completed/job_failed signals; wait() blocks
+// for one job instead (and takes over its result, so no signal follows).
+//
+// All methods must be called from the main thread.
+class P3DecodeService : public RefCounted {
+    GDCLASS(P3DecodeService, RefCounted)
+
+public:
+    enum JobStatus {
+        JOB_UNKNOWN,    // Never submitted, or already finished and reported
+        JOB_QUEUED,
+        JOB_RUNNING,
+        JOB_DONE,       // Decoded, completion not yet reported
+        JOB_FAILED,
+        JOB_CANCELLED,
+    };
+
+private:
+    struct Job {
+        int id;
+        int priority;
+        bool is_file;
+        int sample_rate;
+        PackedByteArray data;
+        String path;
+        JobStatus status;
+        std::atomic<bool> cancel;
+        PackedByteArray result;
+        int64_t task_id;
+        bool task_waited;
+    };
+
+    std::map<int, std::unique_ptr<Job>> jobs;
+    std::vector<Job*> pending;      // Highest priority first, FIFO within a priority
+    std::mutex mutex;
+    int next_job_id;
+    int running_jobs;
+    int max_concurrent_jobs;
+    int sample_rate;                // Output rate of new jobs, resolved from SAMPLE_RATE_AUTO
+
+    int submit(Job* job);
+
+    // Start queued jobs while below max_concurrent_jobs; caller holds mutex
+    void dispatch_locked();
+
+    // Decode one job on the calling thread and store its result and status
+    void execute_job(Job* job);
+
+    // WorkerThreadPool task body
+    void run_job(int job_id);
+
+    // Deferred to the main thread after run_job: joins the task and emits the signal
+    void finish_job(int job_id);
+
+protected:
+    static void _bind_methods();
+
+public:
+    P3DecodeService();
+    ~P3DecodeService();
+
+    // Queue a decode; higher priority runs first. Returns the job id.
+    int submit_buffer(const PackedByteArray& p3_data, int priority = 0);
+    int submit_file(const String& file_path, int priority = 0);
+
+    // Drop a queued job or stop a running one between packets
+    bool cancel(int job_id);
+
+    // Block until the job has finished and return its PCM (empty on failure).
+    // A queued job is decoded right away on the calling thread.
+    PackedByteArray wait(int job_id);
+
+    JobStatus get_status(int job_id);
+
+    // Global limit on jobs decoding at the same time
+    void set_max_concurrent_jobs(int max_jobs);
+    int get_max_concurrent_jobs() const { return max_concurrent_jobs; }
+
+    // PCM rate of jobs submitted from now on (mono); SAMPLE_RATE_AUTO (0, the
+    // default) matches the engine mix rate
+    bool set_sample_rate(int p_sample_rate);
+    int get_sample_rate() const { return sample_rate; }
+
+    int get_pending_job_count();
+    int get_running_job_count();
+};
+
+VARIANT_ENUM_CAST(P3DecodeService::JobStatus);
+
+#endif // P3_DECODE_SERVICE_H
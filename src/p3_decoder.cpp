@@ -1,120 +1,508 @@
 #include "p3_decoder.h"
+#include "codec_log.h"
+#include "codec_metrics.h"
+#include "opus_codec_pool.h"
+#include "output_rate.h"
+#include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 #include <godot_cpp/core/class_db.hpp>
-#include <godot_cpp/variant/utility_functions.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
 #include <opus.h>
 #include <cstring>
+#include <vector>
 
 using namespace godot;
 
+namespace {
+
+// One metrics update per decode call
+void record_decode_metrics(int64_t packets, int64_t bytes_in, int64_t samples, int sample_rate, int channels, uint64_t started_usec) {
+    CodecMetrics::record_decode(packets, bytes_in, samples * channels * (int64_t)sizeof(int16_t),
+                                CodecMetrics::now_usec() - started_usec, samples * 1000000 / sample_rate);
+}
+
+} // namespace
+
 void P3Decoder::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("configure", "sample_rate", "channels"), &P3Decoder::configure, DEFVAL(opus_config::SAMPLE_RATE_AUTO), DEFVAL(opus_config::DEFAULT_CHANNELS));
     ClassDB::bind_method(D_METHOD("decode_p3", "p3_data"), &P3Decoder::decode_p3);
+    ClassDB::bind_method(D_METHOD("decode_p3_file", "file_path"), &P3Decoder::decode_p3_file);
+    ClassDB::bind_method(D_METHOD("decode_p3_parallel", "p3_data", "segment_count"), &P3Decoder::decode_p3_parallel, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("decode_range", "p3_data", "start_sec", "end_sec", "index"), &P3Decoder::decode_range, DEFVAL(-1.0), DEFVAL(Ref<P3Index>()));
+    ClassDB::bind_method(D_METHOD("set_envelope_window_ms", "window_ms"), &P3Decoder::set_envelope_window_ms);
+    ClassDB::bind_method(D_METHOD("get_envelope_window_ms"), &P3Decoder::get_envelope_window_ms);
+    ClassDB::bind_method(D_METHOD("get_envelope"), &P3Decoder::get_envelope);
+    ClassDB::bind_method(D_METHOD("decode_p3_with_envelope", "p3_data", "window_ms"), &P3Decoder::decode_p3_with_envelope, DEFVAL(20));
     ClassDB::bind_method(D_METHOD("get_sample_rate"), &P3Decoder::get_sample_rate);
     ClassDB::bind_method(D_METHOD("get_channels"), &P3Decoder::get_channels);
+
+    BIND_CONSTANT(ENVELOPE_STRIDE);
 }
 
 P3Decoder::P3Decoder() {
+    sample_rate = resolve_output_rate(opus_config::SAMPLE_RATE_AUTO);
+    channels = opus_config::DEFAULT_CHANNELS;
+    max_frame_size = opus_config::frame_samples(sample_rate, opus_config::MAX_FRAME_MS);
+    parallel_job = nullptr;
+    cancel_flag = nullptr;
+    envelope_window_ms = 0;
 }
 
 P3Decoder::~P3Decoder() {
 }
 
-uint16_t P3Decoder::be16_to_host(uint16_t value) {
-    return ((value & 0xFF) << 8) | ((value >> 8) & 0xFF);
+bool P3Decoder::configure(int p_sample_rate, int p_channels) {
+    p_sample_rate = resolve_output_rate(p_sample_rate);
+    if (!opus_config::is_valid_sample_rate(p_sample_rate) || !opus_config::is_valid_channels(p_channels)) {
+        CODEC_LOG_ERROR("Error: Unsupported output format ", p_sample_rate, " Hz, ", p_channels, " channels");
+        return false;
+    }
+
+    sample_rate = p_sample_rate;
+    channels = p_channels;
+    max_frame_size = opus_config::frame_samples(sample_rate, opus_config::MAX_FRAME_MS);
+    return true;
+}
+
+p3::ReadResult P3Decoder::decode_buffer(p3::DecodeState& state, const uint8_t* data, int64_t size, int64_t& pos) {
+    p3::ReadResult read_result = channels == 2 ? p3::decode_packets<2>(state, data, size, pos, cancel_flag)
+                                               : p3::decode_packets<1>(state, data, size, pos, cancel_flag);
+    if (state.error != OPUS_OK) {
+        CODEC_LOG_ERROR("Error: Opus decoding failed: ", opus_strerror(state.error));
+        CodecMetrics::record_error();
+    }
+
+    CODEC_LOG_VERBOSE("Processed ", state.packet_count, " packets...");
+    return read_result;
+}
+
+bool P3Decoder::scan_file(FileAccess* file, uint8_t* window, p3::ScanInfo& info) {
+    info.packet_count = 0;
+    info.total_samples = 0;
+    info.error_pos = -1;
+
+    // Same window and carry as the decode loop: a packet cut at the end of a
+    // chunk is moved to the front and checked once the next read completes it
+    uint64_t file_remaining = file->get_length();
+    int64_t window_len = 0;
+    int64_t window_offset = 0;  // File offset of window[0]
+    file->seek(0);
+
+    while (true) {
+        if (file_remaining > 0) {
+            uint64_t read_bytes = file->get_buffer(window + window_len, READ_WINDOW_SIZE - window_len);
+            if (read_bytes == 0) {
+                info.error_pos = window_offset + window_len;
+                return false;
+            }
+            window_len += read_bytes;
+            file_remaining -= read_bytes;
+        }
+
+        int64_t window_pos = 0;
+        while (true) {
+            const uint8_t* packet = nullptr;
+            int packet_len = 0;
+            p3::ReadResult read_result = p3::read_packet(window, window_len, window_pos, packet, packet_len);
+            if (read_result == p3::READ_END || (read_result == p3::READ_TRUNCATED && file_remaining > 0)) {
+                break;
+            }
+
+            int packet_samples = read_result == p3::READ_OK ? opus_packet_get_nb_samples(packet, packet_len, sample_rate) : -1;
+            if (packet_samples <= 0) {
+                info.error_pos = window_offset + (read_result == p3::READ_OK ? window_pos - packet_len - p3::HEADER_SIZE : window_pos);
+                return false;
+            }
+
+            info.packet_count++;
+            info.total_samples += packet_samples;
+        }
+
+        // Fewer than HEADER_SIZE trailing bytes are ignored, as in scan_packets
+        if (file_remaining == 0) {
+            return true;
+        }
+
+        window_len -= window_pos;
+        memmove(window, window + window_pos, window_len);
+        window_offset += window_pos;
+    }
 }
 
 PackedByteArray P3Decoder::decode_p3(const PackedByteArray& p3_data) {
     PackedByteArray result;
-    
+    envelope.reset();
+
     if (p3_data.size() == 0) {
-        UtilityFunctions::print("Error: Input binary data is empty");
+        CODEC_LOG_ERROR("Error: Input binary data is empty");
         return result;
     }
-    
+
+    // Pre-scan headers: rejects malformed data and gives the exact PCM length
+    const uint8_t* data_ptr = p3_data.ptr();
+    int64_t data_size = p3_data.size();
+    p3::ScanInfo scan;
+    if (!p3::scan_packets(data_ptr, data_size, sample_rate, scan)) {
+        CODEC_LOG_ERROR("Error: Malformed P3 packet at byte ", scan.error_pos);
+        CodecMetrics::record_error();
+        return result;
+    }
+
     // Initialize Opus decoder
-    int error;
-    OpusDecoder* decoder = opus_decoder_create(SAMPLE_RATE, CHANNELS, &error);
-    if (error != OPUS_OK) {
-        UtilityFunctions::print("Error: Failed to create Opus decoder: ", opus_strerror(error));
+    OpusDecoder* decoder = OpusCodecPool::acquire_decoder(sample_rate, channels);
+    if (decoder == nullptr) {
+        CODEC_LOG_ERROR("Error: Failed to create Opus decoder");
         return result;
     }
-    
-    UtilityFunctions::print("Starting to decode p3 data stream");
-    UtilityFunctions::print("Data size: ", p3_data.size(), " bytes");
-    UtilityFunctions::print("Sample rate: ", SAMPLE_RATE, " Hz, Channels: ", CHANNELS);
-    
-    // Allocate buffers
-    opus_int16* pcm_buffer = new opus_int16[FRAME_SIZE * CHANNELS];
-    unsigned char* opus_buffer = new unsigned char[4096];
-    
-    // Temporary array to store all PCM data
-    PackedByteArray temp_pcm_data;
-    
-    int packet_count = 0;
-    int64_t total_pcm_samples = 0;
+
+    CODEC_LOG_INFO("Starting to decode p3 data stream");
+    CODEC_LOG_INFO("Data size: ", p3_data.size(), " bytes");
+    CODEC_LOG_INFO("Sample rate: ", sample_rate, " Hz, Channels: ", channels);
+
+    // Size the output once and decode straight into it
+    uint64_t started_usec = CodecMetrics::now_usec();
+    result.resize(scan.total_samples * channels * sizeof(opus_int16));
+    CodecMetrics::record_allocation();
+
+    p3::DecodeState state;
+    state.begin(decoder, reinterpret_cast<int16_t*>(result.ptrw()), scan.total_samples, max_frame_size);
+    begin_envelope(state, scan.total_samples);
+
     int64_t data_pos = 0;
-    const uint8_t* data_ptr = p3_data.ptr();
-    int64_t data_size = p3_data.size();
-    
-    // Decode packet by packet
-    while (data_pos < data_size) {
-        // Check if there's enough data to read the header
-        if (data_pos + sizeof(P3Header) > data_size) {
-            break;
+    decode_buffer(state, data_ptr, data_size, data_pos);
+    envelope.finish();
+
+    if (state.total_pcm_samples != scan.total_samples) {
+        result.resize(state.total_pcm_samples * channels * sizeof(opus_int16));
+    }
+    record_decode_metrics(state.packet_count, data_pos, state.total_pcm_samples, sample_rate, channels, started_usec);
+
+    CODEC_LOG_INFO("Decoding completed!");
+    CODEC_LOG_INFO("Total processed packets: ", state.packet_count);
+    CODEC_LOG_INFO("Total PCM samples: ", state.total_pcm_samples);
+    CODEC_LOG_INFO("Audio duration: ", (double)state.total_pcm_samples / sample_rate, " seconds");
+
+    // Clean up resources
+    OpusCodecPool::release_decoder(decoder, channels);
+
+    return result;
+}
+
+PackedByteArray P3Decoder::decode_p3_file(const String& file_path) {
+    PackedByteArray result;
+    envelope.reset();
+
+    Ref<FileAccess> file = FileAccess::open(file_path, FileAccess::READ);
+    if (file.is_null()) {
+        CODEC_LOG_ERROR("Error: Failed to open ", file_path, " (error ", FileAccess::get_open_error(), ")");
+        return result;
+    }
+
+    uint64_t file_remaining = file->get_length();
+    if (file_remaining == 0) {
+        CODEC_LOG_ERROR("Error: P3 file is empty: ", file_path);
+        return result;
+    }
+
+    // One fixed read window for both passes; a packet cut at the end of a chunk
+    // is moved to the front and completed by the next read, so memory does not
+    // grow with the file.
+    uint8_t* window = new uint8_t[READ_WINDOW_SIZE];
+    int64_t window_len = 0;
+
+    // Pre-scan headers: rejects malformed files and gives the exact PCM length
+    p3::ScanInfo scan;
+    if (!scan_file(file.ptr(), window, scan)) {
+        CODEC_LOG_ERROR("Error: Malformed P3 packet at byte ", scan.error_pos, " in ", file_path);
+        CodecMetrics::record_error();
+        delete[] window;
+        return result;
+    }
+    file->seek(0);
+
+    // Initialize Opus decoder
+    OpusDecoder* decoder = OpusCodecPool::acquire_decoder(sample_rate, channels);
+    if (decoder == nullptr) {
+        CODEC_LOG_ERROR("Error: Failed to create Opus decoder");
+        delete[] window;
+        return result;
+    }
+
+    CODEC_LOG_INFO("Starting to decode p3 file: ", file_path);
+    CODEC_LOG_INFO("File size: ", (int64_t)file_remaining, " bytes");
+
+    uint64_t started_usec = CodecMetrics::now_usec();
+    result.resize(scan.total_samples * channels * sizeof(opus_int16));
+
+    p3::DecodeState state;
+    state.begin(decoder, reinterpret_cast<int16_t*>(result.ptrw()), scan.total_samples, max_frame_size);
+    begin_envelope(state, scan.total_samples);
+
+    CodecMetrics::record_allocation(2);
+
+    while (!state.failed()) {
+        if (file_remaining > 0) {
+            uint64_t read_bytes = file->get_buffer(window + window_len, READ_WINDOW_SIZE - window_len);
+            if (read_bytes == 0) {
+                CODEC_LOG_ERROR("Error: Read failed at ", (int64_t)(file->get_length() - file_remaining), " bytes");
+                CodecMetrics::record_error();
+                break;
+            }
+            window_len += read_bytes;
+            file_remaining -= read_bytes;
         }
-        
-        // Read p3 header (4 bytes)
-        P3Header header;
-        memcpy(&header, data_ptr + data_pos, sizeof(P3Header));
-        data_pos += sizeof(P3Header);
-        
-        // Convert big endian length field
-        uint16_t data_len = be16_to_host(header.data_len);
-        
-        if (data_len == 0 || data_len > 4096) {
-            UtilityFunctions::print("Error: Invalid data length ", data_len);
+
+        int64_t window_pos = 0;
+        decode_buffer(state, window, window_len, window_pos);
+        if (state.failed() || file_remaining == 0) {
             break;
         }
-        
-        // Check if there's enough data
-        if (data_pos + data_len > data_size) {
-            UtilityFunctions::print("Error: Incomplete Opus data (expected ", data_len, " bytes, remaining ", data_size - data_pos, " bytes)");
+
+        // Carry the partial header or payload over to the next chunk
+        window_len -= window_pos;
+        memmove(window, window + window_pos, window_len);
+    }
+    envelope.finish();
+
+    if (state.total_pcm_samples != scan.total_samples) {
+        result.resize(state.total_pcm_samples * channels * sizeof(opus_int16));
+    }
+    record_decode_metrics(state.packet_count, (int64_t)(file->get_length() - file_remaining), state.total_pcm_samples, sample_rate, channels, started_usec);
+
+    CODEC_LOG_INFO("Decoding completed!");
+    CODEC_LOG_INFO("Total processed packets: ", state.packet_count);
+    CODEC_LOG_INFO("Total PCM samples: ", state.total_pcm_samples);
+    CODEC_LOG_INFO("Audio duration: ", (double)state.total_pcm_samples / sample_rate, " seconds");
+
+    // Clean up resources
+    delete[] window;
+    OpusCodecPool::release_decoder(decoder, channels);
+
+    return result;
+}
+
+void P3Decoder::decode_segment(uint32_t segment) {
+    if (channels == 2) {
+        decode_segment_impl<2>(segment);
+    } else {
+        decode_segment_impl<1>(segment);
+    }
+}
+
+template <int Channels>
+void P3Decoder::decode_segment_impl(uint32_t segment) {
+    ParallelJob& job = *parallel_job;
+
+    OpusDecoder* decoder = OpusCodecPool::acquire_decoder(sample_rate, Channels);
+    if (decoder == nullptr) {
+        job.failed = true;
+        return;
+    }
+
+    int16_t preroll_buffer[opus_config::MAX_FRAME_CAPACITY];
+    int error = p3::decode_segment<Channels>(decoder, job.data, job.data_size, job.table, sample_rate,
+                                             job.segment_first[segment], job.segment_first[segment + 1],
+                                             job.preroll_packets, max_frame_size, job.pcm_out, preroll_buffer);
+    if (error != OPUS_OK) {
+        job.failed = true;
+    }
+
+    OpusCodecPool::release_decoder(decoder, Channels);
+}
+
+PackedByteArray P3Decoder::decode_p3_parallel(const PackedByteArray& p3_data, int segment_count) {
+    PackedByteArray result;
+
+    if (p3_data.size() == 0) {
+        CODEC_LOG_ERROR("Error: Input binary data is empty");
+        return result;
+    }
+
+    Ref<P3Index> index;
+    index.instantiate();
+    if (!index->build(p3_data)) {
+        return result;
+    }
+
+    int packet_count = index->get_packet_count();
+    if (segment_count <= 0) {
+        segment_count = OS::get_singleton()->get_processor_count();
+    }
+    if (segment_count > packet_count / MIN_SEGMENT_PACKETS) {
+        segment_count = packet_count / MIN_SEGMENT_PACKETS;
+    }
+    if (segment_count <= 1) {
+        return decode_p3(p3_data);
+    }
+
+    CODEC_LOG_INFO("Starting parallel decode: ", packet_count, " packets in ", segment_count, " segments");
+
+    // Packet boundaries of each segment
+    std::vector<int> segment_first(segment_count + 1);
+    for (int i = 0; i <= segment_count; i++) {
+        segment_first[i] = (int)((int64_t)packet_count * i / segment_count);
+    }
+
+    uint64_t started_usec = CodecMetrics::now_usec();
+    int64_t total_samples = index->get_total_samples(sample_rate);
+    result.resize(total_samples * channels * sizeof(opus_int16));
+    CodecMetrics::record_allocation();
+
+    ParallelJob job;
+    job.data = p3_data.ptr();
+    job.data_size = p3_data.size();
+    job.table = index->get_table();
+    job.pcm_out = reinterpret_cast<int16_t*>(result.ptrw());
+    job.segment_first = segment_first.data();
+    job.preroll_packets = p3::PARALLEL_PREROLL_PACKETS;
+    job.failed = false;
+    parallel_job = &job;
+
+    WorkerThreadPool* pool = WorkerThreadPool::get_singleton();
+    int64_t group_id = pool->add_group_task(callable_mp(this, &P3Decoder::decode_segment), segment_count, segment_count, false, "P3Decoder parallel decode");
+    pool->wait_for_group_task_completion(group_id);
+    parallel_job = nullptr;
+
+    if (job.failed) {
+        CODEC_LOG_ERROR("Error: Parallel decode failed");
+        CodecMetrics::record_error();
+        return PackedByteArray();
+    }
+    record_decode_metrics(packet_count, p3_data.size(), total_samples, sample_rate, channels, started_usec);
+
+    CODEC_LOG_INFO("Parallel decoding completed: ", total_samples, " samples, ", (double)total_samples / sample_rate, " seconds");
+    return result;
+}
+
+PackedByteArray P3Decoder::decode_range(const PackedByteArray& p3_data, double start_sec, double end_sec, const Ref<P3Index>& index) {
+    PackedByteArray result;
+
+    // Only the size is compared here; hashing the buffer would make every range
+    // cost the whole file. Callers verify a cached index once with matches().
+    Ref<P3Index> packet_index = index;
+    if (packet_index.is_null() || !packet_index->matches_size(p3_data)) {
+        packet_index.instantiate();
+        if (!packet_index->build(p3_data)) {
+            return result;
+        }
+    }
+
+    // Requested range in samples, clamped to the stream
+    int64_t total_samples = packet_index->get_total_samples(sample_rate);
+    int64_t range_start = start_sec > 0.0 ? (int64_t)(start_sec * sample_rate) : 0;
+    int64_t range_end = end_sec < 0.0 ? total_samples : (int64_t)(end_sec * sample_rate);
+    if (range_start > total_samples) {
+        range_start = total_samples;
+    }
+    if (range_end > total_samples) {
+        range_end = total_samples;
+    }
+    if (range_end <= range_start) {
+        return result;
+    }
+
+    // Start a few packets early so the decoder state settles before the range
+    int first_packet = packet_index->find_packet(range_start, sample_rate);
+    int decode_from = first_packet > RANGE_PREROLL_PACKETS ? first_packet - RANGE_PREROLL_PACKETS : 0;
+
+    OpusDecoder* decoder = OpusCodecPool::acquire_decoder(sample_rate, channels);
+    if (decoder == nullptr) {
+        CODEC_LOG_ERROR("Error: Failed to create Opus decoder");
+        return result;
+    }
+
+    uint64_t started_usec = CodecMetrics::now_usec();
+    result.resize((range_end - range_start) * channels * sizeof(opus_int16));
+    CodecMetrics::record_allocation();
+    int16_t* pcm_out = reinterpret_cast<int16_t*>(result.ptrw());
+    int16_t edge_buffer[opus_config::MAX_FRAME_CAPACITY];
+
+    const uint8_t* data_ptr = p3_data.ptr();
+    int64_t data_size = p3_data.size();
+    int64_t data_pos = packet_index->get_packet_offset(decode_from);
+    int64_t position = packet_index->get_packet_start(decode_from, sample_rate);
+    int64_t start_pos = data_pos;
+    int decoded_packets = 0;
+
+    while (position < range_end) {
+        const uint8_t* packet = nullptr;
+        int data_len = 0;
+        if (p3::read_packet(data_ptr, data_size, data_pos, packet, data_len) != p3::READ_OK) {
+            CODEC_LOG_ERROR("Error: Index does not match P3 data at byte ", data_pos);
+            CodecMetrics::record_error();
             break;
         }
-        
-        // Copy Opus data to buffer
-        memcpy(opus_buffer, data_ptr + data_pos, data_len);
-        data_pos += data_len;
-        
-        // Decode Opus data
-        int decoded_samples = opus_decode(decoder, opus_buffer, data_len, pcm_buffer, FRAME_SIZE, 0);
+
+        int packet_samples = opus_packet_get_nb_samples(packet, data_len, sample_rate);
+        int decoded_samples;
+
+        if (packet_samples > 0 && position >= range_start && position + packet_samples <= range_end) {
+            // Packet lies fully inside the range: decode in place
+            decoded_samples = opus_decode(decoder, packet, data_len, pcm_out + (position - range_start) * channels, packet_samples, 0);
+        } else {
+            // Pre-roll or edge packet: decode aside and keep only the overlap
+            decoded_samples = opus_decode(decoder, packet, data_len, edge_buffer, max_frame_size, 0);
+            if (decoded_samples > 0) {
+                int64_t copy_from = position > range_start ? position : range_start;
+                int64_t copy_to = position + decoded_samples < range_end ? position + decoded_samples : range_end;
+                if (copy_to > copy_from) {
+                    memcpy(pcm_out + (copy_from - range_start) * channels,
+                           edge_buffer + (copy_from - position) * channels,
+                           (copy_to - copy_from) * channels * sizeof(opus_int16));
+                }
+            }
+        }
+
         if (decoded_samples < 0) {
-            UtilityFunctions::print("Error: Opus decoding failed: ", opus_strerror(decoded_samples));
+            CODEC_LOG_ERROR("Error: Opus decoding failed: ", opus_strerror(decoded_samples));
+            CodecMetrics::record_error();
             break;
         }
-        
-        // Add PCM data to result
-        int pcm_bytes = decoded_samples * CHANNELS * sizeof(opus_int16);
-        int old_size = temp_pcm_data.size();
-        temp_pcm_data.resize(old_size + pcm_bytes);
-        memcpy(temp_pcm_data.ptrw() + old_size, pcm_buffer, pcm_bytes);
-        
-        packet_count++;
-        total_pcm_samples += decoded_samples;
-        
-        if (packet_count % 100 == 0) {
-            UtilityFunctions::print("Processed ", packet_count, " packets...");
-        }
+        position += decoded_samples;
+        decoded_packets++;
     }
-    
-    UtilityFunctions::print("Decoding completed!");
-    UtilityFunctions::print("Total processed packets: ", packet_count);
-    UtilityFunctions::print("Total PCM samples: ", total_pcm_samples);
-    UtilityFunctions::print("Audio duration: ", (double)total_pcm_samples / SAMPLE_RATE, " seconds");
-    
-    // Clean up resources
-    delete[] pcm_buffer;
-    delete[] opus_buffer;
-    opus_decoder_destroy(decoder);
-    
-    return temp_pcm_data;
-} 
\ No newline at end of file
+
+    int64_t decoded_end = position < range_end ? position : range_end;
+    if (decoded_end < range_end) {
+        result.resize((decoded_end > range_start ? decoded_end - range_start : 0) * channels * sizeof(opus_int16));
+    }
+    record_decode_metrics(decoded_packets, data_pos - start_pos, decoded_end > range_start ? decoded_end - range_start : 0, sample_rate, channels, started_usec);
+
+    OpusCodecPool::release_decoder(decoder, channels);
+    return result;
+}
+
+void P3Decoder::set_envelope_window_ms(int window_ms) {
+    envelope_window_ms = window_ms > 0 ? window_ms : 0;
+}
+
+void P3Decoder::begin_envelope(p3::DecodeState& state, int64_t total_samples) {
+    if (envelope_window_ms <= 0) {
+        return;
+    }
+    envelope.configure(sample_rate, channels, envelope_window_ms);
+    envelope.reserve(total_samples);
+    state.envelope = &envelope;
+}
+
+PackedFloat32Array P3Decoder::get_envelope() const {
+    PackedFloat32Array result;
+    const std::vector<float>& windows = envelope.get_output();
+    if (!windows.empty()) {
+        result.resize(windows.size());
+        memcpy(result.ptrw(), windows.data(), windows.size() * sizeof(float));
+    }
+    return result;
+}
+
+Dictionary P3Decoder::decode_p3_with_envelope(const PackedByteArray& p3_data, int window_ms) {
+    int previous_window_ms = envelope_window_ms;
+    set_envelope_window_ms(window_ms);
+
+    Dictionary result;
+    result["pcm"] = decode_p3(p3_data);
+    result["envelope"] = get_envelope();
+
+    envelope_window_ms = previous_window_ms;
+    return result;
+}
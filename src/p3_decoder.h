@@ -1,9 +1,20 @@
 #ifndef P3_DECODER_H
 #define P3_DECODER_H
 
+#include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
 #include <godot_cpp/variant/string.hpp>
+#include "envelope_analyzer.h"
+#include "opus_config.h"
+#include "p3_codec.h"
+#include "p3_index.h"
+#include <atomic>
+
+// Forward declaration for Opus
+struct OpusDecoder;
 
 using namespace godot;
 
@@ -11,33 +22,103 @@ class P3Decoder : public RefCounted {
     GDCLASS(P3Decoder, RefCounted)
 
 private:
-    // P3 format header structure
-    struct P3Header {
-        uint8_t packet_type;    // 1 byte type
-        uint8_t reserved;       // 1 byte reserved
-        uint16_t data_len;      // 2 bytes length (big endian)
+    // Output format; P3 streams are encoded at 16kHz mono but Opus can decode
+    // them at any supported rate and channel count
+    int sample_rate;
+    int channels;
+    int max_frame_size;  // Samples per channel in the longest (120ms) frame
+    static constexpr int RANGE_PREROLL_PACKETS = 3;  // Packets decoded and dropped before a range start
+    static constexpr int MIN_SEGMENT_PACKETS = 64;       // Smallest segment worth a separate decoder (~4s at 60ms)
+    static constexpr int READ_WINDOW_SIZE = 64 * 1024;  // Bytes read from disk per chunk by decode_p3_file
+
+    // Run the core decode loop (shared by the in-memory and the chunked file
+    // paths) for the configured channel count and report a decode error
+    p3::ReadResult decode_buffer(p3::DecodeState& state, const uint8_t* data, int64_t size, int64_t& pos);
+
+    // Per channel count specialization of the segment loop
+    template <int Channels>
+    void decode_segment_impl(uint32_t segment);
+
+    // Shared state of one decode_p3_parallel call, read by the worker tasks
+    struct ParallelJob {
+        const uint8_t* data;
+        int64_t data_size;
+        p3::PacketTable table;
+        int16_t* pcm_out;
+        const int* segment_first;   // First packet of each segment, plus one past the end
+        int preroll_packets;
+        std::atomic<bool> failed;
     };
+    ParallelJob* parallel_job;
 
-    static constexpr int SAMPLE_RATE = 16000;  // Fixed sample rate at 16000Hz
-    static constexpr int CHANNELS = 1;         // Mono channel
-    static constexpr int FRAME_SIZE = SAMPLE_RATE * 60 / 1000;  // 60ms frame size
+    // Checked between packets by decode_p3/decode_p3_file; set by P3DecodeService
+    const std::atomic<bool>* cancel_flag;
 
-    // Convert from big endian to host byte order
-    uint16_t be16_to_host(uint16_t value);
+    // Lip-sync envelope computed by decode_p3/decode_p3_file when enabled
+    int envelope_window_ms;
+    EnvelopeAnalyzer envelope;
+
+    // Configure the envelope for a decode of total_samples and attach it to state
+    void begin_envelope(p3::DecodeState& state, int64_t total_samples);
+
+    // WorkerThreadPool group task body: decode one segment with its own decoder
+    void decode_segment(uint32_t segment);
+
+    // Header-only pass over an open P3 file, read through window (READ_WINDOW_SIZE bytes)
+    bool scan_file(FileAccess* file, uint8_t* window, p3::ScanInfo& info);
 
 protected:
     static void _bind_methods();
 
 public:
+    static constexpr int ENVELOPE_STRIDE = EnvelopeAnalyzer::STRIDE;  // Floats per envelope window
+
     P3Decoder();
     ~P3Decoder();
 
+    // Abort decode_p3/decode_p3_file between packets once *flag becomes true (C++ only)
+    void set_cancel_flag(const std::atomic<bool>* flag) { cancel_flag = flag; }
+
+    // Select the PCM output format: 8000/12000/16000/24000/48000Hz, mono or
+    // stereo. The default, SAMPLE_RATE_AUTO, decodes at the rate matching the
+    // engine mix rate so the PCM can be played without resampling.
+    bool configure(int sample_rate = opus_config::SAMPLE_RATE_AUTO, int channels = opus_config::DEFAULT_CHANNELS);
+
     // Decode P3 binary data and return PCM data
     PackedByteArray decode_p3(const PackedByteArray& p3_data);
+
+    // Decode a P3 file, reading it in bounded chunks instead of loading it whole
+    PackedByteArray decode_p3_file(const String& file_path);
+
+    // Decode on WorkerThreadPool: the packet list is split into segments that
+    // are decoded in parallel straight into one pre-sized output. Each segment
+    // first decodes p3::PARALLEL_PREROLL_PACKETS (4) earlier packets and throws
+    // them away. The output is not bit-exact to decode_p3: samples after a
+    // segment boundary may differ by up to p3::PARALLEL_MAX_SAMPLE_ERROR (128,
+    // about -48 dBFS); the largest difference measured on demo/voice.p3 is 72.
+    // segment_count <= 0 uses one segment per CPU core.
+    PackedByteArray decode_p3_parallel(const PackedByteArray& p3_data, int segment_count);
+
+    // Decode only [start_sec, end_sec) (end_sec < 0 means to the end). A cached
+    // index can be passed in; otherwise one is built with a header-only scan.
+    // A passed index is only checked against the data size, so verify it with
+    // P3Index::matches when it is attached, not per call.
+    PackedByteArray decode_range(const PackedByteArray& p3_data, double start_sec, double end_sec, const Ref<P3Index>& index);
+
+    // Lip-sync envelope: with a window > 0, decode_p3 and decode_p3_file also
+    // analyze every packet right after decoding it. Each window gives
+    // ENVELOPE_STRIDE floats (rms, peak, then 4 band levels, all 0..1).
+    // decode_p3_parallel and decode_range do not produce an envelope.
+    void set_envelope_window_ms(int window_ms);
+    int get_envelope_window_ms() const { return envelope_window_ms; }
+    PackedFloat32Array get_envelope() const;  // Envelope of the last decode_p3/decode_p3_file call
+
+    // decode_p3 with an envelope: {"pcm": PackedByteArray, "envelope": PackedFloat32Array}
+    Dictionary decode_p3_with_envelope(const PackedByteArray& p3_data, int window_ms = 20);
     
     // Get audio parameters
-    int get_sample_rate() const { return SAMPLE_RATE; }
-    int get_channels() const { return CHANNELS; }
+    int get_sample_rate() const { return sample_rate; }
+    int get_channels() const { return channels; }
 };
 
 #endif // P3_DECODER_H 
\ No newline at end of file
@@ -0,0 +1,347 @@
+#include "p3_import_plugin.h"
+#include "audio_kernels.h"
+#include "audio_stream_p3.h"
+#include "codec_log.h"
+#include "codec_metrics.h"
+#include "opus_codec_pool.h"
+#include "p3_codec.h"
+#include "polyphase_resampler.h"
+#include <godot_cpp/classes/audio_server.hpp>
+#include <godot_cpp/classes/audio_stream_ogg_vorbis.hpp>
+#include <godot_cpp/classes/audio_stream_playback.hpp>
+#include <godot_cpp/classes/audio_stream_wav.hpp>
+#include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/classes/resource_saver.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
+#include <opus.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+Dictionary import_option(const String& name, const Variant& default_value, PropertyHint hint = PROPERTY_HINT_NONE, const String& hint_string = "") {
+    Dictionary option;
+    option["name"] = name;
+    option["default_value"] = default_value;
+    option["property_hint"] = hint;
+    option["hint_string"] = hint_string;
+    return option;
+}
+
+} // namespace
+
+// ========== P3ImportPlugin ==========
+
+void P3ImportPlugin::_bind_methods() {
+}
+
+P3ImportPlugin::P3ImportPlugin() {
+    encode_job = nullptr;
+}
+
+P3ImportPlugin::~P3ImportPlugin() {
+}
+
+String P3ImportPlugin::_get_importer_name() const {
+    return "p3opus.audio_stream_p3";
+}
+
+String P3ImportPlugin::_get_visible_name() const {
+    return "AudioStreamP3 (Opus)";
+}
+
+PackedStringArray P3ImportPlugin::_get_recognized_extensions() const {
+    PackedStringArray extensions;
+    extensions.push_back("wav");
+    extensions.push_back("ogg");
+    return extensions;
+}
+
+String P3ImportPlugin::_get_save_extension() const {
+    return "res";
+}
+
+String P3ImportPlugin::_get_resource_type() const {
+    return "AudioStreamP3";
+}
+
+float P3ImportPlugin::_get_priority() const {
+    // Below the built-in importers: files are switched to P3 per file with "Import As"
+    return 0.5f;
+}
+
+int32_t P3ImportPlugin::_get_preset_count() const {
+    return 1;
+}
+
+String P3ImportPlugin::_get_preset_name(int32_t p_preset_index) const {
+    return "Default";
+}
+
+TypedArray<Dictionary> P3ImportPlugin::_get_import_options(const String& p_path, int32_t p_preset_index) const {
+    TypedArray<Dictionary> options;
+    options.push_back(import_option("loop", false));
+    options.push_back(import_option("opus/bitrate", 24000, PROPERTY_HINT_RANGE, "6000,128000,1000,suffix:bps"));
+    options.push_back(import_option("opus/complexity", 10, PROPERTY_HINT_RANGE, "0,10,1"));
+    options.push_back(import_option("opus/frame_ms", opus_config::DEFAULT_FRAME_MS, PROPERTY_HINT_ENUM, "20 ms:20,40 ms:40,60 ms:60"));
+    options.push_back(import_option("encode/parallel", true));
+    return options;
+}
+
+bool P3ImportPlugin::_get_option_visibility(const String& p_path, const StringName& p_option_name, const Dictionary& p_options) const {
+    return true;
+}
+
+bool P3ImportPlugin::_can_import_threaded() const {
+    // Each import already spreads its encode over every core
+    return false;
+}
+
+Error P3ImportPlugin::_import(const String& p_source_file, const String& p_save_path, const Dictionary& p_options,
+                              const TypedArray<String>& p_platform_variants, const TypedArray<String>& p_gen_files) const {
+    int bitrate = p_options.get("opus/bitrate", 24000);
+    int complexity = p_options.get("opus/complexity", 10);
+    int frame_ms = p_options.get("opus/frame_ms", opus_config::DEFAULT_FRAME_MS);
+    bool loop = p_options.get("loop", false);
+    bool parallel = p_options.get("encode/parallel", true);
+
+    if (!opus_config::is_valid_frame_ms(frame_ms)) {
+        CODEC_LOG_ERROR("P3ImportPlugin: Unsupported frame size ", frame_ms, " ms in ", p_source_file);
+        return ERR_INVALID_PARAMETER;
+    }
+
+    std::vector<int16_t> pcm;
+    if (!render_source(p_source_file, pcm)) {
+        return ERR_FILE_CORRUPT;
+    }
+
+    int segment_count = parallel ? OS::get_singleton()->get_processor_count() : 1;
+    PackedByteArray p3_data;
+    if (!encode_p3(pcm, frame_ms, bitrate, complexity, segment_count, p3_data)) {
+        CODEC_LOG_ERROR("P3ImportPlugin: Failed to encode ", p_source_file);
+        return ERR_CANT_CREATE;
+    }
+
+    // set_data builds the packet index; it is saved with the resource
+    Ref<AudioStreamP3> stream;
+    stream.instantiate();
+    stream->set_data(p3_data);
+    stream->set_loop(loop);
+
+    CODEC_LOG_INFO("P3ImportPlugin: ", p_source_file, " -> ", p3_data.size(), " bytes, ", stream->get_packet_count(), " packets, ", stream->get_length(), " seconds");
+    return ResourceSaver::get_singleton()->save(stream, p_save_path + String(".") + _get_save_extension());
+}
+
+bool P3ImportPlugin::render_source(const String& source_file, std::vector<int16_t>& pcm) const {
+    Ref<AudioStream> source;
+    String extension = source_file.get_extension().to_lower();
+    if (extension == "wav") {
+        Ref<AudioStreamWAV> wav = AudioStreamWAV::load_from_file(source_file, Dictionary());
+        if (wav.is_valid()) {
+            wav->set_loop_mode(AudioStreamWAV::LOOP_DISABLED);
+            source = wav;
+        }
+    } else if (extension == "ogg") {
+        Ref<AudioStreamOggVorbis> ogg = AudioStreamOggVorbis::load_from_file(source_file);
+        if (ogg.is_valid()) {
+            ogg->set_loop(false);
+            source = ogg;
+        }
+    }
+    if (source.is_null()) {
+        CODEC_LOG_ERROR("P3ImportPlugin: Failed to load ", source_file);
+        return false;
+    }
+
+    // The playback renders stereo float at the mix rate whatever the source format
+    int mix_rate = (int)AudioServer::get_singleton()->get_mix_rate();
+    int64_t source_frames = (int64_t)ceil(source->get_length() * mix_rate);
+    Ref<AudioStreamPlayback> playback = source->instantiate_playback();
+    if (source_frames <= 0 || playback.is_null()) {
+        CODEC_LOG_ERROR("P3ImportPlugin: ", source_file, " has no audio");
+        return false;
+    }
+
+    PolyphaseResampler resampler;
+    if (!resampler.configure(mix_rate, SAMPLE_RATE, 32767.0f)) {
+        CODEC_LOG_ERROR("P3ImportPlugin: Cannot resample from ", mix_rate, " Hz");
+        return false;
+    }
+
+    // Drop the filter delay at the start and flush it out with silence at the end
+    int64_t delay_samples = (int64_t)llround(resampler.get_delay_samples());
+    int64_t target_samples = source_frames * SAMPLE_RATE / mix_rate;
+
+    std::vector<float> mono(RENDER_BLOCK_FRAMES);
+    std::vector<float> resampled(resampler.get_max_output(RENDER_BLOCK_FRAMES));
+    pcm.clear();
+    pcm.reserve(target_samples + delay_samples + resampled.size());
+
+    auto resample_block = [&](int frames) {
+        int produced = resampler.process(mono.data(), frames, resampled.data());
+        size_t offset = pcm.size();
+        pcm.resize(offset + produced);
+        audio_kernels::saturate_to_int16(resampled.data(), pcm.data() + offset, produced);
+    };
+
+    playback->start(0.0);
+    int64_t rendered = 0;
+    while (rendered < source_frames) {
+        int block = (int)(source_frames - rendered < RENDER_BLOCK_FRAMES ? source_frames - rendered : RENDER_BLOCK_FRAMES);
+        PackedVector2Array frames = playback->mix_audio(1.0f, block);
+        int mixed = frames.size() < block ? (int)frames.size() : block;
+        if (mixed == 0) {
+            break;
+        }
+
+#ifdef REAL_T_IS_DOUBLE
+        const Vector2* src = frames.ptr();
+        for (int i = 0; i < mixed; i++) {
+            mono[i] = (float)((src[i].x + src[i].y) * 0.5);
+        }
+#else
+        // Vector2 is two floats, so the array is already interleaved stereo
+        audio_kernels::downmix_stereo_to_mono(reinterpret_cast<const float*>(frames.ptr()), mono.data(), mixed);
+#endif
+        resample_block(mixed);
+        rendered += mixed;
+    }
+    playback->stop();
+
+    std::fill(mono.begin(), mono.end(), 0.0f);
+    while ((int64_t)pcm.size() < target_samples + delay_samples) {
+        resample_block(RENDER_BLOCK_FRAMES);
+    }
+
+    pcm.erase(pcm.begin(), pcm.begin() + delay_samples);
+    pcm.resize(target_samples);
+    return true;
+}
+
+bool P3ImportPlugin::encode_p3(const std::vector<int16_t>& pcm, int frame_ms, int bitrate, int complexity, int segment_count, PackedByteArray& p3_data) const {
+    int frame_size = opus_config::frame_samples(SAMPLE_RATE, frame_ms);
+    int64_t frame_count = p3::encoded_frame_count(pcm.size(), frame_size, CHANNELS);
+    if (segment_count > frame_count / MIN_SEGMENT_FRAMES) {
+        segment_count = (int)(frame_count / MIN_SEGMENT_FRAMES);
+    }
+    if (segment_count < 1) {
+        segment_count = 1;
+    }
+
+    // Frame boundaries of each segment
+    std::vector<int64_t> segment_first(segment_count + 1);
+    for (int i = 0; i <= segment_count; i++) {
+        segment_first[i] = frame_count * i / segment_count;
+    }
+    std::vector<std::vector<uint8_t>> segment_out(segment_count);
+
+    uint64_t started_usec = CodecMetrics::now_usec();
+
+    EncodeJob job;
+    job.pcm = pcm.data();
+    job.sample_count = pcm.size();
+    job.frame_size = frame_size;
+    job.bitrate = bitrate;
+    job.complexity = complexity;
+    job.segment_first = segment_first.data();
+    job.segment_out = segment_out.data();
+    job.failed = false;
+    job.error = OPUS_OK;
+    encode_job = &job;
+
+    if (segment_count == 1) {
+        encode_segment(0);
+    } else {
+        WorkerThreadPool* pool = WorkerThreadPool::get_singleton();
+        int64_t group_id = pool->add_group_task(callable_mp(this, &P3ImportPlugin::encode_segment), segment_count, segment_count, false, "P3ImportPlugin encode");
+        pool->wait_for_group_task_completion(group_id);
+    }
+    encode_job = nullptr;
+
+    if (job.failed) {
+        CODEC_LOG_ERROR("P3ImportPlugin: Encoding failed: ", opus_strerror(job.error));
+        CodecMetrics::record_error();
+        return false;
+    }
+
+    // Segments are complete P3 streams; the file is their concatenation
+    int64_t total_bytes = 0;
+    for (const std::vector<uint8_t>& out : segment_out) {
+        total_bytes += out.size();
+    }
+    p3_data.resize(total_bytes);
+    uint8_t* dst = p3_data.ptrw();
+    for (const std::vector<uint8_t>& out : segment_out) {
+        memcpy(dst, out.data(), out.size());
+        dst += out.size();
+    }
+
+    CodecMetrics::record_encode(frame_count, pcm.size() * sizeof(int16_t), total_bytes, CodecMetrics::now_usec() - started_usec,
+                                frame_count * frame_size * 1000000 / SAMPLE_RATE);
+    CODEC_LOG_VERBOSE("P3ImportPlugin: Encoded ", frame_count, " frames in ", segment_count, " segments");
+    return true;
+}
+
+void P3ImportPlugin::encode_segment(uint32_t segment) const {
+    EncodeJob& job = *encode_job;
+    int64_t first_frame = job.segment_first[segment];
+    int64_t end_frame = job.segment_first[segment + 1];
+    int samples_per_frame = job.frame_size * CHANNELS;
+
+    ::OpusEncoder* encoder = OpusCodecPool::acquire_encoder(SAMPLE_RATE, CHANNELS, OPUS_APPLICATION_VOIP);
+    if (encoder == nullptr) {
+        job.error = OPUS_ALLOC_FAIL;
+        job.failed = true;
+        return;
+    }
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(job.bitrate));
+    opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(job.complexity));
+
+    // Pre-roll: the packets are dropped, only the encoder state carries over
+    // so the segment joins the previous one without a cold-start transient
+    unsigned char preroll_packet[MAX_PACKET_SIZE];
+    int64_t preroll_from = first_frame > SEGMENT_PREROLL_FRAMES ? first_frame - SEGMENT_PREROLL_FRAMES : 0;
+    for (int64_t frame = preroll_from; frame < first_frame; frame++) {
+        opus_encode(encoder, job.pcm + frame * samples_per_frame, job.frame_size, preroll_packet, MAX_PACKET_SIZE);
+    }
+
+    int64_t sample_begin = first_frame * samples_per_frame;
+    int64_t sample_end = end_frame * samples_per_frame;
+    if (sample_end > job.sample_count) {
+        sample_end = job.sample_count;
+    }
+
+    std::vector<uint8_t>& out = job.segment_out[segment];
+    std::vector<int16_t> padded_frame(samples_per_frame);
+    out.resize((end_frame - first_frame) * (p3::HEADER_SIZE + MAX_PACKET_SIZE));
+    int64_t written = p3::encode_frames<CHANNELS>(encoder, job.pcm + sample_begin, sample_end - sample_begin, job.frame_size,
+                                                  MAX_PACKET_SIZE, p3::HEADER_SIZE, out.data(), nullptr, padded_frame.data());
+    if (written < 0) {
+        job.error = (int)written;
+        job.failed = true;
+        out.clear();
+    } else {
+        out.resize(written);
+    }
+
+    OpusCodecPool::release_encoder(encoder, CHANNELS);
+}
+
+// ========== P3EditorPlugin ==========
+
+void P3EditorPlugin::_bind_methods() {
+}
+
+void P3EditorPlugin::_enter_tree() {
+    import_plugin.instantiate();
+    add_import_plugin(import_plugin);
+}
+
+void P3EditorPlugin::_exit_tree() {
+    remove_import_plugin(import_plugin);
+    import_plugin.unref();
+}
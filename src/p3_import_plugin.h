@@ -0,0 +1,95 @@
+#ifndef P3_IMPORT_PLUGIN_H
+#define P3_IMPORT_PLUGIN_H
+
+#include <godot_cpp/classes/editor_import_plugin.hpp>
+#include <godot_cpp/classes/editor_plugin.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+#include "opus_config.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+using namespace godot;
+
+// Imports WAV/OGG files as AudioStreamP3: the source is rendered, downmixed
+// and resampled to the codec rate, then Opus-encoded once at import time so
+// the game only ever decodes. Long files are split into segments encoded in
+// parallel on WorkerThreadPool, each with its own pooled encoder.
+class P3ImportPlugin : public EditorImportPlugin {
+    GDCLASS(P3ImportPlugin, EditorImportPlugin)
+
+private:
+    // Encode rate chosen by the importer; AudioStreamP3 decodes at its own output_rate
+    static constexpr int SAMPLE_RATE = opus_config::DEFAULT_SAMPLE_RATE;
+    static constexpr int CHANNELS = opus_config::DEFAULT_CHANNELS;
+    static constexpr int MAX_PACKET_SIZE = 4000;
+    static constexpr int RENDER_BLOCK_FRAMES = 4096;    // Source frames mixed per mix_audio call
+    static constexpr int MIN_SEGMENT_FRAMES = 32;       // Smallest segment worth a separate encoder (~2s at 60ms)
+    static constexpr int SEGMENT_PREROLL_FRAMES = 2;    // Frames encoded and dropped before each parallel segment
+
+    // Shared state of one parallel encode, read by the worker tasks
+    struct EncodeJob {
+        const int16_t* pcm;
+        int64_t sample_count;
+        int frame_size;
+        int bitrate;
+        int complexity;
+        const int64_t* segment_first;               // First frame of each segment, plus one past the end
+        std::vector<uint8_t>* segment_out;          // P3 bytes produced by each segment
+        std::atomic<bool> failed;
+        std::atomic<int> error;
+    };
+    // Imports run one at a time (_can_import_threaded is false), so a single
+    // job pointer is enough; _import is const in the importer interface
+    mutable EncodeJob* encode_job;
+
+    // WorkerThreadPool group task body: encode one segment with its own encoder
+    void encode_segment(uint32_t segment) const;
+
+    // Decode the source file and convert it to 16kHz mono int16
+    bool render_source(const String& source_file, std::vector<int16_t>& pcm) const;
+
+    // Encode pcm into P3 bytes; segment_count <= 1 encodes on the calling thread
+    bool encode_p3(const std::vector<int16_t>& pcm, int frame_ms, int bitrate, int complexity, int segment_count, PackedByteArray& p3_data) const;
+
+protected:
+    static void _bind_methods();
+
+public:
+    P3ImportPlugin();
+    ~P3ImportPlugin();
+
+    String _get_importer_name() const override;
+    String _get_visible_name() const override;
+    PackedStringArray _get_recognized_extensions() const override;
+    String _get_save_extension() const override;
+    String _get_resource_type() const override;
+    float _get_priority() const override;
+    int32_t _get_preset_count() const override;
+    String _get_preset_name(int32_t p_preset_index) const override;
+    TypedArray<Dictionary> _get_import_options(const String& p_path, int32_t p_preset_index) const override;
+    bool _get_option_visibility(const String& p_path, const StringName& p_option_name, const Dictionary& p_options) const override;
+    bool _can_import_threaded() const override;
+    Error _import(const String& p_source_file, const String& p_save_path, const Dictionary& p_options,
+                  const TypedArray<String>& p_platform_variants, const TypedArray<String>& p_gen_files) const override;
+};
+
+// Editor plugin that registers P3ImportPlugin while the editor is running
+class P3EditorPlugin : public EditorPlugin {
+    GDCLASS(P3EditorPlugin, EditorPlugin)
+
+private:
+    Ref<P3ImportPlugin> import_plugin;
+
+protected:
+    static void _bind_methods();
+
+public:
+    void _enter_tree() override;
+    void _exit_tree() override;
+};
+
+#endif // P3_IMPORT_PLUGIN_H
@@ -0,0 +1,226 @@
+#include "p3_index.h"
+#include "codec_log.h"
+#include "p3_codec.h"
+#include <godot_cpp/core/class_db.hpp>
+#include <opus.h>
+
+using namespace godot;
+
+namespace {
+
+void write_le(uint8_t* dst, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        dst[i] = (uint8_t)((value >> (i * 8)) & 0xFF);
+    }
+}
+
+uint64_t read_le(const uint8_t* src, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t)src[i] << (i * 8);
+    }
+    return value;
+}
+
+// magic, version, packet count, reserved, source size, source hash, total samples
+constexpr int SERIAL_HEADER_SIZE = 4 + 4 + 4 + 4 + 8 + 8 + 8;
+constexpr int SERIAL_ENTRY_SIZE = 8 + 8;
+
+} // namespace
+
+void P3Index::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("build", "p3_data"), &P3Index::build);
+    ClassDB::bind_method(D_METHOD("clear"), &P3Index::clear);
+    ClassDB::bind_method(D_METHOD("serialize"), &P3Index::serialize);
+    ClassDB::bind_method(D_METHOD("deserialize", "index_data"), &P3Index::deserialize);
+    ClassDB::bind_method(D_METHOD("matches", "p3_data"), &P3Index::matches);
+
+    ClassDB::bind_method(D_METHOD("get_packet_count"), &P3Index::get_packet_count);
+    ClassDB::bind_method(D_METHOD("get_duration"), &P3Index::get_duration);
+    ClassDB::bind_method(D_METHOD("get_packet_offset", "packet"), &P3Index::get_packet_offset);
+    ClassDB::bind_method(D_METHOD("get_packet_time", "packet"), &P3Index::get_packet_time);
+    ClassDB::bind_method(D_METHOD("find_packet_at_time", "time_sec"), &P3Index::find_packet_at_time);
+}
+
+P3Index::P3Index() {
+    total_samples = 0;
+    source_size = 0;
+    source_hash = p3::FNV_OFFSET_BASIS;
+}
+
+P3Index::~P3Index() {
+}
+
+void P3Index::clear() {
+    packet_offsets.clear();
+    packet_starts.clear();
+    total_samples = 0;
+    source_size = 0;
+    source_hash = p3::FNV_OFFSET_BASIS;
+}
+
+bool P3Index::build(const PackedByteArray& p3_data) {
+    clear();
+
+    const uint8_t* data_ptr = p3_data.ptr();
+    int64_t data_size = p3_data.size();
+
+    // Header-only pass: size the tables once, then fill them
+    p3::ScanInfo scan;
+    if (!p3::scan_packets(data_ptr, data_size, INDEX_RATE, scan)) {
+        CODEC_LOG_ERROR("P3Index: Malformed P3 packet at byte ", scan.error_pos);
+        return false;
+    }
+
+    packet_offsets.resize(scan.packet_count);
+    packet_starts.resize(scan.packet_count);
+    int64_t* offsets = packet_offsets.ptrw();
+    int64_t* starts = packet_starts.ptrw();
+
+    int64_t pos = 0;
+    int64_t position = 0;
+    for (int i = 0; i < scan.packet_count; i++) {
+        const uint8_t* packet = nullptr;
+        int data_len = 0;
+        offsets[i] = pos;
+        starts[i] = position;
+        p3::read_packet(data_ptr, data_size, pos, packet, data_len);
+        position += opus_packet_get_nb_samples(packet, data_len, INDEX_RATE);
+    }
+
+    total_samples = position;
+    source_size = data_size;
+    source_hash = p3::fnv1a(data_ptr, data_size);
+    return true;
+}
+
+PackedByteArray P3Index::serialize() const {
+    PackedByteArray index_data;
+    int count = packet_offsets.size();
+    index_data.resize(SERIAL_HEADER_SIZE + (int64_t)count * SERIAL_ENTRY_SIZE);
+
+    uint8_t* dst = index_data.ptrw();
+    write_le(dst, SERIAL_MAGIC, 4);
+    write_le(dst + 4, SERIAL_VERSION, 4);
+    write_le(dst + 8, (uint64_t)count, 4);
+    write_le(dst + 12, 0, 4);
+    write_le(dst + 16, (uint64_t)source_size, 8);
+    write_le(dst + 24, source_hash, 8);
+    write_le(dst + 32, (uint64_t)total_samples, 8);
+
+    dst += SERIAL_HEADER_SIZE;
+    const int64_t* offsets = packet_offsets.ptr();
+    const int64_t* starts = packet_starts.ptr();
+    for (int i = 0; i < count; i++) {
+        write_le(dst, (uint64_t)offsets[i], 8);
+        write_le(dst + 8, (uint64_t)starts[i], 8);
+        dst += SERIAL_ENTRY_SIZE;
+    }
+
+    return index_data;
+}
+
+bool P3Index::deserialize(const PackedByteArray& index_data) {
+    clear();
+
+    const uint8_t* src = index_data.ptr();
+    int64_t size = index_data.size();
+    if (size < SERIAL_HEADER_SIZE || read_le(src, 4) != SERIAL_MAGIC) {
+        CODEC_LOG_ERROR("P3Index: Not a serialized P3 index");
+        return false;
+    }
+
+    if (read_le(src + 4, 4) != SERIAL_VERSION) {
+        CODEC_LOG_ERROR("P3Index: Unsupported index version ", (int64_t)read_le(src + 4, 4));
+        return false;
+    }
+
+    int64_t count = (int64_t)read_le(src + 8, 4);
+    if (size != SERIAL_HEADER_SIZE + count * SERIAL_ENTRY_SIZE) {
+        CODEC_LOG_ERROR("P3Index: Truncated index data");
+        return false;
+    }
+
+    packet_offsets.resize(count);
+    packet_starts.resize(count);
+    int64_t* offsets = packet_offsets.ptrw();
+    int64_t* starts = packet_starts.ptrw();
+
+    const uint8_t* entry = src + SERIAL_HEADER_SIZE;
+    for (int i = 0; i < count; i++) {
+        offsets[i] = (int64_t)read_le(entry, 8);
+        starts[i] = (int64_t)read_le(entry + 8, 8);
+        entry += SERIAL_ENTRY_SIZE;
+    }
+
+    source_size = (int64_t)read_le(src + 16, 8);
+    source_hash = read_le(src + 24, 8);
+    total_samples = (int64_t)read_le(src + 32, 8);
+
+    // The table drives seeking and output sizing, so a stale or crafted one
+    // must not get past this point
+    if (!p3::is_valid_packet_table(offsets, starts, (int)count, total_samples, source_size)) {
+        CODEC_LOG_ERROR("P3Index: Inconsistent index data");
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool P3Index::matches(const PackedByteArray& p3_data) const {
+    if (!matches_size(p3_data)) {
+        return false;
+    }
+    return p3::fnv1a(p3_data.ptr(), p3_data.size()) == source_hash;
+}
+
+int64_t P3Index::get_packet_offset(int packet) const {
+    if (packet < 0 || packet >= packet_offsets.size()) {
+        return -1;
+    }
+    return packet_offsets[packet];
+}
+
+double P3Index::get_packet_time(int packet) const {
+    if (packet < 0 || packet >= packet_starts.size()) {
+        return -1.0;
+    }
+    return (double)packet_starts[packet] / INDEX_RATE;
+}
+
+int P3Index::find_packet_at_time(double time_sec) const {
+    return find_packet(time_sec > 0.0 ? (int64_t)(time_sec * INDEX_RATE) : 0, INDEX_RATE);
+}
+
+int P3Index::find_packet(int64_t sample, int sample_rate) const {
+    int count = packet_starts.size();
+    if (count == 0) {
+        return -1;
+    }
+
+    // Last packet whose start is <= sample
+    int64_t position = sample * (INDEX_RATE / sample_rate);
+    const int64_t* starts = packet_starts.ptr();
+    int low = 0;
+    int high = count - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (starts[mid] <= position) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+int64_t P3Index::get_packet_start(int packet, int sample_rate) const {
+    if (packet >= packet_starts.size()) {
+        return get_total_samples(sample_rate);
+    }
+    return packet_starts[packet] / (INDEX_RATE / sample_rate);
+}
+
+int64_t P3Index::get_total_samples(int sample_rate) const {
+    return total_samples / (INDEX_RATE / sample_rate);
+}
@@ -0,0 +1,79 @@
+#ifndef P3_INDEX_H
+#define P3_INDEX_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
+#include "p3_codec.h"
+
+using namespace godot;
+
+// Packet table of a P3 stream, built from a single header-only scan.
+// Sample positions are kept at Opus's 48 kHz timebase so one index serves
+// every decode rate (8/12/16/24/48 kHz all divide 48000).
+class P3Index : public RefCounted {
+    GDCLASS(P3Index, RefCounted)
+
+public:
+    static constexpr int INDEX_RATE = 48000;
+
+private:
+    static constexpr uint32_t SERIAL_MAGIC = 0x58493350;  // "P3IX" little endian
+    static constexpr uint32_t SERIAL_VERSION = 2;
+
+    PackedInt64Array packet_offsets;    // Byte offset of each packet header
+    PackedInt64Array packet_starts;     // First sample of each packet (48 kHz)
+    int64_t total_samples;              // Stream length (48 kHz)
+    int64_t source_size;                // Size of the P3 data the index was built from
+    uint64_t source_hash;               // FNV-1a of that data
+
+protected:
+    static void _bind_methods();
+
+public:
+    P3Index();
+    ~P3Index();
+
+    // Scan the packet layout of p3_data; returns false on malformed data
+    bool build(const PackedByteArray& p3_data);
+    void clear();
+
+    // Cacheable binary form, so the scan can be skipped for known assets.
+    // deserialize rejects tables that could not come from a scan (offsets
+    // outside the data, impossible packet durations).
+    PackedByteArray serialize() const;
+    bool deserialize(const PackedByteArray& index_data);
+
+    // True if the index was built from exactly this data (size and content hash).
+    // Hashes the whole buffer, so check once when an index is attached.
+    bool matches(const PackedByteArray& p3_data) const;
+
+    // Constant-time check for per-call paths such as decode_range: the sizes
+    // agree and the table is usable. Packet reads stay bounds-checked, so a
+    // stale index of a same-sized buffer fails a packet read instead of
+    // reading out of bounds.
+    bool matches_size(const PackedByteArray& p3_data) const {
+        return source_size == p3_data.size() && (source_size == 0 || packet_offsets.size() > 0);
+    }
+
+    int get_packet_count() const { return packet_offsets.size(); }
+    double get_duration() const { return (double)total_samples / INDEX_RATE; }
+    int64_t get_packet_offset(int packet) const;
+    double get_packet_time(int packet) const;
+
+    // Index of the packet playing at time_sec (clamped to the valid range)
+    int find_packet_at_time(double time_sec) const;
+
+    // C++ helpers working in samples at a given decode rate
+    int find_packet(int64_t sample, int sample_rate) const;
+    int64_t get_packet_start(int packet, int sample_rate) const;
+    int64_t get_total_samples(int sample_rate) const;
+    int64_t get_source_size() const { return source_size; }
+
+    // Raw view of the table for the core decode loops; valid until the index changes
+    p3::PacketTable get_table() const {
+        return p3::PacketTable{packet_offsets.ptr(), packet_starts.ptr(), (int)packet_offsets.size(), total_samples};
+    }
+};
+
+#endif // P3_INDEX_H
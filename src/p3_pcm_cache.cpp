@@ -0,0 +1,357 @@
+#include "p3_pcm_cache.h"
+#include "codec_log.h"
+#include "output_rate.h"
+#include "p3_codec.h"
+#include "p3_decoder.h"
+#include "slru_cache.h"
+#include <godot_cpp/classes/dir_access.hpp>
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <mutex>
+#include <string>
+
+using namespace godot;
+
+namespace {
+
+constexpr uint32_t DISK_MAGIC = 0x43503350;     // "P3PC" little endian
+constexpr uint32_t DISK_VERSION = 1;
+constexpr int64_t DISK_HEADER_SIZE = 4 + 4 + 4 + 4 + 8 + 8;
+constexpr const char* DEFAULT_DISK_DIR = "user://p3_pcm_cache";
+constexpr int SUPPORTED_RATES[] = {8000, 12000, 16000, 24000, 48000};
+
+std::mutex cache_mutex;
+SlruCache<uint64_t, PackedByteArray> cache(P3PcmCache::DEFAULT_BUDGET_BYTES);
+bool disk_enabled = false;
+std::string disk_dir = DEFAULT_DISK_DIR;    // UTF-8; a Godot String cannot be a global, it would be built before the module loads
+int64_t hits = 0;
+int64_t misses = 0;
+int64_t disk_hits = 0;
+int64_t disk_writes = 0;
+
+// One key per source and output format; path keys and content keys are
+// hashed from different seeds so a path can never alias a content hash
+uint64_t format_key(uint64_t source_hash, int sample_rate, int channels) {
+    int32_t format[2] = {sample_rate, channels};
+    return p3::fnv1a(format, sizeof(format), source_hash);
+}
+
+uint64_t content_hash(const PackedByteArray& p3_data) {
+    return p3::fnv1a(p3_data.ptr(), p3_data.size());
+}
+
+uint64_t path_hash(const String& path) {
+    CharString utf8 = path.utf8();
+    return p3::fnv1a(utf8.get_data(), utf8.length(), p3::fnv1a("path:", 5));
+}
+
+bool resolve_format(int& sample_rate, int channels) {
+    sample_rate = resolve_output_rate(sample_rate);
+    if (!opus_config::is_valid_sample_rate(sample_rate) || !opus_config::is_valid_channels(channels)) {
+        CODEC_LOG_ERROR("P3PcmCache: Unsupported format ", sample_rate, "Hz, ", channels, " channels");
+        return false;
+    }
+    return true;
+}
+
+bool lookup(uint64_t key, PackedByteArray& pcm) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    PackedByteArray* cached = cache.get(key);
+    if (cached == nullptr) {
+        misses++;
+        return false;
+    }
+    hits++;
+    pcm = *cached;
+    return true;
+}
+
+void store(uint64_t key, const PackedByteArray& pcm) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.put(key, pcm, pcm.size());
+}
+
+// Directory of the disk tier, or an empty string while it is disabled
+String active_disk_dir() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (!disk_enabled) {
+        return String();
+    }
+    return String::utf8(disk_dir.c_str());
+}
+
+String disk_file(const String& dir, uint64_t key) {
+    return dir.path_join(String::num_uint64(key, 16).pad_zeros(16) + ".pcm");
+}
+
+// Disk entries carry their format and a stamp of the source (content size, or
+// the modification time of a file), so a stale or foreign file is ignored
+bool load_from_disk(uint64_t key, int sample_rate, int channels, uint64_t source_stamp, PackedByteArray& pcm) {
+    String dir = active_disk_dir();
+    if (dir.is_empty()) {
+        return false;
+    }
+
+    Ref<FileAccess> file = FileAccess::open(disk_file(dir, key), FileAccess::READ);
+    if (file.is_null() || file->get_length() < (uint64_t)DISK_HEADER_SIZE) {
+        return false;
+    }
+    if (file->get_32() != DISK_MAGIC || file->get_32() != DISK_VERSION ||
+        (int)file->get_32() != sample_rate || (int)file->get_32() != channels ||
+        file->get_64() != source_stamp) {
+        return false;
+    }
+    uint64_t pcm_bytes = file->get_64();
+    if (pcm_bytes == 0 || file->get_length() != DISK_HEADER_SIZE + pcm_bytes) {
+        return false;
+    }
+
+    pcm = file->get_buffer(pcm_bytes);
+    if ((uint64_t)pcm.size() != pcm_bytes) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    disk_hits++;
+    return true;
+}
+
+void save_to_disk(uint64_t key, int sample_rate, int channels, uint64_t source_stamp, const PackedByteArray& pcm) {
+    String dir = active_disk_dir();
+    if (dir.is_empty()) {
+        return;
+    }
+    if (DirAccess::make_dir_recursive_absolute(dir) != OK) {
+        CODEC_LOG_ERROR("P3PcmCache: Failed to create ", dir);
+        return;
+    }
+
+    // Write under a per-thread name and rename, so a reader never sees a
+    // half-written entry when two threads decode the same line
+    String final_path = disk_file(dir, key);
+    String temp_path = final_path + "." + String::num_uint64(OS::get_singleton()->get_thread_caller_id()) + ".tmp";
+    Ref<FileAccess> file = FileAccess::open(temp_path, FileAccess::WRITE);
+    if (file.is_null()) {
+        CODEC_LOG_ERROR("P3PcmCache: Failed to write ", temp_path, " (error ", FileAccess::get_open_error(), ")");
+        return;
+    }
+    file->store_32(DISK_MAGIC);
+    file->store_32(DISK_VERSION);
+    file->store_32(sample_rate);
+    file->store_32(channels);
+    file->store_64(source_stamp);
+    file->store_64(pcm.size());
+    file->store_buffer(pcm);
+    file->close();
+
+    if (DirAccess::rename_absolute(temp_path, final_path) != OK) {
+        DirAccess::remove_absolute(temp_path);
+        return;
+    }
+    CODEC_LOG_VERBOSE("P3PcmCache: Wrote ", pcm.size(), " bytes to ", final_path);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    disk_writes++;
+}
+
+} // namespace
+
+void P3PcmCache::_bind_methods() {
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("decode", "p3_data", "sample_rate", "channels"), &P3PcmCache::decode, DEFVAL(opus_config::SAMPLE_RATE_AUTO), DEFVAL(opus_config::DEFAULT_CHANNELS));
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("decode_file", "path", "sample_rate", "channels"), &P3PcmCache::decode_file, DEFVAL(opus_config::SAMPLE_RATE_AUTO), DEFVAL(opus_config::DEFAULT_CHANNELS));
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("invalidate_file", "path"), &P3PcmCache::invalidate_file);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("clear"), &P3PcmCache::clear);
+
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("set_budget_bytes", "bytes"), &P3PcmCache::set_budget_bytes);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("get_budget_bytes"), &P3PcmCache::get_budget_bytes);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("get_used_bytes"), &P3PcmCache::get_used_bytes);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("get_entry_count"), &P3PcmCache::get_entry_count);
+
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("set_disk_cache_enabled", "enabled"), &P3PcmCache::set_disk_cache_enabled);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("is_disk_cache_enabled"), &P3PcmCache::is_disk_cache_enabled);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("set_disk_cache_dir", "dir"), &P3PcmCache::set_disk_cache_dir);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("get_disk_cache_dir"), &P3PcmCache::get_disk_cache_dir);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("clear_disk_cache"), &P3PcmCache::clear_disk_cache);
+
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("get_hits"), &P3PcmCache::get_hits);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("get_misses"), &P3PcmCache::get_misses);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("get_evictions"), &P3PcmCache::get_evictions);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("get_disk_hits"), &P3PcmCache::get_disk_hits);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("get_disk_writes"), &P3PcmCache::get_disk_writes);
+    ClassDB::bind_static_method("P3PcmCache", D_METHOD("reset_statistics"), &P3PcmCache::reset_statistics);
+}
+
+PackedByteArray P3PcmCache::decode(const PackedByteArray& p3_data, int sample_rate, int channels) {
+    PackedByteArray pcm;
+    if (p3_data.size() == 0) {
+        CODEC_LOG_ERROR("P3PcmCache: Empty P3 data");
+        return pcm;
+    }
+    if (!resolve_format(sample_rate, channels)) {
+        return pcm;
+    }
+
+    uint64_t key = format_key(content_hash(p3_data), sample_rate, channels);
+    uint64_t stamp = p3_data.size();
+    if (lookup(key, pcm)) {
+        return pcm;
+    }
+    if (!load_from_disk(key, sample_rate, channels, stamp, pcm)) {
+        Ref<P3Decoder> decoder;
+        decoder.instantiate();
+        decoder->configure(sample_rate, channels);
+        pcm = decoder->decode_p3(p3_data);
+        if (pcm.size() == 0) {
+            return pcm;
+        }
+        save_to_disk(key, sample_rate, channels, stamp, pcm);
+    }
+
+    store(key, pcm);
+    return pcm;
+}
+
+PackedByteArray P3PcmCache::decode_file(const String& path, int sample_rate, int channels) {
+    PackedByteArray pcm;
+    if (!resolve_format(sample_rate, channels)) {
+        return pcm;
+    }
+
+    uint64_t key = format_key(path_hash(path), sample_rate, channels);
+    if (lookup(key, pcm)) {
+        return pcm;
+    }
+    uint64_t stamp = FileAccess::get_modified_time(path);
+    if (!load_from_disk(key, sample_rate, channels, stamp, pcm)) {
+        Ref<P3Decoder> decoder;
+        decoder.instantiate();
+        decoder->configure(sample_rate, channels);
+        pcm = decoder->decode_p3_file(path);
+        if (pcm.size() == 0) {
+            return pcm;
+        }
+        save_to_disk(key, sample_rate, channels, stamp, pcm);
+    }
+
+    store(key, pcm);
+    return pcm;
+}
+
+void P3PcmCache::invalidate_file(const String& path) {
+    uint64_t source = path_hash(path);
+    String dir = active_disk_dir();
+
+    for (int sample_rate : SUPPORTED_RATES) {
+        for (int channels = 1; channels <= opus_config::MAX_CHANNELS; channels++) {
+            uint64_t key = format_key(source, sample_rate, channels);
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                cache.erase(key);
+            }
+            if (!dir.is_empty() && FileAccess::file_exists(disk_file(dir, key))) {
+                DirAccess::remove_absolute(disk_file(dir, key));
+            }
+        }
+    }
+}
+
+void P3PcmCache::clear() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+}
+
+void P3PcmCache::set_budget_bytes(int64_t bytes) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.set_budget(bytes);
+}
+
+int64_t P3PcmCache::get_budget_bytes() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return cache.get_budget();
+}
+
+int64_t P3PcmCache::get_used_bytes() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return cache.get_used_bytes();
+}
+
+int P3PcmCache::get_entry_count() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return cache.get_entry_count();
+}
+
+void P3PcmCache::set_disk_cache_enabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    disk_enabled = enabled;
+}
+
+bool P3PcmCache::is_disk_cache_enabled() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return disk_enabled;
+}
+
+void P3PcmCache::set_disk_cache_dir(const String& dir) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    disk_dir = dir.is_empty() ? DEFAULT_DISK_DIR : dir.utf8().get_data();
+}
+
+String P3PcmCache::get_disk_cache_dir() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return String::utf8(disk_dir.c_str());
+}
+
+void P3PcmCache::clear_disk_cache() {
+    String dir = get_disk_cache_dir();
+    if (!DirAccess::dir_exists_absolute(dir)) {
+        return;
+    }
+
+    // Only remove files this cache wrote
+    PackedStringArray files = DirAccess::get_files_at(dir);
+    for (int i = 0; i < files.size(); i++) {
+        if (files[i].ends_with(".pcm") || files[i].ends_with(".tmp")) {
+            DirAccess::remove_absolute(dir.path_join(files[i]));
+        }
+    }
+}
+
+int64_t P3PcmCache::get_hits() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return hits;
+}
+
+int64_t P3PcmCache::get_misses() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return misses;
+}
+
+int64_t P3PcmCache::get_evictions() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return cache.get_evictions();
+}
+
+int64_t P3PcmCache::get_disk_hits() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return disk_hits;
+}
+
+int64_t P3PcmCache::get_disk_writes() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return disk_writes;
+}
+
+void P3PcmCache::reset_statistics() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    hits = 0;
+    misses = 0;
+    disk_hits = 0;
+    disk_writes = 0;
+    cache.reset_evictions();
+}
+
+void P3PcmCache::shutdown() {
+    // The cached arrays must be released while Godot is still loaded
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+}
@@ -0,0 +1,71 @@
+#ifndef P3_PCM_CACHE_H
+#define P3_PCM_CACHE_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include "opus_config.h"
+#include <cstdint>
+
+using namespace godot;
+
+// Process-wide cache of decoded P3 audio for lines that are played over and
+// over. Entries are keyed by a content hash of the P3 bytes (or by file path)
+// plus the output format, and kept under a byte budget with segmented LRU
+// eviction: lines played more than once are protected from a burst of one-off
+// lines. A hit returns the cached PackedByteArray itself, which is
+// copy-on-write, so it costs neither a decode nor a copy.
+//
+// With the disk tier enabled, every decoded line is also written under
+// user:// and later misses (including after a restart) read the PCM back
+// instead of decoding it again. All methods are static and thread-safe;
+// decoding happens outside the lock.
+class P3PcmCache : public RefCounted {
+    GDCLASS(P3PcmCache, RefCounted)
+
+public:
+    static constexpr int64_t DEFAULT_BUDGET_BYTES = 16 * 1024 * 1024;  // About 8 minutes of 16kHz mono
+
+protected:
+    static void _bind_methods();
+
+public:
+    // Decoded PCM (16-bit, interleaved) of p3_data, keyed by its content
+    static PackedByteArray decode(const PackedByteArray& p3_data, int sample_rate = opus_config::SAMPLE_RATE_AUTO, int channels = opus_config::DEFAULT_CHANNELS);
+
+    // Decoded PCM of the P3 file at path, keyed by the path. Hits do not touch
+    // the file; call invalidate_file after replacing it at runtime.
+    static PackedByteArray decode_file(const String& path, int sample_rate = opus_config::SAMPLE_RATE_AUTO, int channels = opus_config::DEFAULT_CHANNELS);
+
+    // Drop the entries of path in every output format, in memory and on disk
+    static void invalidate_file(const String& path);
+
+    // Drop every entry in memory (the disk tier is kept)
+    static void clear();
+
+    // Memory budget; lowering it evicts immediately
+    static void set_budget_bytes(int64_t bytes);
+    static int64_t get_budget_bytes();
+    static int64_t get_used_bytes();
+    static int get_entry_count();
+
+    // Disk tier (default off, stored in user://p3_pcm_cache)
+    static void set_disk_cache_enabled(bool enabled);
+    static bool is_disk_cache_enabled();
+    static void set_disk_cache_dir(const String& dir);
+    static String get_disk_cache_dir();
+    static void clear_disk_cache();
+
+    // Statistics
+    static int64_t get_hits();
+    static int64_t get_misses();        // Lookups that found nothing in memory
+    static int64_t get_evictions();
+    static int64_t get_disk_hits();     // Misses served from the disk tier
+    static int64_t get_disk_writes();
+    static void reset_statistics();
+
+    // Release every cached buffer (called on module shutdown)
+    static void shutdown();
+};
+
+#endif // P3_PCM_CACHE_H
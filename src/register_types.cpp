@@ -1,29 +1,64 @@
 #include "register_types.h"
 
 #include "p3_decoder.h"
+#include "p3_index.h"
 #include "opus_session_decoder.h"
 #include "opus_encoder.h"
+#include "audio_stream_p3.h"
+#include "opus_codec_pool.h"
+#include "voice_mixer.h"
+#include "opus_capture_encoder.h"
+#include "p3_decode_service.h"
+#include "p3_pcm_cache.h"
+#include "codec_metrics.h"
+#include "p3_import_plugin.h"
 
 #include <gdextension_interface.h>
+#include <godot_cpp/classes/editor_plugin_registration.hpp>
 #include <godot_cpp/core/defs.hpp>
 #include <godot_cpp/godot.hpp>
 
 using namespace godot;
 
 void initialize_example_module(ModuleInitializationLevel p_level) {
+	if (p_level == MODULE_INITIALIZATION_LEVEL_EDITOR) {
+		GDREGISTER_CLASS(P3ImportPlugin);
+		GDREGISTER_CLASS(P3EditorPlugin);
+		EditorPlugins::add_by_type<P3EditorPlugin>();
+		return;
+	}
 	if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
 		return;
 	}
 	
 	GDREGISTER_RUNTIME_CLASS(P3Decoder);
+	GDREGISTER_CLASS(P3Index);
 	GDREGISTER_RUNTIME_CLASS(OpusSessionDecoder);
 	GDREGISTER_RUNTIME_CLASS(OpusEncoder);
+	GDREGISTER_RUNTIME_CLASS(OpusCodecPool);
+	GDREGISTER_RUNTIME_CLASS(VoiceMixer);
+	GDREGISTER_RUNTIME_CLASS(OpusCaptureEncoder);
+	GDREGISTER_RUNTIME_CLASS(P3DecodeService);
+	GDREGISTER_RUNTIME_CLASS(P3PcmCache);
+	GDREGISTER_CLASS(AudioStreamPlaybackP3);
+	GDREGISTER_CLASS(AudioStreamP3);
+	GDREGISTER_RUNTIME_CLASS(CodecMetrics);
+
+	CodecMetrics::register_monitors();
 }
 
 void uninitialize_example_module(ModuleInitializationLevel p_level) {
+	if (p_level == MODULE_INITIALIZATION_LEVEL_EDITOR) {
+		EditorPlugins::remove_by_type<P3EditorPlugin>();
+		return;
+	}
 	if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
 		return;
 	}
+
+	CodecMetrics::unregister_monitors();
+	P3PcmCache::shutdown();
+	OpusCodecPool::shutdown();
 }
 
 extern "C" {
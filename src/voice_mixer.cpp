@@ -0,0 +1,235 @@
+#include "voice_mixer.h"
+#include "audio_kernels.h"
+#include "codec_log.h"
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+
+using namespace godot;
+
+void VoiceMixer::_bind_methods() {
+    // Speaker management
+    ClassDB::bind_method(D_METHOD("add_speaker", "speaker_id", "gain"), &VoiceMixer::add_speaker, DEFVAL(1.0f));
+    ClassDB::bind_method(D_METHOD("remove_speaker", "speaker_id"), &VoiceMixer::remove_speaker);
+    ClassDB::bind_method(D_METHOD("has_speaker", "speaker_id"), &VoiceMixer::has_speaker);
+    ClassDB::bind_method(D_METHOD("get_speaker_ids"), &VoiceMixer::get_speaker_ids);
+    ClassDB::bind_method(D_METHOD("get_speaker_count"), &VoiceMixer::get_speaker_count);
+    ClassDB::bind_method(D_METHOD("set_speaker_gain", "speaker_id", "gain"), &VoiceMixer::set_speaker_gain);
+    ClassDB::bind_method(D_METHOD("get_speaker_gain", "speaker_id"), &VoiceMixer::get_speaker_gain);
+
+    // Packets and mixing
+    ClassDB::bind_method(D_METHOD("push_packet", "speaker_id", "opus_data"), &VoiceMixer::push_packet);
+    ClassDB::bind_method(D_METHOD("mix", "sample_count"), &VoiceMixer::mix);
+    ClassDB::bind_method(D_METHOD("set_parallel_threshold", "speakers"), &VoiceMixer::set_parallel_threshold);
+    ClassDB::bind_method(D_METHOD("get_parallel_threshold"), &VoiceMixer::get_parallel_threshold);
+
+    // Statistics and info
+    ClassDB::bind_method(D_METHOD("get_dropped_packets", "speaker_id"), &VoiceMixer::get_dropped_packets);
+    ClassDB::bind_method(D_METHOD("get_underruns", "speaker_id"), &VoiceMixer::get_underruns);
+    ClassDB::bind_method(D_METHOD("get_sample_rate"), &VoiceMixer::get_sample_rate);
+    ClassDB::bind_method(D_METHOD("get_channels"), &VoiceMixer::get_channels);
+}
+
+VoiceMixer::VoiceMixer() {
+    tick_samples = 0;
+    parallel_threshold = 4;
+}
+
+VoiceMixer::~VoiceMixer() {
+}
+
+VoiceMixer::Speaker* VoiceMixer::find_speaker(int speaker_id) const {
+    for (const std::unique_ptr<Speaker>& speaker : speakers) {
+        if (speaker->id == speaker_id) {
+            return speaker.get();
+        }
+    }
+    return nullptr;
+}
+
+// ========== Speaker Management ==========
+
+bool VoiceMixer::add_speaker(int speaker_id, float gain) {
+    if (find_speaker(speaker_id) != nullptr) {
+        CODEC_LOG_ERROR("VoiceMixer: Speaker ", speaker_id, " already exists");
+        return false;
+    }
+
+    std::unique_ptr<Speaker> speaker(new Speaker());
+    speaker->id = speaker_id;
+    speaker->gain = gain;
+    speaker->pcm_read = 0;
+    speaker->dropped_packets = 0;
+    speaker->underruns = 0;
+    speaker->pcm.reserve(MAX_FRAME_SIZE * CHANNELS * 2);
+
+    speaker->session.instantiate();
+    if (!speaker->session->start_session(SAMPLE_RATE, CHANNELS)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    speakers.push_back(std::move(speaker));
+    return true;
+}
+
+void VoiceMixer::remove_speaker(int speaker_id) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    for (size_t i = 0; i < speakers.size(); i++) {
+        if (speakers[i]->id == speaker_id) {
+            speakers[i]->session->end_session();
+            speakers.erase(speakers.begin() + i);
+            return;
+        }
+    }
+}
+
+bool VoiceMixer::has_speaker(int speaker_id) const {
+    return find_speaker(speaker_id) != nullptr;
+}
+
+PackedInt32Array VoiceMixer::get_speaker_ids() const {
+    PackedInt32Array ids;
+    ids.resize(speakers.size());
+    for (size_t i = 0; i < speakers.size(); i++) {
+        ids.set(i, speakers[i]->id);
+    }
+    return ids;
+}
+
+void VoiceMixer::set_speaker_gain(int speaker_id, float gain) {
+    Speaker* speaker = find_speaker(speaker_id);
+    if (speaker != nullptr) {
+        speaker->gain = gain;
+    }
+}
+
+float VoiceMixer::get_speaker_gain(int speaker_id) const {
+    Speaker* speaker = find_speaker(speaker_id);
+    return speaker != nullptr ? speaker->gain : 0.0f;
+}
+
+// ========== Packets and Mixing ==========
+
+bool VoiceMixer::push_packet(int speaker_id, const PackedByteArray& opus_data) {
+    if (opus_data.size() == 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    Speaker* speaker = find_speaker(speaker_id);
+    if (speaker == nullptr) {
+        return false;
+    }
+
+    // Bound the latency of a speaker whose packets arrive faster than they are mixed
+    if ((int)speaker->incoming.size() >= MAX_QUEUED_PACKETS) {
+        speaker->incoming.pop_front();
+        speaker->dropped_packets.fetch_add(1, std::memory_order_relaxed);
+    }
+    speaker->incoming.push_back(opus_data);
+    return true;
+}
+
+void VoiceMixer::decode_speaker(uint32_t active_index) {
+    Speaker* speaker = active_speakers[active_index];
+    std::vector<int16_t>& pcm = speaker->pcm;
+
+    // Drop samples mixed by earlier ticks; capacity is kept
+    if (speaker->pcm_read > 0) {
+        pcm.erase(pcm.begin(), pcm.begin() + speaker->pcm_read);
+        speaker->pcm_read = 0;
+    }
+
+    while ((int)pcm.size() < tick_samples * CHANNELS && !speaker->ready.empty()) {
+        PackedByteArray packet = std::move(speaker->ready.front());
+        speaker->ready.pop_front();
+
+        size_t old_size = pcm.size();
+        pcm.resize(old_size + MAX_FRAME_SIZE * CHANNELS);
+        int decoded_samples = speaker->session->decode_to(packet.ptr(), packet.size(), pcm.data() + old_size, MAX_FRAME_SIZE);
+        pcm.resize(old_size + (decoded_samples > 0 ? decoded_samples * CHANNELS : 0));
+    }
+}
+
+PackedByteArray VoiceMixer::mix(int sample_count) {
+    PackedByteArray result;
+    if (sample_count <= 0) {
+        return result;
+    }
+    tick_samples = sample_count;
+
+    // Take over the packets that arrived since the last tick. The limit covers
+    // both queues: a sender whose clock runs fast would otherwise pile up
+    // packets in ready one tick at a time and add latency without bound.
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (std::unique_ptr<Speaker>& speaker : speakers) {
+            while (!speaker->incoming.empty()) {
+                speaker->ready.push_back(std::move(speaker->incoming.front()));
+                speaker->incoming.pop_front();
+            }
+            while ((int)speaker->ready.size() > MAX_QUEUED_PACKETS) {
+                speaker->ready.pop_front();
+                speaker->dropped_packets.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    active_speakers.clear();
+    for (std::unique_ptr<Speaker>& speaker : speakers) {
+        int available = (int)speaker->pcm.size() - speaker->pcm_read;
+        if (available < sample_count * CHANNELS && !speaker->ready.empty()) {
+            active_speakers.push_back(speaker.get());
+        }
+    }
+
+    // Decode every active speaker, spread over the worker pool when worthwhile
+    int active_count = (int)active_speakers.size();
+    if (active_count >= parallel_threshold && active_count > 1) {
+        WorkerThreadPool* pool = WorkerThreadPool::get_singleton();
+        int64_t group_id = pool->add_group_task(callable_mp(this, &VoiceMixer::decode_speaker), active_count, -1, true, "VoiceMixer decode");
+        pool->wait_for_group_task_completion(group_id);
+    } else {
+        for (int i = 0; i < active_count; i++) {
+            decode_speaker(i);
+        }
+    }
+
+    // Sum all speakers with their gain in float, then saturate once
+    mix_buffer.assign(sample_count * CHANNELS, 0.0f);
+    for (std::unique_ptr<Speaker>& speaker : speakers) {
+        int available = (int)speaker->pcm.size() - speaker->pcm_read;
+        if (available <= 0) {
+            continue;
+        }
+        if (available < sample_count * CHANNELS) {
+            speaker->underruns.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            available = sample_count * CHANNELS;
+        }
+
+        audio_kernels::accumulate_int16(mix_buffer.data(), speaker->pcm.data() + speaker->pcm_read, available, speaker->gain);
+        speaker->pcm_read += available;
+    }
+
+    result.resize(sample_count * CHANNELS * sizeof(int16_t));
+    audio_kernels::saturate_to_int16(mix_buffer.data(), reinterpret_cast<int16_t*>(result.ptrw()), sample_count * CHANNELS);
+    return result;
+}
+
+void VoiceMixer::set_parallel_threshold(int speakers_needed) {
+    parallel_threshold = speakers_needed > 1 ? speakers_needed : 2;
+}
+
+// ========== Statistics and Info ==========
+
+int64_t VoiceMixer::get_dropped_packets(int speaker_id) const {
+    Speaker* speaker = find_speaker(speaker_id);
+    return speaker != nullptr ? speaker->dropped_packets.load(std::memory_order_relaxed) : 0;
+}
+
+int64_t VoiceMixer::get_underruns(int speaker_id) const {
+    Speaker* speaker = find_speaker(speaker_id);
+    return speaker != nullptr ? speaker->underruns.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,91 @@
+#ifndef VOICE_MIXER_H
+#define VOICE_MIXER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+#include "opus_session_decoder.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace godot;
+
+// Decodes and mixes many remote speakers natively. Each speaker owns an
+// OpusSessionDecoder; packets are queued per speaker id and every mix() call
+// decodes all active speakers (across WorkerThreadPool when there are enough
+// of them) and sums them with per-speaker gain into one saturated int16 buffer.
+//
+// push_packet() may be called from any thread. add/remove/mix must be called
+// from one thread (usually the audio or main thread).
+class VoiceMixer : public RefCounted {
+    GDCLASS(VoiceMixer, RefCounted)
+
+private:
+    static constexpr int SAMPLE_RATE = 16000;  // Fixed sample rate at 16000Hz
+    static constexpr int CHANNELS = 1;         // Mono channel
+    static constexpr int MAX_FRAME_SIZE = SAMPLE_RATE * 120 / 1000;  // 120ms max frame size
+    static constexpr int MAX_QUEUED_PACKETS = 32;  // Per speaker, queued and not yet decoded; oldest packets are dropped beyond this
+
+    struct Speaker {
+        int id;
+        float gain;
+        Ref<OpusSessionDecoder> session;
+        std::deque<PackedByteArray> incoming;   // Guarded by queue_mutex
+        std::deque<PackedByteArray> ready;      // Owned by the mixing thread
+        std::vector<int16_t> pcm;               // Decoded samples not mixed yet
+        int pcm_read;
+        std::atomic<int64_t> dropped_packets;   // Read by the statistics getters from any thread
+        std::atomic<int64_t> underruns;
+    };
+
+    std::vector<std::unique_ptr<Speaker>> speakers;
+    std::vector<Speaker*> active_speakers;     // Speakers that need decoding this tick
+    std::vector<float> mix_buffer;
+    std::mutex queue_mutex;
+
+    int tick_samples;
+    int parallel_threshold;
+
+    Speaker* find_speaker(int speaker_id) const;
+
+    // Decode queued packets until the speaker holds tick_samples (runs on workers)
+    void decode_speaker(uint32_t active_index);
+
+protected:
+    static void _bind_methods();
+
+public:
+    VoiceMixer();
+    ~VoiceMixer();
+
+    // Speaker management
+    bool add_speaker(int speaker_id, float gain = 1.0f);
+    void remove_speaker(int speaker_id);
+    bool has_speaker(int speaker_id) const;
+    PackedInt32Array get_speaker_ids() const;
+    int get_speaker_count() const { return (int)speakers.size(); }
+    void set_speaker_gain(int speaker_id, float gain);
+    float get_speaker_gain(int speaker_id) const;
+
+    // Queue one Opus packet for a speaker (thread-safe)
+    bool push_packet(int speaker_id, const PackedByteArray& opus_data);
+
+    // Decode and mix sample_count samples of every speaker (16-bit PCM)
+    PackedByteArray mix(int sample_count);
+
+    // Minimum number of speakers needing decode before work goes to WorkerThreadPool
+    void set_parallel_threshold(int speakers_needed);
+    int get_parallel_threshold() const { return parallel_threshold; }
+
+    // Statistics
+    int64_t get_dropped_packets(int speaker_id) const;
+    int64_t get_underruns(int speaker_id) const;
+
+    int get_sample_rate() const { return SAMPLE_RATE; }
+    int get_channels() const { return CHANNELS; }
+};
+
+#endif // VOICE_MIXER_H
@@ -0,0 +1,375 @@
+// Unit tests of the Godot-independent core library. Every case is a function
+// registered by name below; CTest runs each one as its own test:
+//
+//   p3opus_tests <case> [file.p3]
+//
+// Without a case name every case runs. Cases that need a real P3 stream use
+// demo/voice.p3 unless another file is given.
+
+#include "envelope_analyzer.h"
+#include "p3_codec.h"
+#include "p3_format.h"
+#include "p3_stream_parser.h"
+#include "polyphase_resampler.h"
+#include "slru_cache.h"
+#include <opus.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifndef P3_TEST_DEFAULT_FILE
+#define P3_TEST_DEFAULT_FILE "demo/voice.p3"
+#endif
+
+namespace {
+
+const char* p3_path = P3_TEST_DEFAULT_FILE;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            return false;                                                       \
+        }                                                                       \
+    } while (0)
+
+bool read_file(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? size : 0);
+    size_t read_bytes = data.empty() ? 0 : fread(data.data(), 1, data.size(), file);
+    fclose(file);
+    return read_bytes == data.size();
+}
+
+// Packet table of data as P3Index::build produces it (48 kHz positions)
+struct PacketTable {
+    std::vector<int64_t> offsets;
+    std::vector<int64_t> starts;
+    int64_t total_samples = 0;
+};
+
+PacketTable build_table(const std::vector<uint8_t>& data) {
+    PacketTable table;
+    int64_t pos = 0;
+    const uint8_t* packet = nullptr;
+    int packet_len = 0;
+    while (true) {
+        int64_t offset = pos;
+        if (p3::read_packet(data.data(), data.size(), pos, packet, packet_len) != p3::READ_OK) {
+            break;
+        }
+        table.offsets.push_back(offset);
+        table.starts.push_back(table.total_samples);
+        table.total_samples += opus_packet_get_nb_samples(packet, packet_len, 48000);
+    }
+    return table;
+}
+
+bool is_valid(const PacketTable& table, int64_t source_size) {
+    return p3::is_valid_packet_table(table.offsets.data(), table.starts.data(), (int)table.offsets.size(),
+                                     table.total_samples, source_size);
+}
+
+// ----- Cases -----
+
+// A table from a real scan passes; every kind of corruption a stored index
+// could carry is rejected, and read_packet never reads before the buffer
+bool test_packet_table() {
+    std::vector<uint8_t> data;
+    CHECK(read_file(p3_path, data));
+    PacketTable table = build_table(data);
+    int64_t size = (int64_t)data.size();
+    CHECK(table.offsets.size() > 2);
+    CHECK(is_valid(table, size));
+
+    PacketTable bad = table;
+    bad.offsets[1] = (int64_t)(1ULL << 63);     // Offset >= 2^63 read back as negative
+    CHECK(!is_valid(bad, size));
+    bad = table;
+    bad.offsets[0] = 4;
+    CHECK(!is_valid(bad, size));
+    bad = table;
+    bad.offsets.back() = size;                  // Past the end of the data
+    CHECK(!is_valid(bad, size));
+    bad = table;
+    std::swap(bad.offsets[1], bad.offsets[2]);
+    CHECK(!is_valid(bad, size));
+    bad = table;
+    bad.starts[2] = bad.starts[1];              // Zero-length packet
+    CHECK(!is_valid(bad, size));
+    bad = table;
+    bad.total_samples = (int64_t)1 << 40;       // Would size a huge decode_range output
+    CHECK(!is_valid(bad, size));
+    bad = table;
+    bad.total_samples = bad.starts.back();
+    CHECK(!is_valid(bad, size));
+    CHECK(!is_valid(table, size + 4096));       // Index of a longer file
+
+    int64_t pos = -8;
+    const uint8_t* packet = nullptr;
+    int packet_len = 0;
+    CHECK(p3::read_packet(data.data(), size, pos, packet, packet_len) == p3::READ_END);
+    return true;
+}
+
+// Segments of decode_p3_parallel against a serial decode: a segment at the
+// start of the stream is bit-exact, and one starting at any later packet stays
+// within PARALLEL_MAX_SAMPLE_ERROR with PARALLEL_PREROLL_PACKETS of pre-roll
+bool test_parallel_segments() {
+    constexpr int RATE = 48000;
+    constexpr int MAX_FRAME = RATE * 120 / 1000;
+    std::vector<uint8_t> data;
+    CHECK(read_file(p3_path, data));
+    PacketTable built = build_table(data);
+    p3::PacketTable table{built.offsets.data(), built.starts.data(), (int)built.offsets.size(), built.total_samples};
+    int64_t total = table.packet_start(table.packet_count, RATE);
+
+    int error = OPUS_OK;
+    OpusDecoder* decoder = opus_decoder_create(RATE, 1, &error);
+    CHECK(error == OPUS_OK);
+
+    std::vector<int16_t> serial(total);
+    p3::DecodeState state;
+    state.begin(decoder, serial.data(), total, MAX_FRAME);
+    int64_t pos = 0;
+    p3::decode_packets<1>(state, data.data(), data.size(), pos);
+    CHECK(!state.failed() && state.total_pcm_samples == total);
+
+    std::vector<int16_t> segment(total);
+    std::vector<int16_t> scratch(MAX_FRAME);
+    int max_error = 0;
+    for (int first = 0; first < table.packet_count; first++) {
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        error = p3::decode_segment<1>(decoder, data.data(), data.size(), table, RATE, first, table.packet_count,
+                                      p3::PARALLEL_PREROLL_PACKETS, MAX_FRAME, segment.data(), scratch.data());
+        CHECK(error == OPUS_OK);
+        for (int64_t i = table.packet_start(first, RATE); i < total; i++) {
+            int difference = abs(segment[i] - serial[i]);
+            CHECK(first > 0 || difference == 0);
+            max_error = difference > max_error ? difference : max_error;
+        }
+    }
+    opus_decoder_destroy(decoder);
+
+    printf("%-24s max sample error %d over %d boundaries (limit %d)\n", "parallel_segments", max_error,
+           table.packet_count - 1, p3::PARALLEL_MAX_SAMPLE_ERROR);
+    CHECK(max_error <= p3::PARALLEL_MAX_SAMPLE_ERROR);
+    return true;
+}
+
+// OpusSessionDecoder.feed_p3_bytes over a socket: the stream is cut at every
+// byte boundary (inside headers and payloads alike) and every packet must
+// come out of the parser byte for byte as read_packet sees it in the whole
+// file. Fed one byte at a time, which splits every packet at once, the
+// decoded PCM must match decode_p3.
+bool test_stream_parser() {
+    constexpr int RATE = 16000;
+    constexpr int MAX_FRAME = RATE * 120 / 1000;
+    std::vector<uint8_t> data;
+    CHECK(read_file(p3_path, data));
+    int64_t size = (int64_t)data.size();
+    PacketTable table = build_table(data);
+    int packet_count = (int)table.offsets.size();
+
+    int error = OPUS_OK;
+    OpusDecoder* decoder = opus_decoder_create(RATE, 1, &error);
+    CHECK(error == OPUS_OK);
+
+    p3::ScanInfo scan;
+    CHECK(p3::scan_packets(data.data(), size, RATE, scan));
+    std::vector<int16_t> serial(scan.total_samples);
+    p3::DecodeState state;
+    state.begin(decoder, serial.data(), scan.total_samples, MAX_FRAME);
+    int64_t pos = 0;
+    p3::decode_packets<1>(state, data.data(), size, pos);
+    CHECK(!state.failed());
+    uint64_t expected = p3::pcm_checksum(serial.data(), state.total_pcm_samples);
+
+    // Two chunks split at every position
+    p3::StreamParser parser;
+    for (int64_t split = 0; split <= size; split++) {
+        int packets = 0;
+        bool same = true;
+        auto compare = [&](const uint8_t* packet, int packet_len) {
+            if (packets < packet_count) {
+                int64_t offset = table.offsets[packets] + p3::HEADER_SIZE;
+                int64_t end = packets + 1 < packet_count ? table.offsets[packets + 1] : size;
+                same = same && packet_len == end - offset && memcmp(packet, data.data() + offset, packet_len) == 0;
+            }
+            packets++;
+        };
+        parser.reset();
+        CHECK(parser.feed(data.data(), split, compare) == p3::READ_OK);
+        CHECK(parser.feed(data.data() + split, size - split, compare) == p3::READ_OK);
+        CHECK(same && packets == packet_count && parser.get_pending_bytes() == 0);
+    }
+
+    // One byte at a time, decoded as the session does
+    opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+    std::vector<int16_t> streamed(scan.total_samples + MAX_FRAME);
+    int64_t streamed_samples = 0;
+    bool decoded = true;
+    parser.reset();
+    for (int64_t i = 0; i < size; i++) {
+        parser.feed(data.data() + i, 1, [&](const uint8_t* packet, int packet_len) {
+            int samples = opus_decode(decoder, packet, packet_len, streamed.data() + streamed_samples, MAX_FRAME, 0);
+            decoded = decoded && samples > 0;
+            streamed_samples += samples > 0 ? samples : 0;
+        });
+    }
+    opus_decoder_destroy(decoder);
+    CHECK(decoded && streamed_samples == state.total_pcm_samples);
+    CHECK(p3::pcm_checksum(streamed.data(), streamed_samples) == expected);
+    return true;
+}
+
+// A half-scale 850 Hz sine (an exact bin of band 1 with 20ms windows at
+// 16 kHz) reads rms 0.354, peak 0.5 and 0.5 on that one bin of three; a
+// bounded output keeps only the newest windows and counts the rest
+bool test_envelope() {
+    constexpr int RATE = 16000;
+    constexpr int WINDOW_MS = 20;
+    constexpr int WINDOWS = 10;
+    const double pi = 3.14159265358979323846;
+    std::vector<int16_t> tone(RATE * WINDOW_MS / 1000 * WINDOWS);
+    for (size_t i = 0; i < tone.size(); i++) {
+        tone[i] = (int16_t)lrint(16384.0 * std::sin(2.0 * pi * 850.0 * i / RATE));
+    }
+
+    EnvelopeAnalyzer envelope;
+    CHECK(envelope.configure(RATE, 1, WINDOW_MS));
+    envelope.process(tone.data(), (int)tone.size());
+    CHECK(envelope.get_window_count() == WINDOWS);
+    const std::vector<float>& output = envelope.get_output();
+    for (int window = 0; window < WINDOWS; window++) {
+        const float* values = output.data() + window * EnvelopeAnalyzer::STRIDE;
+        CHECK(std::fabs(values[0] - 0.5f / std::sqrt(2.0f)) < 0.005f);
+        CHECK(std::fabs(values[1] - 0.5f) < 0.005f);
+        CHECK(values[2] < 0.01f && values[4] < 0.01f && values[5] < 0.01f);
+        CHECK(std::fabs(values[3] - 0.5f / std::sqrt(3.0f)) < 0.01f);
+    }
+
+    envelope.reset();
+    envelope.set_max_windows(4);
+    size_t capacity = envelope.get_output().capacity();
+    envelope.process(tone.data(), (int)tone.size());
+    CHECK(envelope.get_window_count() == 4 && envelope.get_dropped_windows() == WINDOWS - 4);
+    CHECK(envelope.get_output().capacity() == capacity);
+    CHECK(std::fabs(envelope.get_output()[1] - 0.5f) < 0.005f);
+    return true;
+}
+
+// Entries hit twice are protected: a one-off entry that does not fit evicts
+// probation entries (itself included), never a protected one
+bool test_slru() {
+    SlruCache<int, int> cache(100, 80);
+    CHECK(cache.put(1, 1, 40));
+    CHECK(cache.get(1) != nullptr);
+    CHECK(cache.put(2, 2, 40));
+    CHECK(cache.get(2) != nullptr);
+
+    CHECK(!cache.put(3, 3, 40));
+    CHECK(cache.contains(1) && cache.contains(2) && !cache.contains(3));
+    CHECK(cache.get_used_bytes() == 80 && cache.get_evictions() == 1);
+
+    // Room in probation: the newest one-off entry pushes out the older one
+    CHECK(cache.put(4, 4, 10));
+    CHECK(cache.put(5, 5, 15));
+    CHECK(cache.contains(1) && cache.contains(2) && !cache.contains(4) && cache.contains(5));
+    CHECK(cache.get_used_bytes() == 95);
+
+    // Shrinking the budget demotes protected entries, then evicts the oldest
+    cache.set_budget(50);
+    CHECK(cache.get_used_bytes() <= 50 && cache.contains(2) && !cache.contains(1));
+    CHECK(!cache.put(6, 6, 51));
+    return true;
+}
+
+// Level in dB of a full-scale tone after resampling, measured past the
+// filter's settling time
+double tone_gain_db(PolyphaseResampler& resampler, double frequency) {
+    const double pi = 3.14159265358979323846;
+    int input_rate = resampler.get_input_rate();
+    std::vector<float> input(input_rate);
+    std::vector<float> output(resampler.get_max_output(input_rate));
+    for (int i = 0; i < input_rate; i++) {
+        input[i] = (float)std::sin(2.0 * pi * frequency * i / input_rate);
+    }
+    resampler.reset();
+    int produced = resampler.process(input.data(), input_rate, output.data());
+    int settled = (int)resampler.get_delay_samples() * 2;
+    double energy = 0.0;
+    for (int i = settled; i < produced; i++) {
+        energy += (double)output[i] * output[i];
+    }
+    double rms = std::sqrt(energy / (produced - settled));
+    return 20.0 * std::log10(rms * std::sqrt(2.0));
+}
+
+// Capture and import resample 48 kHz to 16 kHz: the passband is flat to
+// 7 kHz and content above the 8 kHz output Nyquist is at least 60 dB down
+bool test_resampler() {
+    PolyphaseResampler resampler;
+    CHECK(resampler.configure(48000, 16000));
+    for (double frequency : {1000.0, 4000.0, 7000.0}) {
+        double gain = tone_gain_db(resampler, frequency);
+        printf("%-24s %5.0f Hz %7.2f dB\n", "resampler", frequency, gain);
+        CHECK(std::fabs(gain) < 0.1);
+    }
+    for (double frequency : {8500.0, 10000.0, 16000.0, 23000.0}) {
+        double gain = tone_gain_db(resampler, frequency);
+        printf("%-24s %5.0f Hz %7.2f dB\n", "resampler", frequency, gain);
+        CHECK(gain < -60.0);
+    }
+    return true;
+}
+
+struct TestCase {
+    const char* name;
+    bool (*run)();
+};
+
+const TestCase CASES[] = {
+    {"packet_table", test_packet_table},
+    {"parallel_segments", test_parallel_segments},
+    {"stream_parser", test_stream_parser},
+    {"resampler", test_resampler},
+    {"slru", test_slru},
+    {"envelope", test_envelope},
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* only = argc > 1 ? argv[1] : nullptr;
+    if (argc > 2) {
+        p3_path = argv[2];
+    }
+
+    int failed = 0;
+    int run = 0;
+    for (const TestCase& test : CASES) {
+        if (only != nullptr && strcmp(only, test.name) != 0) {
+            continue;
+        }
+        bool passed = test.run();
+        printf("%-24s %s\n", test.name, passed ? "ok" : "FAILED");
+        failed += passed ? 0 : 1;
+        run++;
+    }
+
+    if (run == 0) {
+        fprintf(stderr, "Unknown test case %s\n", only);
+        return 1;
+    }
+    return failed == 0 ? 0 : 1;
+}